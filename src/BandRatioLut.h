@@ -0,0 +1,106 @@
+#ifndef _BANDRATIOLUTH_
+#define _BANDRATIOLUTH_
+//================================================================
+//
+// File: BandRatioLut.h
+// Created: 10/19/2026
+// Purpose: A lookup table for two band ratios of low bit depth data
+//
+//================================================================
+
+#include <limits>
+#include <vector>
+#include "Exception.h"
+
+/** BandRatioLut: a table of a two band function over every pair of input values, for inputs with a small
+ *  domain such as 8 bit data or 11 bit sensor data stored as UInt16.  A lookup replaces the per pixel
+ *  arithmetic, e.g. the division in NDVI, with one gather from a table indexed by (a << bits) | b.
+ *  The table holds whatever the function returns, so the results are identical to evaluating the
+ *  function directly, including any quantization or nodata handling done inside it.
+ */
+class BandRatioLut
+{
+
+private:
+
+  std::vector<unsigned char> table_;
+  int bits_;
+  size_t elementSize_;
+
+public:
+
+  /** The largest supported bit depth.  An 11 bit table has 4M entries, 16MB for float results. */
+  static const int maxBits = 11;
+
+  /** Constructor.  The table is empty until build() is called. */
+  BandRatioLut(void) : bits_(0), elementSize_(0) {};
+
+  /** Fills the table.
+   * @param bits The bit depth of the inputs
+   * @param function A function object, OutT function(T a, T b), evaluated for every pair of values
+   */
+  template <typename T, typename OutT, typename Function> void build(int bits, const Function& function) throw(Exception)
+  {
+    if (bits < 1 || bits > maxBits || bits > (int)(8 * sizeof(T)))
+      throw Exception("BandRatioLut::build Error: bit depth is not supported.");
+    long long n = 1LL << bits;
+    table_.resize((size_t)(n * n) * sizeof(OutT));
+    bits_ = bits;
+    elementSize_ = sizeof(OutT);
+
+    OutT* table = reinterpret_cast<OutT*>(&table_[0]);
+    for (long long a=0; a<n; a++)
+    {
+      for (long long b=0; b<n; b++)
+        table[(a << bits) | b] = function(static_cast<T>(a), static_cast<T>(b));
+    }
+  };
+
+  /** Looks up the results for arrays of input pairs.
+   * @param a The first input band
+   * @param b The second input band
+   * @param output The results
+   * @param npixels The number of pixels
+   * @return false, with output untouched, if the table is not built for OutT or an input value exceeds its bit depth
+   */
+  template <typename T, typename OutT> bool apply(const T* a, const T* b, OutT* output, long long npixels) const
+  {
+    if (table_.empty() || elementSize_ != sizeof(OutT) ||
+        !std::numeric_limits<T>::is_integer || std::numeric_limits<T>::is_signed || sizeof(T) > 2)
+      return(false);
+
+    //values above the declared bit depth would index outside the table
+    if (bits_ < (int)(8 * sizeof(T)))
+    {
+      unsigned int seen = 0;
+      for (long long idx=0; idx<npixels; idx++)
+        seen |= (unsigned int)a[idx] | (unsigned int)b[idx];
+      if (seen >> bits_)
+        return(false);
+    }
+
+    const OutT* table = reinterpret_cast<const OutT*>(&table_[0]);
+    for (long long idx=0; idx<npixels; idx++)
+      output[idx] = table[((unsigned int)a[idx] << bits_) | (unsigned int)b[idx]];
+    return(true);
+  };
+
+  /** Empties the table */
+  void clear(void)
+  {
+    std::vector<unsigned char>().swap(table_);
+    bits_ = 0;
+    elementSize_ = 0;
+  };
+
+  /** Returns true if the table has not been built */
+  bool empty(void) const { return(table_.empty()); };
+
+  /** Returns the bit depth the table was built for */
+  int bits(void) const { return(bits_); };
+
+  /** Returns the size of the table in bytes */
+  size_t nbytes(void) const { return(table_.size()); };
+
+};
+#endif
@@ -0,0 +1,169 @@
+#ifndef _CHANGEDETECTIONH_
+#define _CHANGEDETECTIONH_
+//================================================================
+//
+// File: ChangeDetection.h
+// Created: 10/19/2026
+// Purpose: Change detection between two co-registered rasters
+//
+//================================================================
+
+#include <math.h>
+#include <limits>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "MultiRasterIterator.h"
+#include "RasterDims.h"
+
+/** Enumeration for the measure of change between two dates */
+enum ChangeMethod
+{
+  ChangeDifference = 0,     //after - before, changed where the magnitude exceeds the threshold
+  ChangeRatio = 1           //after / before, changed where it exceeds the threshold or falls below its inverse
+};
+
+/** ChangeDetection: compares two co-registered rasters, e.g. NDVI of two dates, pixel by pixel.
+ *  The rasters are read together with a MultiRasterIterator, so they may have different extents on the
+ *  same grid; the outputs cover their common area.  Rows of each tile are processed in parallel.
+ *  Pixels where either input holds its nodata value or NaN, and ratios with a zero denominator, are
+ *  invalid: the change output holds NaN and the mask 255 there.
+ */
+class ChangeDetection
+{
+
+private:
+
+  DataRaster& before_;
+  DataRaster& after_;
+  ChangeMethod method_;
+  float threshold_;
+  int band_;
+  long long nchanged_;
+  long long nvalid_;
+
+public:
+
+  /** Constructor.
+   * @param before The earlier raster
+   * @param after The later raster
+   * @param method The measure of change
+   * @param threshold The threshold on the change.  For ChangeRatio it must be greater than 1.
+   * @param band The band compared in both rasters.  This follows GDAL and is 1 based.
+   */
+  ChangeDetection(DataRaster& before, DataRaster& after, ChangeMethod method = ChangeDifference, float threshold = 0.2f,
+    int band = 1) throw(Exception)
+    : before_(before), after_(after), method_(method), threshold_(threshold), band_(band), nchanged_(0), nvalid_(0)
+  {
+    if (method_ == ChangeRatio && !(threshold_ > 1.0f))
+      throw Exception("ChangeDetection: Error: the ratio threshold must be greater than 1.");
+  };
+
+  /** Destructor */
+  virtual ~ChangeDetection(void) {};
+
+  /** Returns the dimensions the outputs must have: the area common to both inputs */
+  RasterDims outputDims(long long memsize = 1024 * 1024) const throw(Exception)
+  {
+    std::vector<DataRaster*> inputs(1, &before_);
+    inputs.push_back(&after_);
+    MultiRasterIterator iter(inputs, memsize);
+    return(RasterDims(0, iter.dims().width() - 1, 0, iter.dims().height() - 1));
+  };
+
+  /** Runs the comparison.
+   * @param change If not NULL, a single precision raster that receives the difference or ratio
+   * @param mask If not NULL, a byte raster that receives 1 where the pixel changed, 0 where it did not and 255 where it is invalid
+   * @param memsize The memsize in bytes of the chunks read from each input
+   * @param nthreads The number of threads, or 0 for the OpenMP default
+   */
+  void run(DataRaster* change, DataRaster* mask, long long memsize = 1024 * 1024, int nthreads = 0) throw(Exception)
+  {
+    std::vector<DataRaster*> inputs(1, &before_);
+    inputs.push_back(&after_);
+    MultiRasterIterator iter(inputs, memsize);
+    const RasterDims& common = iter.dims();
+    RasterDims outdims(0, common.width() - 1, 0, common.height() - 1);
+    if ((change && !(change->dims() == outdims)) || (mask && !(mask->dims() == outdims)))
+      throw Exception("ChangeDetection::run Error: the outputs must have the dimensions of the common area of the inputs.");
+
+    int maxthreads = 1;
+#ifdef _OPENMP
+    maxthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#endif
+    (void)nthreads;
+
+    bool hasBeforeNoData = false, hasAfterNoData = false;
+    float beforeNoData = (float)before_.noDataValue(band_, &hasBeforeNoData);
+    float afterNoData = (float)after_.noDataValue(band_, &hasAfterNoData);
+    float lower = (method_ == ChangeRatio) ? 1.0f / threshold_ : -threshold_;
+    nchanged_ = 0;
+    nvalid_ = 0;
+
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims tiledims, beforedims, afterdims;
+      iter.getTileDims(tilenum, tiledims);
+      iter.getInputDims(0, tilenum, beforedims);
+      iter.getInputDims(1, tilenum, afterdims);
+      DataBuffer<float> beforedata(beforedims, 1, false), afterdata(afterdims, 1, false);
+      std::vector<DataBuffer<float>*> buffers(1, &beforedata);
+      buffers.push_back(&afterdata);
+      iter.getData(tilenum, buffers, GDT_Float32, band_);
+
+      RasterDims tileout(0, tiledims.width() - 1, tiledims.startLine() - common.startLine(), tiledims.endLine() - common.startLine());
+      DataBuffer<float> changedata(tileout, 1, false);
+      DataBuffer<unsigned char> maskdata(tileout, 1, false);
+      DataView<float> b = beforedata.band(0), a = afterdata.band(0), c = changedata.band(0);
+      DataView<unsigned char> m = maskdata.band(0);
+      int height = tiledims.height();
+      long long nchanged = 0, nvalid = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(maxthreads) schedule(static) reduction(+:nchanged,nvalid)
+#endif
+      for (int line=0; line<height; line++)
+      {
+        RowView<float> brow = b.row(line), arow = a.row(line), crow = c.row(line);
+        RowView<unsigned char> mrow = m.row(line);
+        for (long long sample=0; sample<brow.size(); sample++)
+        {
+          float before = brow[sample], after = arow[sample];
+          bool valid = (before == before && after == after && !(hasBeforeNoData && before == beforeNoData) &&
+                        !(hasAfterNoData && after == afterNoData) && !(method_ == ChangeRatio && before == 0.0f));
+          if (!valid)
+          {
+            crow[sample] = std::numeric_limits<float>::quiet_NaN();
+            mrow[sample] = 255;
+            continue;
+          }
+          float value = (method_ == ChangeRatio) ? after / before : after - before;
+          bool changed = (value > threshold_ || value < lower);
+          crow[sample] = value;
+          mrow[sample] = changed ? 1 : 0;
+          nchanged += changed ? 1 : 0;
+          nvalid++;
+        }
+      }
+      nchanged_ += nchanged;
+      nvalid_ += nvalid;
+
+      if (change)
+        change->setData(changedata, tileout, 1, GDT_Float32, 0);
+      if (mask)
+        mask->setData(maskdata, tileout, 1, GDT_Byte, 0);
+    }
+  };
+
+  /** Returns the number of changed pixels found by the last run */
+  long long nchanged(void) const { return(nchanged_); };
+
+  /** Returns the number of valid pixels compared by the last run */
+  long long nvalid(void) const { return(nvalid_); };
+
+};
+#endif
@@ -0,0 +1,324 @@
+#ifndef _CONNECTEDCOMPONENTSH_
+#define _CONNECTEDCOMPONENTSH_
+//================================================================
+//
+// File: ConnectedComponents.h
+// Created: 10/19/2026
+// Purpose: Streaming connected component labeling of a mask raster
+//
+//================================================================
+
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "DataRasterIterator.h"
+#include "RasterDims.h"
+
+/** Enumeration for the pixel connectivity of components */
+enum Connectivity
+{
+  Connectivity4 = 4,     //pixels sharing an edge are connected
+  Connectivity8 = 8      //pixels sharing an edge or a corner are connected
+};
+
+/** ComponentStats: the area and bounding box of one component, in image coordinates */
+struct ComponentStats
+{
+  unsigned int label;
+  long long area;
+  int startSample;
+  int endSample;
+  int startLine;
+  int endLine;
+};
+
+/** ConnectedComponents: labels the connected components of a mask raster, e.g. a thresholded NDVI.
+ *  Pixels that are nonzero, not NaN and not the nodata value are foreground.  The first pass labels each
+ *  tile of a DataRasterIterator independently, tiles in parallel, and joins the labels of objects that
+ *  cross a tile seam with a union-find over the last row of one tile and the first row of the next.
+ *  The second pass labels the tiles again and writes the final labels, numbered 1..ncomponents() in the
+ *  order their first pixel is met.  Memory is bounded by the tiles in flight, one boundary row and the
+ *  per component state.
+ */
+class ConnectedComponents
+{
+
+private:
+
+  DataRaster& mask_;
+  Connectivity connectivity_;
+  int band_;
+  std::vector<unsigned int> parent_;
+  std::vector<unsigned int> final_;
+  std::vector<int> tileOffsets_;
+  std::vector<ComponentStats> components_;
+
+  /** Returns the root of a provisional label, compressing the path */
+  static unsigned int find(std::vector<unsigned int>& parent, unsigned int label)
+  {
+    unsigned int root = label;
+    while (parent[root] != root)
+      root = parent[root];
+    while (parent[label] != root)
+    {
+      unsigned int next = parent[label];
+      parent[label] = root;
+      label = next;
+    }
+    return(root);
+  };
+
+  /** Joins two provisional labels, keeping the smaller root */
+  static void unite(std::vector<unsigned int>& parent, unsigned int a, unsigned int b)
+  {
+    a = find(parent, a);
+    b = find(parent, b);
+    if (a < b)
+      parent[b] = a;
+    else if (b < a)
+      parent[a] = b;
+  };
+
+  /** Reads the foreground of a tile.  This is an internal method. */
+  void readmask(const RasterDims& tiledims, std::vector<unsigned char>& foreground)
+  {
+    bool hasNoData = false;
+    float noData = (float)mask_.noDataValue(band_, &hasNoData);
+    DataBuffer<float> data(tiledims, 1, false);
+    mask_.getData(data, band_, GDT_Float32, 0);
+    RowView<float> values = data.band(0).flat();
+    foreground.resize((size_t)values.size());
+    for (long long idx=0; idx<values.size(); idx++)
+    {
+      float value = values[idx];
+      foreground[idx] = (value != 0.0f && value == value && !(hasNoData && value == noData)) ? 1 : 0;
+    }
+  };
+
+  /** Labels the components of one tile, numbering them 1..n in the order their first pixel is met.
+   *  This is an internal method.
+   * @param foreground The foreground of the tile
+   * @param width The width of the tile
+   * @param height The height of the tile
+   * @param labels The local labels, 0 for background
+   * @return The number of local components
+   */
+  unsigned int labeltile(const std::vector<unsigned char>& foreground, int width, int height, std::vector<unsigned int>& labels) const
+  {
+    labels.assign(foreground.size(), 0u);
+    std::vector<unsigned int> parent(1, 0u);
+    bool diagonal = (connectivity_ == Connectivity8);
+
+    for (int line=0; line<height; line++)
+    {
+      long long row = (long long)line * width;
+      for (int sample=0; sample<width; sample++)
+      {
+        if (!foreground[row + sample])
+          continue;
+        unsigned int left = (sample > 0) ? labels[row + sample - 1] : 0u;
+        unsigned int up = (line > 0) ? labels[row - width + sample] : 0u;
+        unsigned int upleft = (diagonal && line > 0 && sample > 0) ? labels[row - width + sample - 1] : 0u;
+        unsigned int upright = (diagonal && line > 0 && sample < width - 1) ? labels[row - width + sample + 1] : 0u;
+
+        unsigned int label = left ? left : (up ? up : (upleft ? upleft : upright));
+        if (!label)
+        {
+          label = (unsigned int)parent.size();
+          parent.push_back(label);
+        }
+        if (left && left != label) unite(parent, left, label);
+        if (up && up != label) unite(parent, up, label);
+        if (upleft && upleft != label) unite(parent, upleft, label);
+        if (upright && upright != label) unite(parent, upright, label);
+        labels[row + sample] = label;
+      }
+    }
+
+    //number the roots in scan order, which is the order of their smallest label
+    std::vector<unsigned int> local(parent.size(), 0u);
+    unsigned int n = 0;
+    for (size_t label=1; label<parent.size(); label++)
+    {
+      unsigned int root = find(parent, (unsigned int)label);
+      if (!local[root])
+        local[root] = ++n;
+      local[label] = local[root];
+    }
+    for (size_t idx=0; idx<labels.size(); idx++)
+      labels[idx] = local[labels[idx]];
+    return(n);
+  };
+
+public:
+
+  /** Constructor.
+   * @param mask The mask raster
+   * @param connectivity The pixel connectivity
+   * @param band The band of the mask raster.  This follows GDAL and is 1 based.
+   */
+  ConnectedComponents(DataRaster& mask, Connectivity connectivity = Connectivity8, int band = 1)
+    : mask_(mask), connectivity_(connectivity), band_(band) {};
+
+  /** Destructor */
+  virtual ~ConnectedComponents(void) {};
+
+  /** Labels the components.
+   * @param output If not NULL, a raster with the dimensions of the mask, open for update, that receives
+   *   the final labels in its first band.  An unsigned 32 bit band holds any number of components.
+   * @param memsize The memsize in bytes of the tiles read from the mask
+   * @param nthreads The number of tiles labeled in parallel, or 0 for the OpenMP default
+   */
+  void run(DataRaster* output = NULL, long long memsize = 1024 * 1024, int nthreads = 0) throw(Exception)
+  {
+    if (output && !(output->dims() == mask_.dims()))
+      throw Exception("ConnectedComponents::run Error: the output must have the dimensions of the mask.");
+
+    int batch = 1;
+#ifdef _OPENMP
+    batch = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#endif
+    (void)nthreads;
+
+    DataRasterIterator iter(mask_, memsize, 0);
+    int ntiles = iter.ntiles();
+    parent_.assign(1, 0u);
+    tileOffsets_.assign(ntiles, 0);
+    std::vector<ComponentStats> provisional(1);
+    std::vector<unsigned int> boundary;  //global labels of the last row of the previous tile
+    int width = mask_.nsamples();
+
+    //pass 1: label the tiles of a batch in parallel, then join them in tile order
+    for (int first=0; first<ntiles; first+=batch)
+    {
+      int count = (first + batch > ntiles) ? ntiles - first : batch;
+      std::vector<RasterDims> dims(count);
+      std::vector<std::vector<unsigned char> > foreground(count);
+      std::vector<std::vector<unsigned int> > labels(count);
+      std::vector<unsigned int> nlocal(count);
+      for (int idx=0; idx<count; idx++)
+      {
+        iter.getTileDims(first + idx, dims[idx]);
+        readmask(dims[idx], foreground[idx]);
+      }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(count) schedule(static, 1)
+#endif
+      for (int idx=0; idx<count; idx++)
+        nlocal[idx] = labeltile(foreground[idx], width, dims[idx].height(), labels[idx]);
+
+      for (int idx=0; idx<count; idx++)
+      {
+        unsigned int offset = (unsigned int)parent_.size() - 1u;
+        tileOffsets_[first + idx] = (int)offset;
+        for (unsigned int local=1; local<=nlocal[idx]; local++)
+        {
+          parent_.push_back(offset + local);
+          ComponentStats stats = { offset + local, 0, width, -1, dims[idx].endLine() + 1, -1 };
+          provisional.push_back(stats);
+        }
+
+        //area and bounding box of the tile's components
+        const std::vector<unsigned int>& tilelabels = labels[idx];
+        int height = dims[idx].height();
+        for (int line=0; line<height; line++)
+        {
+          for (int sample=0; sample<width; sample++)
+          {
+            unsigned int local = tilelabels[(long long)line * width + sample];
+            if (!local)
+              continue;
+            ComponentStats& stats = provisional[offset + local];
+            stats.area++;
+            int imageline = dims[idx].startLine() + line;
+            stats.startSample = (sample < stats.startSample) ? sample : stats.startSample;
+            stats.endSample = (sample > stats.endSample) ? sample : stats.endSample;
+            stats.startLine = (imageline < stats.startLine) ? imageline : stats.startLine;
+            stats.endLine = (imageline > stats.endLine) ? imageline : stats.endLine;
+          }
+        }
+
+        //join objects across the seam with the previous tile
+        if (!boundary.empty())
+        {
+          for (int sample=0; sample<width; sample++)
+          {
+            unsigned int local = tilelabels[sample];
+            if (!local)
+              continue;
+            int lo = (connectivity_ == Connectivity8 && sample > 0) ? sample - 1 : sample;
+            int hi = (connectivity_ == Connectivity8 && sample < width - 1) ? sample + 1 : sample;
+            for (int neighbor=lo; neighbor<=hi; neighbor++)
+            {
+              if (boundary[neighbor])
+                unite(parent_, boundary[neighbor], offset + local);
+            }
+          }
+        }
+        boundary.assign(width, 0u);
+        long long lastrow = (long long)(height - 1) * width;
+        for (int sample=0; sample<width; sample++)
+          boundary[sample] = tilelabels[lastrow + sample] ? offset + tilelabels[lastrow + sample] : 0u;
+      }
+    }
+
+    //number the components in the order of their first pixel and combine their statistics
+    final_.assign(parent_.size(), 0u);
+    components_.clear();
+    for (size_t label=1; label<parent_.size(); label++)
+    {
+      unsigned int root = find(parent_, (unsigned int)label);
+      if (!final_[root])
+      {
+        final_[root] = (unsigned int)components_.size() + 1u;
+        ComponentStats stats = provisional[label];
+        stats.label = final_[root];
+        components_.push_back(stats);
+      }
+      else
+      {
+        ComponentStats& stats = components_[final_[root] - 1];
+        const ComponentStats& part = provisional[label];
+        stats.area += part.area;
+        stats.startSample = (part.startSample < stats.startSample) ? part.startSample : stats.startSample;
+        stats.endSample = (part.endSample > stats.endSample) ? part.endSample : stats.endSample;
+        stats.startLine = (part.startLine < stats.startLine) ? part.startLine : stats.startLine;
+        stats.endLine = (part.endLine > stats.endLine) ? part.endLine : stats.endLine;
+      }
+      final_[label] = final_[root];
+    }
+
+    if (!output)
+      return;
+
+    //pass 2: label each tile again and write the final labels
+    for (int tilenum=0; tilenum<ntiles; tilenum++)
+    {
+      RasterDims tiledims;
+      iter.getTileDims(tilenum, tiledims);
+      std::vector<unsigned char> foreground;
+      std::vector<unsigned int> labels;
+      readmask(tiledims, foreground);
+      labeltile(foreground, width, tiledims.height(), labels);
+
+      DataBuffer<unsigned int> outputdata(tiledims, 1, false);
+      RowView<unsigned int> out = outputdata.band(0).flat();
+      unsigned int offset = (unsigned int)tileOffsets_[tilenum];
+      for (long long idx=0; idx<out.size(); idx++)
+        out[idx] = labels[idx] ? final_[offset + labels[idx]] : 0u;
+      output->setData(outputdata, tiledims, 1, GDT_UInt32, 0);
+    }
+  };
+
+  /** Returns the number of components found by the last run */
+  int ncomponents(void) const { return((int)components_.size()); };
+
+  /** Returns the components found by the last run, ordered by label.  Component n is at index n - 1. */
+  const std::vector<ComponentStats>& components(void) const { return(components_); };
+
+};
+#endif
@@ -11,24 +11,163 @@
 //================================================================
 
 #include <iostream>
+#include <stdio.h>
 #include <memory.h>
+#include <string>
+#include <algorithm>
 #include "Exception.h"
 #include "RasterDims.h"
+#include "DataView.h"
+#include "MemoryBudget.h"
+#include "PerfTypeName.h"
 
 /** DataBuffer: An encapsulation of a DataBuffer, 
  *  typically read from an image.
+ *  A DataBuffer is move only: it can be moved, or swapped, between pipeline stages and threads without
+ *  copying its data, and clone() makes an explicit deep copy.  It can also adopt or wrap memory it did not allocate.
+ *  Memory a DataBuffer allocates is accounted for by the process wide MemoryBudget, under the
+ *  MemorySite current when it is allocated and its element type, and a buffer that waits between
+ *  stages can be marked spillable so the budget may move it to a scratch file.
 */
-template <typename T> class DataBuffer
+template <typename T> class DataBuffer : public Spillable
 {
 
+private:
+
+public:
+
+  /** A function that releases adopted memory.  context is the pointer given when the memory was adopted. */
+  typedef void (*Deleter)(T* data, void* context);
+
 private:
 
   T* data_;
   RasterDims dims_;
   long long int sz_, width_, height_, nbands_, first_, last_;
+  bool owned_;
+  Deleter deleter_;
+  void* context_;
+  unsigned long long accounted_;
+  const char* site_;
+  bool cold_;
+  bool spilled_;
+  std::string spillFile_;
+
+  /** Sets the dimensions and bounds for a buffer of nbands bands */
+  void setDims(const RasterDims& dims)
+  {
+    dims_.setStartSample(dims.startSample());
+    dims_.setEndSample(dims.endSample());
+    dims_.setStartLine(dims.startLine());
+    dims_.setEndLine(dims.endLine());
+
+    width_ = dims_.width();
+    height_ = dims_.height();
+    sz_ = width_ * height_;
+    first_ = 0LL;
+    last_ = sz_ * nbands_ - 1LL;
+  };
+
+  /** Releases the data, according to how it was obtained */
+  void release(void)
+  {
+    if (cold_)
+      MemoryBudget::instance().removeCold(this);
+    if (spilled_)
+      remove(spillFile_.c_str());
+    else if (data_ && owned_)
+    {
+      if (deleter_)
+        deleter_(data_, context_);
+      else
+        delete[](data_);
+      if (accounted_)
+        MemoryBudget::instance().release(accounted_, site_, PerfTypeName<T>::name());
+    }
+  };
+
+  /** Brings the data of a spillable buffer back under the owner's control, reading it back if it was spilled */
+  void unspill(void) throw(Exception)
+  {
+    MemoryBudget::instance().removeCold(this);
+    cold_ = false;
+    if (!spilled_)
+      return;
+
+    //the buffer stays spilled, and cold so the next access retries, until the data is back in memory
+    //and accounted for
+    cold_ = true;
+    T* data = new T[sz_*nbands_];
+    FILE* fp = fopen(spillFile_.c_str(), "rb");
+    bool ok = (fp && fread((void*)data, 1, accounted_, fp) == accounted_);
+    if (fp)
+      fclose(fp);
+    if (!ok)
+    {
+      delete[](data);
+      throw Exception(std::string("DataBuffer: Error: unable to read back spilled data from ") + spillFile_);
+    }
+    try
+    {
+      MemoryBudget::instance().acquire(accounted_, site_, PerfTypeName<T>::name());
+    }
+    catch (...)
+    {
+      delete[](data);
+      throw;
+    }
+    data_ = data;
+    remove(spillFile_.c_str());
+    spilled_ = false;
+    cold_ = false;
+  };
+
+  /** Makes sure the data is in memory before it is used */
+  inline void resident(void) const
+  {
+    if (cold_)
+      const_cast<DataBuffer*>(this)->unspill();
+  };
+
+  /** Takes the data and state of another buffer, leaving it empty */
+  void take(DataBuffer& other)
+  {
+    other.resident();
+    data_ = other.data_;
+    nbands_ = other.nbands_;  //setDims derives the bounds from it
+    setDims(other.dims_);
+    owned_ = other.owned_;
+    deleter_ = other.deleter_;
+    context_ = other.context_;
+    accounted_ = other.accounted_;
+    site_ = other.site_;
+    cold_ = false;
+    spilled_ = false;
+
+    other.data_ = NULL;
+    other.sz_ = other.width_ = other.height_ = other.nbands_ = 0LL;
+    other.last_ = -1LL;
+    other.owned_ = false;
+    other.deleter_ = NULL;
+    other.context_ = NULL;
+    other.accounted_ = 0ULL;
+  };
+
+#if __cplusplus < 201103L
+  /** Buffers are not copyable.  Use clone() for a deep copy. */
+  DataBuffer(const DataBuffer&);
+  DataBuffer& operator=(const DataBuffer&);
+#endif
 
 public:
 
+  /** Constructor for an empty buffer, e.g. to receive a swap() or clone() */
+  DataBuffer(void)
+    : data_(NULL), sz_(0LL), width_(0LL), height_(0LL), nbands_(0LL), first_(0LL), last_(-1LL), owned_(false),
+      deleter_(NULL), context_(NULL), accounted_(0ULL), site_(NULL), cold_(false), spilled_(false)
+  {
+  };
+
 /**
  * Constructor.
  * @param dims A DataRasterDims object
@@ -36,33 +175,117 @@ public:
  * @param bzero A boolean, set to true to zero out the allocated array.
  */
   DataBuffer(const RasterDims& dims, int nbands = 1, bool bzero = true) throw(Exception)
-    : nbands_(nbands)
+    : nbands_(nbands), owned_(true), deleter_(NULL), context_(NULL), accounted_(0ULL), site_(MemorySite::current()),
+      cold_(false), spilled_(false)
   {
-    dims_.setStartSample(dims.startSample());
-    dims_.setEndSample(dims.endSample());
-    dims_.setStartLine(dims.startLine());
-    dims_.setEndLine(dims.endLine());
-
-    width_ = dims_.width();
-    height_ = dims_.height();
-    sz_ = width_ * height_;
-    data_ = new T[sz_*nbands_];
+    setDims(dims);
+    unsigned long long nbytes = (unsigned long long)(sizeof(T) * sz_ * nbands_);
+    MemoryBudget::instance().acquire(nbytes, site_, PerfTypeName<T>::name());
+    try
+    {
+      data_ = new T[sz_*nbands_];
+    }
+    catch (...)
+    {
+      MemoryBudget::instance().release(nbytes, site_, PerfTypeName<T>::name());
+      throw;
+    }
+    accounted_ = nbytes;
     if (bzero)
       memset((void*)data_, 0, sizeof(T) * sz_ * nbands_);
-    first_ = 0LL;
-    last_ = sz_ * nbands_ - 1LL;
   };
 
+/**
+ * Constructor for memory the buffer did not allocate, e.g. an mmap region, a pool block or a GDAL buffer.
+ * The memory must hold nbands bands of the given dimensions, band sequential.
+ * @param data The memory
+ * @param dims A DataRasterDims object
+ * @param nbands The number of bands
+ * @param deleter The function that releases the memory when the buffer is destroyed.  If NULL the buffer
+ *        only wraps the memory and the caller keeps ownership; the memory must outlive the buffer.
+ * @param context A pointer passed to the deleter, e.g. the pool the block came from
+ */
+  DataBuffer(T* data, const RasterDims& dims, int nbands = 1, Deleter deleter = NULL, void* context = NULL)
+    throw(Exception)
+    : data_(data), nbands_(nbands), owned_(deleter != NULL), deleter_(deleter), context_(context),
+      accounted_(0ULL), site_(NULL), cold_(false), spilled_(false)
+  {
+    if (!data_)
+      throw Exception("DataBuffer: Error: cannot wrap a NULL pointer.");
+    setDims(dims);
+  };
+
+#if __cplusplus >= 201103L
+  /** Move constructor.  other is left empty. */
+  DataBuffer(DataBuffer&& other)
+    : data_(NULL), sz_(0LL), width_(0LL), height_(0LL), nbands_(0LL), first_(0LL), last_(-1LL), owned_(false),
+      deleter_(NULL), context_(NULL), accounted_(0ULL), site_(NULL), cold_(false), spilled_(false)
+  {
+    take(other);
+  };
+
+  /** Move assignment.  The current data is released and other is left empty. */
+  DataBuffer& operator=(DataBuffer&& other)
+  {
+    if (this != &other)
+    {
+      release();
+      take(other);
+    }
+    return(*this);
+  };
+
+  DataBuffer(const DataBuffer&) = delete;
+  DataBuffer& operator=(const DataBuffer&) = delete;
+#endif
+
+  /** Exchanges the data and state of two buffers without copying, e.g. to replace a tile with a result */
+  void swap(DataBuffer& other) throw(Exception)
+  {
+    resident();
+    other.resident();
+    std::swap(data_, other.data_);
+    std::swap(dims_, other.dims_);
+    std::swap(sz_, other.sz_);
+    std::swap(width_, other.width_);
+    std::swap(height_, other.height_);
+    std::swap(nbands_, other.nbands_);
+    std::swap(first_, other.first_);
+    std::swap(last_, other.last_);
+    std::swap(owned_, other.owned_);
+    std::swap(deleter_, other.deleter_);
+    std::swap(context_, other.context_);
+    std::swap(accounted_, other.accounted_);
+    std::swap(site_, other.site_);
+  };
+
+  /** Makes copy a deep copy of this buffer, in newly allocated memory whatever memory this buffer uses.
+   * @param copy The buffer to receive the copy.  Its previous data is released.
+   */
+  void clone(DataBuffer& copy) const throw(Exception)
+  {
+    resident();
+    DataBuffer data(dims_, nbands_, false);
+    if (sz_ * nbands_ > 0)
+      memcpy((void*)data.data_, (const void*)data_, sizeof(T) * sz_ * nbands_);
+    copy.swap(data);
+  };
+
+  /** Deleter for memory allocated with new[], for adopting it */
+  static void deleteArray(T* data, void* context) { (void)context; delete[](data); };
+
 /** Destructor */
   virtual ~DataBuffer(void) throw(Exception)
   {
-    if (data_)
-      delete[](data_);
+    release();
   };
 
-  /** operator [], used for indexing an element of the data array */
-  inline T& operator[](int elem) throw(Exception)
+  /** operator [], used for indexing an element of the data array.  Always bounds checked; hot loops
+   *  should use the views returned by band(), row() and window(), which are checked in debug builds only.
+   */
+  inline T& operator[](long long elem) throw(Exception)
   {
+    resident();
     if (elem < first_ || elem > last_)
       throw Exception("DataBuffer: Error: out of bounds index attempt");
     return(data_[elem]);
@@ -81,7 +304,105 @@ public:
   int height(void) const {return(height_); };
 
   /** Returns non-const pointer to underlying input data */
-  T* data(void) { return(data_); };
+  T* data(void) { resident(); return(data_); };
+
+  /** Returns const pointer to underlying input data */
+  const T* data(void) const { resident(); return(data_); };
+
+  /** Returns true if the buffer frees its memory when destroyed, false if it wraps memory owned elsewhere */
+  bool ownsData(void) const { return(owned_); };
+
+  /** Marks the buffer as cold or hot.  While cold, e.g. while it waits in a queue between stages, the
+   *  MemoryBudget may write it to a scratch file and free its memory.  Any access to the data, or
+   *  setSpillable(false), makes it hot again and reads it back if needed.  Only memory the buffer
+   *  allocated itself can be spilled.
+   * @param spillable true to mark the buffer cold
+   * @return true if the buffer is now cold
+   */
+  bool setSpillable(bool spillable) throw(Exception)
+  {
+    if (!spillable)
+    {
+      resident();
+      return(false);
+    }
+    if (cold_)
+      return(true);
+    if (!accounted_ || !data_ || deleter_)
+      return(false);
+    cold_ = true;
+    MemoryBudget::instance().addCold(this);
+    return(true);
+  };
+
+  /** Returns true if the data is currently in a scratch file */
+  bool spilled(void) const { return(spilled_); };
+
+  /** Returns the allocation site the buffer's memory is accounted to, or NULL */
+  const char* memorySite(void) const { return(site_); };
+
+  /** Returns the element type the buffer's memory is accounted to */
+  const char* memoryType(void) const { return(PerfTypeName<T>::name()); };
+
+  /** Writes the data to a scratch file and frees it.  Called by the MemoryBudget while the buffer is cold.
+   * @param filename The scratch file
+   * @return The number of bytes freed
+   */
+  unsigned long long spill(const std::string& filename)
+  {
+    if (spilled_ || !data_)
+      return(0ULL);
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (!fp)
+      return(0ULL);
+    bool ok = (fwrite((const void*)data_, 1, accounted_, fp) == accounted_);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok)
+    {
+      remove(filename.c_str());
+      return(0ULL);
+    }
+    delete[](data_);
+    data_ = NULL;
+    spillFile_ = filename;
+    spilled_ = true;
+    return(accounted_);
+  };
+
+  /** Returns the number of bytes spill would free */
+  unsigned long long spillBytes(void) const { return((spilled_ || !data_) ? 0ULL : accounted_); };
+
+  /** Returns a view of one band.
+   * @param band The zero based band index
+   */
+  DataView<T> band(int band) throw(Exception)
+  {
+    resident();
+    if (band < 0 || band >= nbands_)
+      throw Exception("DataBuffer::band Error: band exceeds dimensions of buffer.");
+    return(DataView<T>(data_ + sz_ * band, width_, height_, width_));
+  };
+
+  /** Returns a view of one row of one band.
+   * @param band The zero based band index
+   * @param row The zero based row within the buffer
+   */
+  RowView<T> row(int band, long long row) throw(Exception)
+  {
+    if (row < 0 || row >= height_)
+      throw Exception("DataBuffer::row Error: row exceeds dimensions of buffer.");
+    return(this->band(band).row(row));
+  };
+
+  /** Returns a view of a window of one band.
+   * @param band The zero based band index
+   * @param dims The window, in the same image coordinates as the buffer's dims
+   */
+  DataView<T> window(int band, const RasterDims& dims) throw(Exception)
+  {
+    return(this->band(band).window(dims.startSample() - dims_.startSample(), dims.startLine() - dims_.startLine(),
+      dims.width(), dims.height()));
+  };
 
 };
 #endif
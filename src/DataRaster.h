@@ -10,18 +10,41 @@
 //
 //================================================================
 
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <gdal_priv.h>
 #include "Exception.h"
 #include "RasterDims.h"
+#include "Float16.h"
+#include "DataBuffer.h"
+#include "TileCache.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+
+enum DataCoverage
+{
+  DataCoverageUnknown = 0,     //the driver cannot report coverage, assume data is present
+  DataCoverageEmpty = 1,       //the region contains no stored data
+  DataCoveragePartial = 2,     //the region contains both stored data and empty blocks
+  DataCoverageFull = 3         //the region is fully backed by stored data
+};
 
 //forward declarations
 //class IPL_DataRasterIterator;
 template <typename T> class DataBuffer;
 class RasterDims;
 
-/** DataRaster: a class that models an image.  */
+/** DataRaster: a class that models an image.
+ *  An open DataRaster may be shared between threads.  Reads of a file opened read only run concurrently:
+ *  the first reader uses the raster's own GDAL dataset and other readers take a handle from a pool of
+ *  read handles, opened as needed and kept until the raster is closed.  Other reads, writes and metadata
+ *  calls take turns on the raster's dataset.  Opening, creating, closing and configuring a raster, e.g.
+ *  setDecodeThreads, must not overlap other calls on it.
+ */
 class DataRaster
 {
 
@@ -34,7 +57,397 @@ private:
   RasterDims dims_;
 
   GDALDataset* gdalDataset_;
-  GDALRasterBand* gdalRasterBand_;
+  std::vector<GDALRasterBand*> bands_;
+  std::vector<GDALDataType> types_;
+  mutable pthread_mutex_t mutex_;
+
+  double geoTransform_[6];
+  bool hasGeoTransform_;
+
+  std::string filename_;
+  GDALAccess access_;
+  int decodeThreads_;
+  bool nativeDecode_;
+  std::vector<GDALDataset*> handles_;
+  pthread_mutex_t poolMutex_;
+  TileCache* tileCache_;
+  std::vector<char*> memoryBands_;
+  char* memoryStorage_;
+
+  DataRaster(const DataRaster&);
+  DataRaster& operator=(const DataRaster&);
+
+  /** Scoped lock of a mutex.  This is an internal class. */
+  class Lock
+  {
+    pthread_mutex_t* mutex_;
+  public:
+    Lock(pthread_mutex_t* mutex) : mutex_(mutex) { pthread_mutex_lock(mutex_); };
+    ~Lock(void) { pthread_mutex_unlock(mutex_); };
+  };
+
+  /** Registers the GDAL drivers.  This is an internal method, see registerOnce. */
+  static void registerDrivers(void) { GDALAllRegister(); };
+
+  /** Registers the GDAL drivers the first time it is called in the process */
+  static void registerOnce(void)
+  {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, registerDrivers);
+  };
+
+  /** Returns a band of the open dataset, throwing if it does not exist.
+   * @param band The band.  This follows GDAL and is 1 based.
+   */
+  GDALRasterBand* rasterBand(int band) const throw(Exception)
+  {
+    if (!gdalDataset_)
+      throw Exception("DataRaster: Error: gdalDataset_ object is NULL.");
+    if (band < 1 || band > (int)bands_.size() || !bands_[band - 1])
+      throw Exception("DataRaster: Error: band does not exist.");
+    return(bands_[band - 1]);
+  };
+
+  /** Caches the band pointers and data types of the open dataset.  This is an internal method. */
+  void cacheBands(void)
+  {
+    bands_.clear();
+    types_.clear();
+    for (int band=1; gdalDataset_ && band<=gdalDataset_->GetRasterCount(); band++)
+    {
+      bands_.push_back(gdalDataset_->GetRasterBand(band));
+      types_.push_back(bands_.back() ? bands_.back()->GetRasterDataType() : GDT_Unknown);
+    }
+  };
+
+  /** Opens a GDAL dataset handle on a file, asking GDAL 3.6 and later to decode in parallel when more
+   *  than one decode thread is set.  This is an internal method.
+   * @param filename The file
+   * @param gdalMode The access mode
+   * @param native Set to true if GDAL decodes in parallel itself
+   * @return The handle, or NULL if the file could not be opened
+   */
+  GDALDataset* openHandle(const std::string& filename, GDALAccess gdalMode, bool* native) const
+  {
+    GDALDataset* handle = NULL;
+    *native = false;
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3060000
+    if (decodeThreads_ > 1 && gdalMode == GA_ReadOnly)
+    {
+      std::ostringstream threads;
+      threads << "NUM_THREADS=" << decodeThreads_;
+      char** openOptions = CSLAddString(NULL, threads.str().c_str());
+      handle = (GDALDataset *) GDALOpenEx(filename.c_str(), GDAL_OF_RASTER | GDAL_OF_READONLY, NULL, openOptions, NULL);
+      CSLDestroy(openOptions);
+      *native = (handle != NULL);
+    }
+    if (!handle)
+#endif
+    handle = (GDALDataset *) GDALOpen(filename.c_str(), gdalMode);
+    return(handle);
+  };
+
+  /** Takes an idle read handle from the pool, opening a new one when none is idle.  Returns NULL if the
+   *  file could not be opened.  This is an internal method.
+   */
+  GDALDataset* acquireHandle(void)
+  {
+    {
+      Lock lock(&poolMutex_);
+      if (!handles_.empty())
+      {
+        GDALDataset* handle = handles_.back();
+        handles_.pop_back();
+        return(handle);
+      }
+    }
+    bool native = false;
+    return(openHandle(filename_, GA_ReadOnly, &native));
+  };
+
+  /** Returns a read handle to the pool.  This is an internal method. */
+  void releaseHandle(GDALDataset* handle)
+  {
+    Lock lock(&poolMutex_);
+    handles_.push_back(handle);
+  };
+
+  /** Closes the pooled read handles */
+  void closeHandles(void)
+  {
+    Lock lock(&poolMutex_);
+    for (size_t idx=0; idx<handles_.size(); idx++)
+      GDALClose(handles_[idx]);
+    handles_.clear();
+  };
+
+  /** Reads a window of a band.  A read only file is read through the raster's own dataset when no other
+   *  thread is using it, and through a pooled handle otherwise; other rasters wait for their dataset.
+   *  This is an internal method.
+   * @param imageband The band to read.  This follows GDAL and is 1 based.
+   * @param window The window to read
+   * @param data The destination, window.width() x window.height() values of type dt
+   * @param dt The data type of the destination
+   */
+  void readWindow(int imageband, const RasterDims& window, void* data, GDALDataType dt) throw(Exception)
+  {
+    rasterBand(imageband);
+    GDALDataset* handle = beginRead();
+    GDALRasterBand* band = handle ? handle->GetRasterBand(imageband) : bands_[imageband - 1];
+    CPLErr err = band ? band->RasterIO(GF_Read, window.startSample(), window.startLine(), window.width(), window.height(),
+      data, window.width(), window.height(), dt, 0, 0) : CE_Failure;
+    endRead(handle);
+    if (err != CE_None)
+      throw Exception("DataRaster::getData Error: RasterIO returned an error");
+  };
+
+  /** Starts a read.  Returns a pooled handle to read through, or NULL with the raster's own dataset
+   *  locked, see readWindow.  This is an internal method.
+   */
+  GDALDataset* beginRead(void)
+  {
+    GDALDataset* handle = NULL;
+    bool pooled = (access_ == GA_ReadOnly && !filename_.empty());
+    if (!pooled || pthread_mutex_trylock(&mutex_) != 0)
+    {
+      handle = pooled ? acquireHandle() : NULL;
+      if (!handle)
+        pthread_mutex_lock(&mutex_);
+    }
+    return(handle);
+  };
+
+  /** Ends a read started by beginRead.  This is an internal method. */
+  void endRead(GDALDataset* handle)
+  {
+    if (handle)
+      releaseHandle(handle);
+    else
+      pthread_mutex_unlock(&mutex_);
+  };
+
+  /** Reads a window of a band resampled to a smaller buffer.  The window is read from the overview with
+   *  the fewest pixels that still samples it at least as finely as the buffer, or from the band itself.
+   *  This is an internal method.
+   * @param imageband The band to read.  This follows GDAL and is 1 based.
+   * @param window The window in pixels of the band: x offset, y offset, width and height, not necessarily whole
+   * @param width The width of the buffer
+   * @param height The height of the buffer
+   * @param data The destination, width x height values of type dt
+   * @param dt The data type of the destination
+   * @param resampling The resampling used to reduce the window to the buffer
+   */
+  void readPreview(int imageband, const double* window, int width, int height, void* data, GDALDataType dt,
+    GDALRIOResampleAlg resampling) throw(Exception)
+  {
+    rasterBand(imageband);
+    GDALDataset* handle = beginRead();
+    GDALRasterBand* band = handle ? handle->GetRasterBand(imageband) : bands_[imageband - 1];
+    CPLErr err = CE_Failure;
+    if (band)
+    {
+      GDALRasterBand* source = band;
+      double scalex = 1.0, scaley = 1.0;
+      for (int idx=0; idx<band->GetOverviewCount(); idx++)
+      {
+        GDALRasterBand* overview = band->GetOverview(idx);
+        if (!overview || overview->GetXSize() >= source->GetXSize())
+          continue;
+        double sx = (double)overview->GetXSize() / (double)band->GetXSize();
+        double sy = (double)overview->GetYSize() / (double)band->GetYSize();
+        if (window[2] * sx >= (double)width && window[3] * sy >= (double)height)
+        {
+          source = overview;
+          scalex = sx;
+          scaley = sy;
+        }
+      }
+
+      //the whole pixels covering the window, clamped to the source
+      double x0 = window[0] * scalex, y0 = window[1] * scaley;
+      double xsize = window[2] * scalex, ysize = window[3] * scaley;
+      int xoff = (int)floor(x0), yoff = (int)floor(y0);
+      int xend = (int)ceil(x0 + xsize - 1e-9), yend = (int)ceil(y0 + ysize - 1e-9);
+      xend = (xend > source->GetXSize()) ? source->GetXSize() : xend;
+      yend = (yend > source->GetYSize()) ? source->GetYSize() : yend;
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 2000000
+      GDALRasterIOExtraArg extra;
+      INIT_RASTERIO_EXTRA_ARG(extra);
+      extra.eResampleAlg = resampling;
+      extra.bFloatingPointWindowValidity = TRUE;
+      extra.dfXOff = x0;
+      extra.dfYOff = y0;
+      extra.dfXSize = xsize;
+      extra.dfYSize = ysize;
+      err = source->RasterIO(GF_Read, xoff, yoff, xend - xoff, yend - yoff, data, width, height, dt, 0, 0, &extra);
+#else
+      (void)resampling;
+      err = source->RasterIO(GF_Read, xoff, yoff, xend - xoff, yend - yoff, data, width, height, dt, 0, 0);
+#endif
+    }
+    endRead(handle);
+    if (err != CE_None)
+      throw Exception("DataRaster::getPreview Error: RasterIO returned an error");
+  };
+
+  /** Reads a window of a band in parallel.  The block rows covering the window are split into one group
+   *  per thread, and each thread decodes its group through a pooled dataset handle straight into its rows
+   *  of the destination.  Returns false, having read nothing, when the window is not worth splitting.
+   * @param imageband The band to read.  This follows GDAL and is 1 based.
+   * @param window The window to read
+   * @param data The destination, window.width() x window.height() values of type dt
+   * @param dt The data type of the destination
+   */
+  bool readParallel(int imageband, const RasterDims& window, void* data, GDALDataType dt) throw(Exception)
+  {
+    if (decodeThreads_ < 2 || nativeDecode_ || access_ != GA_ReadOnly || filename_.empty())
+      return(false);
+
+    int blockx, blocky;
+    rasterBand(imageband)->GetBlockSize(&blockx, &blocky);
+    blocky = (blocky < 1) ? 1 : blocky;
+    int firstrow = window.startLine() / blocky;
+    int nblockrows = window.endLine() / blocky - firstrow + 1;
+    int ngroups = (decodeThreads_ < nblockrows) ? decodeThreads_ : nblockrows;
+    if (ngroups < 2)
+      return(false);
+
+    std::vector<GDALDataset*> decoders;
+    while ((int)decoders.size() < ngroups)
+    {
+      GDALDataset* decoder = acquireHandle();
+      if (!decoder)
+      {
+        for (size_t idx=0; idx<decoders.size(); idx++)
+          releaseHandle(decoders[idx]);
+        return(false);
+      }
+      decoders.push_back(decoder);
+    }
+
+    long long linesize = (long long)window.width() * (GDALGetDataTypeSize(dt) / 8);
+    int nfailed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ngroups) schedule(static) reduction(+:nfailed)
+#endif
+    for (int group=0; group<ngroups; group++)
+    {
+      int startrow = firstrow + (int)((long long)nblockrows * group / ngroups);
+      int endrow = firstrow + (int)((long long)nblockrows * (group + 1) / ngroups) - 1;
+      int startline = (startrow * blocky > window.startLine()) ? startrow * blocky : window.startLine();
+      int endline = ((endrow + 1) * blocky - 1 < window.endLine()) ? (endrow + 1) * blocky - 1 : window.endLine();
+      int nlines = endline - startline + 1;
+      char* dst = (char*)data + linesize * (startline - window.startLine());
+
+      GDALRasterBand* band = decoders[group]->GetRasterBand(imageband);
+      if (!band || band->RasterIO(GF_Read, window.startSample(), startline, window.width(), nlines,
+          (void*)dst, window.width(), nlines, dt, 0, 0) != CE_None)
+        nfailed++;
+    }
+    for (size_t idx=0; idx<decoders.size(); idx++)
+      releaseHandle(decoders[idx]);
+    if (nfailed)
+      throw Exception("DataRaster::getData Error: RasterIO returned an error");
+    return(true);
+  };
+
+  /** Opens a MEM dataset over band sequential memory.  The bands are views of the memory, so nothing is
+   *  copied.  This is an internal method.
+   * @param data The memory, nbands bands of width x height values of type dt
+   * @param dims The dimensions of one band
+   * @param nbands The number of bands
+   * @param dt The data type of the values
+   */
+  void attachMemory(char* data, const RasterDims& dims, int nbands, GDALDataType dt) throw(Exception)
+  {
+    GDALDriver* pDriver = GetGDALDriverManager()->GetDriverByName("MEM");
+    if (!pDriver)
+      throw Exception("DataRaster: Error: unable to get the GDAL MEM driver.");
+    GDALDataset* dataset = pDriver->Create("", dims.width(), dims.height(), 0, dt, NULL);
+    if (!dataset)
+      throw Exception("DataRaster: Error: creation of an in memory raster failed.");
+
+    long long bandsize = (long long)dims.width() * dims.height() * (GDALGetDataTypeSize(dt) / 8);
+    std::vector<char*> bands;
+    for (int band=0; band<nbands; band++)
+    {
+      char pointer[64] = { 0 };
+      int len = CPLPrintPointer(pointer, (void*)(data + bandsize * band), sizeof(pointer) - 1);
+      pointer[len] = 0;
+      char** options = CSLAddString(NULL, (std::string("DATAPOINTER=") + pointer).c_str());
+      CPLErr err = dataset->AddBand(dt, options);
+      CSLDestroy(options);
+      if (err != CE_None)
+      {
+        GDALClose(dataset);
+        throw Exception("DataRaster: Error: unable to add a band to an in memory raster.");
+      }
+      bands.push_back(data + bandsize * band);
+    }
+
+    gdalDataset_ = dataset;
+    memoryBands_.swap(bands);
+    cacheBands();
+    filename_.clear();
+    access_ = GA_Update;
+    nativeDecode_ = false;
+    nb_ = nbands;
+    ns_ = dims.width();
+    nl_ = dims.height();
+    dims_ = RasterDims(0, ns_ - 1, 0, nl_ - 1);
+    cacheGeoTransform();
+  };
+
+  /** Copies a window of a band of an in memory raster straight to or from memory, row by row.  Returns
+   *  false, having copied nothing, unless the raster is in memory, the type matches the band and the
+   *  window lies inside the raster.  This is an internal method.
+   * @param band The band.  This follows GDAL and is 1 based.
+   * @param window The window to copy
+   * @param data The other side of the copy, window.width() x window.height() values of type dt
+   * @param dt The data type of data
+   * @param write Set to true to copy data into the raster
+   */
+  bool copyMemory(int band, const RasterDims& window, void* data, GDALDataType dt, bool write) throw(Exception)
+  {
+    if (memoryBands_.empty() || band < 1 || band > (int)memoryBands_.size() || dataType(band) != dt ||
+        window.startSample() < 0 || window.startLine() < 0 || window.endSample() >= ns_ || window.endLine() >= nl_)
+      return(false);
+
+    long long typesize = GDALGetDataTypeSize(dt) / 8;
+    long long linesize = (long long)window.width() * typesize;
+    char* raster = memoryBands_[band - 1] + ((long long)window.startLine() * ns_ + window.startSample()) * typesize;
+    char* buffer = (char*)data;
+    for (int line=0; line<window.height(); line++)
+    {
+      if (write)
+        memcpy(raster, buffer, linesize);
+      else
+        memcpy(buffer, raster, linesize);
+      raster += (long long)ns_ * typesize;
+      buffer += linesize;
+    }
+    return(true);
+  };
+
+  /** Frees the memory of an in memory raster created by createInMemory.  This is an internal method. */
+  void releaseMemory(void)
+  {
+    memoryBands_.clear();
+    free(memoryStorage_);
+    memoryStorage_ = NULL;
+  };
+
+  /** Caches the geotransform of the open dataset so coordinate transforms do not query GDAL per point. */
+  void cacheGeoTransform(void)
+  {
+    hasGeoTransform_ = (gdalDataset_ && gdalDataset_->GetGeoTransform(geoTransform_) == CE_None);
+    if (!hasGeoTransform_)
+    {
+      //identity transform, map coordinates are image coordinates
+      geoTransform_[0] = 0.0; geoTransform_[1] = 1.0; geoTransform_[2] = 0.0;
+      geoTransform_[3] = 0.0; geoTransform_[4] = 0.0; geoTransform_[5] = 1.0;
+    }
+  };
   
 protected:
 
@@ -66,17 +479,19 @@ protected:
       int xoff = outputDims.startSample() - tileDims.startSample();
       int yoff = outputDims.startLine() - tileDims.startLine();
 
-      T* outData = new T[width*height];
-      T* id = tileData + (yoff * tileWidth);  //wind forward by yoff lines
+      //the subrect is accounted to its own site in the MemoryBudget
+      MemorySite site("DataRaster::writeSubrect");
+      DataBuffer<T> subrect(outputDims, 1, false);
+      T* outData = subrect.data();
+      T* id = tileData + ((long long)yoff * tileWidth);  //wind forward by yoff lines
       for (int yy=0; yy<height; yy++)
       {
-        memcpy((void*)(outData + (yy * width)), //wind forward by yy lines
+        memcpy((void*)(outData + ((long long)yy * width)), //wind forward by yy lines
           (void*)(id + xoff), //start the copy at the xoff pixel
           width * sizeof(T)); //copy width pixels of data
         id += tileWidth; //wind forward by 1 line
       }
       setData(outData, outBand, outputDims, dt);
-      delete[](outData);
     }
   };
   
@@ -92,11 +507,14 @@ protected:
       throw Exception("Null pointer exception");
  
     //grab the band that we need.
-    gdalRasterBand_ = gdalDataset_->GetRasterBand(band);
-    if (!gdalRasterBand_)
+    if (band < 1 || band > (int)bands_.size() || !bands_[band - 1])
       throw Exception("Null pointer exception");
 
-    if (gdalRasterBand_->RasterIO(GF_Write, dims.startSample(), dims.startLine(),
+    if (copyMemory(band, dims, data, dt, true))
+      return;
+
+    Lock lock(&mutex_);
+    if (bands_[band - 1]->RasterIO(GF_Write, dims.startSample(), dims.startLine(),
       dims.width(), dims.height(), data, dims.width(), dims.height(), dt, 0, 0) != 0)
       throw Exception("Error encountered writing data.");  
   };
@@ -110,33 +528,50 @@ public:
  */
   DataRaster(void)
   {
-    GDALAllRegister();
+    registerOnce();
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_mutex_init(&poolMutex_, NULL);
     gdalDataset_ = NULL;
-    gdalRasterBand_ = NULL;
     nl_ = 0;
     ns_ = 0;
     nb_ = 0;
+    access_ = GA_ReadOnly;
+    decodeThreads_ = 1;
+    nativeDecode_ = false;
+    tileCache_ = NULL;
+    memoryStorage_ = NULL;
+    cacheGeoTransform();
   };
 
 /** Destructor.  Takes no arguments.  */
   ~DataRaster(void)
   {
+    closeHandles();
     if (gdalDataset_)
     {
       GDALClose(gdalDataset_);
       gdalDataset_ = NULL;
     }
+    releaseMemory();
+    pthread_mutex_destroy(&poolMutex_);
+    pthread_mutex_destroy(&mutex_);
   };
   
-  /** Opens an existing file
+  /** Opens an existing file.  A raster that is already open is closed first.
    * @param filename Filename of the image file to open.
    * @param gdalMode Access mode for the file
   */
   void open(const std::string& filename, GDALAccess gdalMode) throw (Exception)
   {
-    gdalDataset_ = (GDALDataset *) GDALOpen(filename.c_str(), gdalMode);
+    //the pooled read handles belong to the previous file
+    close();
+    //GDAL 3.6 and later decode the blocks of a single RasterIO request in parallel themselves
+    gdalDataset_ = openHandle(filename, gdalMode, &nativeDecode_);
     if (!gdalDataset_)
       throw Exception(std::string("Unable to open file ") + filename);
+    cacheBands();
+    filename_ = filename;
+    access_ = gdalMode;
     nb_ = gdalDataset_->GetRasterCount();
     ns_ = gdalDataset_->GetRasterXSize();
     nl_ = gdalDataset_->GetRasterYSize();
@@ -144,39 +579,88 @@ public:
     dims_.setEndSample(ns_ - 1);
     dims_.setStartLine(0);
     dims_.setEndLine(nl_ - 1);
+    cacheGeoTransform();
   };
   
   /** Closes a data raster which is currently open
   */
   void close(void)
   {
+    closeHandles();
     if (gdalDataset_)
     {
       GDALClose(gdalDataset_);
       gdalDataset_ = NULL;
-      gdalRasterBand_ = NULL;
+      cacheBands();
       nl_ = 0;
       ns_ = 0;
       nb_ = 0;
+      cacheGeoTransform();
     }
+    releaseMemory();
     
   };
   
+  /** Sets the number of threads used to decode the blocks of a getData request, e.g. for DEFLATE, LZW or
+   *  ZSTD compressed tiled GeoTIFF inputs.  GDAL 3.6 and later decode in parallel themselves through the
+   *  NUM_THREADS open option; with older GDAL each thread reads a group of block rows through its own
+   *  dataset handle.  Only rasters opened read only are decoded in parallel.  An open raster is reopened
+   *  to apply the setting.
+   * @param nthreads The number of threads, 1 to decode serially
+   */
+  void setDecodeThreads(int nthreads) throw(Exception)
+  {
+    decodeThreads_ = (nthreads < 1) ? 1 : nthreads;
+    closeHandles();
+    if (gdalDataset_ && access_ == GA_ReadOnly)
+    {
+      std::string filename = filename_;
+      close();
+      open(filename, GA_ReadOnly);
+    }
+  };
+
+  /** Sets a persistent cache of decoded windows.  getData on a read only raster returns cached windows
+   *  without decoding and stores the windows it decodes.  The cache is not owned and must outlive its use.
+   *  One cache may be shared by several rasters, also while they are read concurrently.
+   * @param cache The cache, or NULL to read through GDAL only
+   */
+  void setTileCache(TileCache* cache) { tileCache_ = cache; };
+
+  /** Returns the number of threads used to decode getData requests */
+  int decodeThreads(void) const { return(decodeThreads_); };
+
+  /** Flushes pending writes of a data raster which is currently open to disk
+  */
+  void flush(void)
+  {
+    Lock lock(&mutex_);
+    if (gdalDataset_)
+      gdalDataset_->FlushCache();
+  };
+  
   /** Creates a new file
    * @param filename Filename of the image file to create
    * @param dims RasterDims object specifying the spatial dimensions of the file
    * @param nbands The number of bands desired in the file
    * @param dataType The GDALDataType of the output file
-   * @param format A valid GDAL format string, e.g. GTiff
+   * @param format A valid GDAL format string, e.g. GTiff.  MEM creates an in memory raster, see createInMemory.
    * @param parent If a valid pointer is passed then the new file will inherit the georeferencing and projection from the parent
+   * @param options Driver specific creation options of the form NAME=VALUE, e.g. SPARSE_OK=TRUE
   */
   void create(const std::string& filename,
               const RasterDims& dims,
               int nbands,
               GDALDataType dataType,
               const std::string& format,
-              const DataRaster* parent = NULL)
+              const DataRaster* parent = NULL,
+              const std::vector<std::string>& options = std::vector<std::string>())
   {
+    if (format == "MEM")
+    {
+      createInMemory(dims, nbands, dataType, parent);
+      return;
+    }
 
     GDALDriver *pDriver;
     pDriver = GetGDALDriverManager()->GetDriverByName(format.c_str());
@@ -190,7 +674,11 @@ public:
 
     int xSize = dims.width();
     int ySize = dims.height();
-    GDALDataset* outputDataset = pDriver->Create(filename.c_str(), xSize, ySize, nbands, dataType, NULL);
+    char** papszOptions = NULL;
+    for (size_t idx=0; idx<options.size(); idx++)
+      papszOptions = CSLAddString(papszOptions, options[idx].c_str());
+    GDALDataset* outputDataset = pDriver->Create(filename.c_str(), xSize, ySize, nbands, dataType, papszOptions);
+    CSLDestroy(papszOptions);
     if (!outputDataset)
       throw Exception(std::string("Creation of file ") + filename + std::string(" failed."));
 
@@ -212,6 +700,76 @@ public:
     open(filename, GA_Update);
   };
 
+  /** Creates a new raster held in memory, e.g. to chain algorithms or serve results without touching the
+   *  filesystem.  The raster is open for update and zero filled, and lives until it is closed.  getData
+   *  and setData copy straight to and from its memory when the requested type matches the band, and
+   *  view() gives direct access to a band.
+   * @param dims RasterDims object specifying the spatial dimensions of the raster
+   * @param nbands The number of bands
+   * @param dataType The GDALDataType of the raster
+   * @param parent If a valid pointer is passed then the new raster will inherit the georeferencing and projection from the parent
+   */
+  void createInMemory(const RasterDims& dims, int nbands, GDALDataType dataType, const DataRaster* parent = NULL) throw(Exception)
+  {
+    if (dims.width() <= 0 || dims.height() <= 0 || nbands <= 0)
+      throw Exception("DataRaster::createInMemory Error: invalid dimensions.");
+    close();
+    size_t nbytes = (size_t)dims.width() * dims.height() * nbands * (GDALGetDataTypeSize(dataType) / 8);
+    memoryStorage_ = (char*)calloc(nbytes, 1);
+    if (!memoryStorage_)
+      throw Exception("DataRaster::createInMemory Error: out of memory.");
+    try
+    {
+      attachMemory(memoryStorage_, dims, nbands, dataType);
+    }
+    catch (...)
+    {
+      releaseMemory();
+      throw;
+    }
+
+    if (parent && parent->gdalDataset_)
+    {
+      double adfGeoTransform[6];
+      if (parent->gdalDataset_->GetGeoTransform(adfGeoTransform) == CE_None)
+        gdalDataset_->SetGeoTransform(adfGeoTransform);
+      if (parent->gdalDataset_->GetProjectionRef() != NULL)
+        gdalDataset_->SetProjection(parent->gdalDataset_->GetProjectionRef());
+      cacheGeoTransform();
+    }
+  };
+
+  /** Opens the memory of a DataBuffer as a raster without copying it.  Writes to the raster change the
+   *  buffer and the other way round.  The raster covers width() x height() pixels from (0, 0) whatever the
+   *  origin of the buffer's dims.  The buffer must outlive the raster and must not be spillable.
+   * @param buf The buffer
+   * @param dataType The GDALDataType matching T
+   */
+  template <typename T> void wrap(DataBuffer<T>& buf, GDALDataType dataType) throw(Exception)
+  {
+    if (GDALGetDataTypeSize(dataType) / 8 != (int)sizeof(T))
+      throw Exception("DataRaster::wrap Error: dataType does not match the buffer type.");
+    close();
+    attachMemory((char*)buf.data(), RasterDims(0, buf.dims().width() - 1, 0, buf.dims().height() - 1), buf.nbands(), dataType);
+  };
+
+  /** Returns a view of a band of an in memory raster, see createInMemory and wrap.
+   * @param band The band.  This follows GDAL and is 1 based.
+   */
+  template <typename T> DataView<T> view(int band = 1) throw(Exception)
+  {
+    if (memoryBands_.empty())
+      throw Exception("DataRaster::view Error: the raster is not in memory.");
+    if (band < 1 || band > nb_)
+      throw Exception("DataRaster::view Error: band does not exist.");
+    if (GDALGetDataTypeSize(dataType(band)) / 8 != (int)sizeof(T))
+      throw Exception("DataRaster::view Error: the type does not match the band.");
+    return(DataView<T>((T*)memoryBands_[band - 1], ns_, nl_, ns_));
+  };
+
+  /** Returns true if the raster is held in memory, see createInMemory and wrap. */
+  bool inMemory(void) const { return(!memoryBands_.empty()); };
+
   
 
 /** Retrieves data from the image.
@@ -228,20 +786,123 @@ public:
     if (bufferBand > buf.nbands() - 1)
       throw Exception("DataRaster::getData(): Error: bufferBand exceeds dimensions of buffer.");
 
-    //grab the band that we need.
-    gdalRasterBand_ = gdalDataset_->GetRasterBand(imageband);
-    if (!gdalRasterBand_)
+    //check the band that we need.
+    if (imageband < 1 || imageband > (int)bands_.size() || !bands_[imageband - 1])
        throw Exception("DataRaster::getData Error: bandPtr is NULL.");
 
     int xSize = buf.dims().width();
     int ySize = buf.dims().height();
-    int sz = xSize * ySize;
+    long long sz = (long long)xSize * ySize;
     
     T* bufdata = buf.data();
 
-    if (gdalRasterBand_->RasterIO(GF_Read, buf.dims().startSample(), buf.dims().startLine(), 
-      xSize, ySize, (void*)(bufdata + sz * bufferBand), xSize, ySize, dataType, 0, 0) != 0)
-      throw Exception("DataRaster::getData Error: RasterIO returned an error");
+    //windows of read only rasters are served from the tile cache when it holds them
+    std::string cacheKey;
+    unsigned long long nbytes = (unsigned long long)sz * (GDALGetDataTypeSize(dataType) / 8);
+    if (tileCache_ && access_ == GA_ReadOnly)
+    {
+      cacheKey = TileCache::key(filename_, imageband, buf.dims(), (int)dataType);
+      if (!cacheKey.empty() && tileCache_->get(cacheKey, (void*)(bufdata + sz * bufferBand), nbytes))
+        return;
+    }
+
+    if (copyMemory(imageband, buf.dims(), (void*)(bufdata + sz * bufferBand), dataType, false))
+      return;
+
+    if (!readParallel(imageband, buf.dims(), (void*)(bufdata + sz * bufferBand), dataType))
+      readWindow(imageband, buf.dims(), (void*)(bufdata + sz * bufferBand), dataType);
+
+    if (!cacheKey.empty())
+      tileCache_->put(cacheKey, (const void*)(bufdata + sz * bufferBand), nbytes);
+  };
+
+  /** Returns the dimensions of a preview of the raster whose longer side is at most maxsize pixels.  The
+   *  aspect ratio is kept, and a raster smaller than maxsize is previewed at full resolution.
+   * @param maxsize The size in pixels of the longer side of the preview
+   */
+  RasterDims previewDims(int maxsize) const throw(Exception)
+  {
+    if (maxsize < 1 || ns_ < 1 || nl_ < 1)
+      throw Exception("DataRaster::previewDims Error: invalid preview size.");
+    double scale = (double)maxsize / (double)((ns_ > nl_) ? ns_ : nl_);
+    scale = (scale > 1.0) ? 1.0 : scale;
+    int width = (int)floor((double)ns_ * scale + 0.5);
+    int height = (int)floor((double)nl_ * scale + 0.5);
+    return(RasterDims(0, ((width < 1) ? 1 : width) - 1, 0, ((height < 1) ? 1 : height) - 1));
+  };
+
+  /** Returns the pixels of the raster covered by a window of a preview grid, see getPreview.
+   * @param window The window of the preview grid
+   * @param previewDims The dimensions of the preview grid
+   */
+  RasterDims previewSourceDims(const RasterDims& window, const RasterDims& previewDims) const
+  {
+    double scalex = (double)ns_ / (double)previewDims.width(), scaley = (double)nl_ / (double)previewDims.height();
+    int startSample = (int)floor(window.startSample() * scalex), startLine = (int)floor(window.startLine() * scaley);
+    int endSample = (int)ceil((window.endSample() + 1) * scalex - 1e-9) - 1, endLine = (int)ceil((window.endLine() + 1) * scaley - 1e-9) - 1;
+    return(RasterDims(startSample, (endSample > ns_ - 1) ? ns_ - 1 : endSample, startLine, (endLine > nl_ - 1) ? nl_ - 1 : endLine));
+  };
+
+/** Retrieves data from the image at reduced resolution, the preview mode of getData.  The raster is
+ *  treated as a grid of previewDims pixels, e.g. from previewDims(), and buf receives the window of that
+ *  grid given by its dims, so a preview can be read whole or tile by tile, see DataRasterIterator.
+ *  The data is read from the coarsest overview that still has the resolution of the preview, or from the
+ *  band itself with a decimated read, and reduced with the chosen resampling.  Only the pixels needed
+ *  are decoded, so a preview of a large raster with overviews takes milliseconds.
+ * @param buf Reference to a DataBuffer object, with dims inside previewDims
+ * @param previewDims The dimensions of the preview grid.  They may not exceed the dimensions of the raster.
+ * @param imageband An integer specifying which band to read from the image.  This follows GDAL and is 1 based.
+ * @param dataType The type of the data to read from the image
+ * @param resampling The resampling, e.g. GRIORA_Average or GRIORA_NearestNeighbour for the fastest reads
+ * @param bufferBand An integer designating the target band for the DataBuffer object.  This is a zero based index.
+ */
+  template <typename T> void getPreview(DataBuffer<T>& buf, const RasterDims& previewDims, int imageband, GDALDataType dataType,
+    GDALRIOResampleAlg resampling = GRIORA_Average, int bufferBand = 0) throw(Exception)
+  {
+    if (!gdalDataset_)
+      throw Exception("DataRaster::getPreview Error: gdalDataset_ object is NULL.");
+    if (bufferBand > buf.nbands() - 1)
+      throw Exception("DataRaster::getPreview Error: bufferBand exceeds dimensions of buffer.");
+    if (previewDims.width() > ns_ || previewDims.height() > nl_ || previewDims.width() < 1 || previewDims.height() < 1)
+      throw Exception("DataRaster::getPreview Error: the preview may not be larger than the raster.");
+    const RasterDims& window = buf.dims();
+    if (window.startSample() < 0 || window.startLine() < 0 || window.endSample() >= previewDims.width() || window.endLine() >= previewDims.height())
+      throw Exception("DataRaster::getPreview Error: buffer is outside the preview.");
+
+    double scalex = (double)ns_ / (double)previewDims.width(), scaley = (double)nl_ / (double)previewDims.height();
+    double source[4] = { window.startSample() * scalex, window.startLine() * scaley, window.width() * scalex, window.height() * scaley };
+    readPreview(imageband, source, window.width(), window.height(), (void*)(buf.data() + window.npixels() * bufferBand), dataType, resampling);
+  };
+
+  /** Builds overviews of every band, so previews read few pixels, see getPreview.  A raster opened read
+   *  only gets an external .ovr file.
+   * @param factors The reduction factors, e.g. 2, 4, 8 and 16
+   * @param resampling The GDAL resampling name, e.g. "AVERAGE" or "NEAREST"
+   */
+  void buildOverviews(const std::vector<int>& factors, const std::string& resampling = "AVERAGE") throw(Exception)
+  {
+    if (!gdalDataset_)
+      throw Exception("DataRaster::buildOverviews Error: gdalDataset_ object is NULL.");
+    if (factors.empty())
+      return;
+    std::vector<int> levels(factors);
+    {
+      Lock lock(&mutex_);
+      if (gdalDataset_->BuildOverviews(resampling.c_str(), (int)levels.size(), &levels[0], 0, NULL, NULL, NULL) != CE_None)
+        throw Exception("DataRaster::buildOverviews Error: unable to build the overviews.");
+    }
+
+    //pooled read handles were opened before the overviews existed
+    closeHandles();
+  };
+
+  /** Returns the number of overviews of a band.
+   * @param band The band to query.  This follows GDAL and is 1 based.
+   */
+  int overviewCount(int band = 1) const throw(Exception)
+  {
+    Lock lock(&mutex_);
+    return(rasterBand(band)->GetOverviewCount());
   };
 
   /** Writes data to the image.
@@ -256,10 +917,88 @@ public:
     if (bufferBand > buf.nbands() - 1)
       throw Exception("DataRaster::setData(): Error: bufferBand exceeds dimensions of buffer.");
 
-    T* bandData = buf.data() + buf.dims().width() *  buf.dims().height() * bufferBand;
+    T* bandData = buf.data() + buf.dims().npixels() * bufferBand;
     writeSubrect(bandData, buf.dims(), outputDims, outputBand, dataType);
   };
 
+/** Retrieves data from the image into a half precision buffer.  GDAL Float16 is read directly where
+ *  GDAL supports it (3.11 and later); otherwise the data is read as Float32 a block of lines at a time
+ *  and converted.
+ * @param buf Reference to a DataBuffer object
+ * @param imageband An integer specifying which band to read from the image.  This follows GDAL and is 1 based.
+ * @param dataType Ignored, the data is always converted to half precision
+ * @param bufferBand An integer designating the target band for the DataBuffer object.  This is a zero based index.
+ */
+  void getData(DataBuffer<float16>& buf, int imageband, GDALDataType dataType, int bufferBand = 0) throw (Exception)
+  {
+    (void)dataType;
+    if (bufferBand > buf.nbands() - 1)
+      throw Exception("DataRaster::getData(): Error: bufferBand exceeds dimensions of buffer.");
+    Lock lock(&mutex_);
+    GDALRasterBand* gdalRasterBand = rasterBand(imageband);
+
+    int xSize = buf.dims().width();
+    int ySize = buf.dims().height();
+    float16* bufdata = buf.data() + (long long)xSize * ySize * bufferBand;
+
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3110000
+    if (gdalRasterBand->RasterIO(GF_Read, buf.dims().startSample(), buf.dims().startLine(),
+      xSize, ySize, (void*)bufdata, xSize, ySize, GDT_Float16, 0, 0) != 0)
+      throw Exception("DataRaster::getData Error: RasterIO returned an error");
+#else
+    int chunkLines = (1 << 18) / xSize + 1;
+    std::vector<float> scratch((long long)xSize * (chunkLines < ySize ? chunkLines : ySize));
+    for (int line=0; line<ySize; line+=chunkLines)
+    {
+      int nlines = (line + chunkLines > ySize) ? ySize - line : chunkLines;
+      if (gdalRasterBand->RasterIO(GF_Read, buf.dims().startSample(), buf.dims().startLine() + line,
+        xSize, nlines, (void*)&scratch[0], xSize, nlines, GDT_Float32, 0, 0) != 0)
+        throw Exception("DataRaster::getData Error: RasterIO returned an error");
+      float16::fromFloat(&scratch[0], bufdata + (long long)line * xSize, (long long)xSize * nlines);
+    }
+#endif
+  };
+
+  /** Writes data from a half precision buffer to the image.  GDAL Float16 is written directly where
+   *  GDAL supports it (3.11 and later); otherwise the data is converted to Float32 a block of lines at a time.
+   *  A Float32 GeoTIFF created with the NBITS=16 option stores the values at half precision on disk.
+   * @param buf Reference to a DataBuffer object
+   * @param outputDims The rectangle to write to in the image
+   * @param outputBand An integer specifying which band to write to in the image.  This follows GDAL and is 1 based.
+   * @param dataType Ignored, the data is always converted from half precision
+   * @param bufferBand An integer designating the target band for the DataBuffer object.  This is a zero based index.
+   */
+  void setData(DataBuffer<float16>& buf, const RasterDims& outputDims,
+      int outputBand, GDALDataType dataType, int bufferBand = 0) throw (Exception)
+  {
+    (void)dataType;
+    if (bufferBand > buf.nbands() - 1)
+      throw Exception("DataRaster::setData(): Error: bufferBand exceeds dimensions of buffer.");
+
+    int tileWidth = buf.dims().width();
+    float16* bandData = buf.data() + (long long)tileWidth * buf.dims().height() * bufferBand;
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3110000
+    writeSubrect(bandData, buf.dims(), outputDims, outputBand, GDT_Float16);
+#else
+    int width = outputDims.width();
+    int height = outputDims.height();
+    int xoff = outputDims.startSample() - buf.dims().startSample();
+    int yoff = outputDims.startLine() - buf.dims().startLine();
+    int chunkLines = (1 << 18) / width + 1;
+    std::vector<float> scratch((long long)width * (chunkLines < height ? chunkLines : height));
+    for (int line=0; line<height; line+=chunkLines)
+    {
+      int nlines = (line + chunkLines > height) ? height - line : chunkLines;
+      for (int yy=0; yy<nlines; yy++)
+        float16::toFloat(bandData + (long long)(yoff + line + yy) * tileWidth + xoff,
+          &scratch[0] + (long long)yy * width, width);
+      RasterDims chunkDims(outputDims.startSample(), outputDims.endSample(),
+        outputDims.startLine() + line, outputDims.startLine() + line + nlines - 1);
+      setData((void*)&scratch[0], outputBand, chunkDims, GDT_Float32);
+    }
+#endif
+  };
+
   /** Retrieve the bounds/extents of the image.
    * @param ulx Reference to upper left corner x coordinate
    * @param uly Reference to upper left corner y coordinate
@@ -287,15 +1026,185 @@ public:
   {
     double dsample = static_cast<double>(sample);
     double dline = static_cast<double>(line);
-    double adfGeoTransform[6];
-    if (gdalDataset_->GetGeoTransform(adfGeoTransform) == CE_None)
+    *mapSample = geoTransform_[0] + dsample * geoTransform_[1] + dline * geoTransform_[2];
+    *mapLine = geoTransform_[3] + dsample * geoTransform_[4] + dline * geoTransform_[5];
+  };
+
+  /** Converts a batch of image coordinates to map coordinates.  The transform is applied in place.
+  * @param npoints The number of points to transform
+  * @param x On input the column coordinates, on output the map x coordinates
+  * @param y On input the row coordinates, on output the map y coordinates
+  */
+  void imageToMap(int npoints, double* x, double* y) const
+  {
+    const double* gt = geoTransform_;
+    for (int idx=0; idx<npoints; idx++)
     {
-      *mapSample = adfGeoTransform[0] + dsample * adfGeoTransform[1] + dline * adfGeoTransform[2];
-      *mapLine = adfGeoTransform[3] + dsample * adfGeoTransform[4] + dline * adfGeoTransform[5];
-      return;
+      double dsample = x[idx];
+      double dline = y[idx];
+      x[idx] = gt[0] + dsample * gt[1] + dline * gt[2];
+      y[idx] = gt[3] + dsample * gt[4] + dline * gt[5];
+    }
+  };
+
+  /** Converts a batch of map coordinates to image coordinates.  The transform is applied in place.
+  * @param npoints The number of points to transform
+  * @param x On input the map x coordinates, on output the column coordinates
+  * @param y On input the map y coordinates, on output the row coordinates
+  */
+  void mapToImage(int npoints, double* x, double* y) const throw(Exception)
+  {
+    const double* gt = geoTransform_;
+    double det = gt[1] * gt[5] - gt[2] * gt[4];
+    if (det == 0.0)
+      throw Exception("DataRaster::mapToImage Error: geotransform is not invertible");
+    double inv1 = gt[5] / det, inv2 = -gt[2] / det;
+    double inv4 = -gt[4] / det, inv5 = gt[1] / det;
+    for (int idx=0; idx<npoints; idx++)
+    {
+      double dx = x[idx] - gt[0];
+      double dy = y[idx] - gt[3];
+      x[idx] = dx * inv1 + dy * inv2;
+      y[idx] = dx * inv4 + dy * inv5;
     }
-    *mapSample = dsample;
-    *mapLine = dline;
+  };
+
+  /** Copies the geotransform of this DataRaster.  Returns false if the file has no georeferencing.
+  * @param geoTransform Array of 6 doubles in GDAL geotransform order
+  */
+  bool getGeoTransform(double* geoTransform) const
+  {
+    memcpy(geoTransform, geoTransform_, 6 * sizeof(double));
+    return(hasGeoTransform_);
+  };
+
+  /** Sets the geotransform of this DataRaster.  The raster must be open for update.
+  * @param geoTransform Array of 6 doubles in GDAL geotransform order
+  */
+  void setGeoTransform(const double* geoTransform) throw(Exception)
+  {
+    if (!gdalDataset_)
+      throw Exception("DataRaster::setGeoTransform Error: gdalDataset_ object is NULL.");
+    double gt[6];
+    memcpy(gt, geoTransform, 6 * sizeof(double));
+    Lock lock(&mutex_);
+    if (gdalDataset_->SetGeoTransform(gt) != CE_None)
+      throw Exception("DataRaster::setGeoTransform Error: unable to set geotransform.");
+    cacheGeoTransform();
+  };
+
+  /** Returns the projection of this DataRaster as WKT.  The string is empty if there is no projection. */
+  std::string projection(void) const
+  {
+    Lock lock(&mutex_);
+    if (!gdalDataset_ || !gdalDataset_->GetProjectionRef())
+      return(std::string());
+    return(std::string(gdalDataset_->GetProjectionRef()));
+  };
+
+  /** Sets the projection of this DataRaster.  The raster must be open for update.
+  * @param wkt The projection as a WKT string
+  */
+  void setProjection(const std::string& wkt) throw(Exception)
+  {
+    if (!gdalDataset_)
+      throw Exception("DataRaster::setProjection Error: gdalDataset_ object is NULL.");
+    Lock lock(&mutex_);
+    if (gdalDataset_->SetProjection(wkt.c_str()) != CE_None)
+      throw Exception("DataRaster::setProjection Error: unable to set projection.");
+  };
+
+  /** Returns the nodata value of a band.
+  * @param band The band to query.  This follows GDAL and is 1 based.
+  * @param hasNoData If not NULL, set to true if the band has a nodata value
+  */
+  double noDataValue(int band = 1, bool* hasNoData = NULL) const throw(Exception)
+  {
+    Lock lock(&mutex_);
+    GDALRasterBand* gdalRasterBand = rasterBand(band);
+    int ok = 0;
+    double val = gdalRasterBand->GetNoDataValue(&ok);
+    if (hasNoData)
+      *hasNoData = (ok != 0);
+    return(val);
+  };
+
+  /** Sets the nodata value of a band.  The raster must be open for update.
+  * @param val The nodata value
+  * @param band The band to modify.  This follows GDAL and is 1 based.
+  */
+  void setNoDataValue(double val, int band = 1) throw(Exception)
+  {
+    Lock lock(&mutex_);
+    if (rasterBand(band)->SetNoDataValue(val) != CE_None)
+      throw Exception("DataRaster::setNoDataValue Error: unable to set the nodata value.");
+  };
+
+  /** Returns the number of significant bits of a band.  This is the NBITS value declared in the
+  *   IMAGE_STRUCTURE metadata, e.g. for 11 or 12 bit sensor data stored as UInt16, or the size of the
+  *   data type when none is declared.
+  * @param band The band to query.  This follows GDAL and is 1 based.
+  */
+  int bitDepth(int band = 1) const throw(Exception)
+  {
+    Lock lock(&mutex_);
+    GDALRasterBand* gdalRasterBand = rasterBand(band);
+    int typeBits = GDALGetDataTypeSize(gdalRasterBand->GetRasterDataType());
+    const char* nbits = gdalRasterBand->GetMetadataItem("NBITS", "IMAGE_STRUCTURE");
+    int bits = nbits ? atoi(nbits) : 0;
+    return((bits > 0 && bits < typeBits) ? bits : typeBits);
+  };
+
+  /** Retrieves the scale and offset of a band, value = stored * scale + offset.
+  * @param scale Reference to the scale
+  * @param offset Reference to the offset
+  * @param band The band to query.  This follows GDAL and is 1 based.
+  */
+  void getScaleOffset(double& scale, double& offset, int band = 1) const throw(Exception)
+  {
+    Lock lock(&mutex_);
+    GDALRasterBand* gdalRasterBand = rasterBand(band);
+    scale = gdalRasterBand->GetScale();
+    offset = gdalRasterBand->GetOffset();
+  };
+
+  /** Sets the scale and offset of a band, value = stored * scale + offset.  The raster must be open for update.
+  * @param scale The scale
+  * @param offset The offset
+  * @param band The band to modify.  This follows GDAL and is 1 based.
+  */
+  void setScaleOffset(double scale, double offset, int band = 1) throw(Exception)
+  {
+    Lock lock(&mutex_);
+    GDALRasterBand* gdalRasterBand = rasterBand(band);
+    if (gdalRasterBand->SetScale(scale) != CE_None || gdalRasterBand->SetOffset(offset) != CE_None)
+      throw Exception("DataRaster::setScaleOffset Error: unable to set the scale and offset.");
+  };
+
+  /** Reports whether a region of a band is backed by stored data.  Formats such as sparse GeoTIFF
+  * leave blocks that were never written empty, and reading them returns the nodata value.
+  * @param dims The region to query
+  * @param band The band to query.  This follows GDAL and is 1 based.
+  */
+  DataCoverage coverage(const RasterDims& dims, int band = 1) const throw(Exception)
+  {
+    Lock lock(&mutex_);
+    GDALRasterBand* gdalRasterBand = rasterBand(band);
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 2020000
+    int status = gdalRasterBand->GetDataCoverageStatus(dims.startSample(), dims.startLine(),
+      dims.width(), dims.height(), 0, NULL);
+    if (status & GDAL_DATA_COVERAGE_STATUS_UNIMPLEMENTED)
+      return(DataCoverageUnknown);
+    if ((status & GDAL_DATA_COVERAGE_STATUS_DATA) && (status & GDAL_DATA_COVERAGE_STATUS_EMPTY))
+      return(DataCoveragePartial);
+    if (status & GDAL_DATA_COVERAGE_STATUS_EMPTY)
+      return(DataCoverageEmpty);
+    return(DataCoverageFull);
+#else
+    (void)gdalRasterBand;
+    (void)dims;
+    return(DataCoverageUnknown);
+#endif
   };
 
   /** Returns the number of samples (columns) for this DataRaster. */
@@ -315,11 +1224,9 @@ public:
   {
     if (!gdalDataset_)
       throw Exception("DataRaster::dataType(): Error: null pointer exception");
-    GDALRasterBand* gdalRasterBand = gdalDataset_->GetRasterBand(band);
-    if (!gdalRasterBand)
+    if (band < 1 || band > (int)types_.size())
       throw Exception("DataRaster::dataType(): Error: null pointer exception");
-    GDALDataType dataType = gdalRasterBand->GetRasterDataType();
-    return(dataType);
+    return(types_[band - 1]);
   };
 };
 
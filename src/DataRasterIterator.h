@@ -76,6 +76,14 @@ private:
         return (sizeof(d));
         break;
       }
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3110000
+      case (GDT_Float16):
+      {
+        float16 h;
+        return (sizeof(h));
+        break;
+      }
+#endif
       default:
         throw Exception("DataRasterIterator::getDataTypeSize Error: data type not implemented");
         break;
@@ -84,31 +92,28 @@ private:
   };
 
 
+  const DataRaster* source_;
   int lineChunkSize_;
   int nTiles_;
   int ns_;
   int nl_;
   int overlap_;
+  RasterDims previewDims_;
+  bool preview_;
 
-public:
-
-  /** Constructor
-   * @param source DataRaster object representing the raster to be iterated over.
-   * @param memsize The memsize in bytes of the desired chunk size
-   * @param overlap The desired overlap in pixels between adjacent tiles
-   * @param mode The desired tiling mode for iterating over the raster
-   */
-  DataRasterIterator(const DataRaster& source, int memsize, int overlap, TilingMode mode = TilingModeSingleBand) throw (Exception)
+  /** Divides the lines into tiles of memsize bytes.  This is an internal method. */
+  void initialize(long long memsize, int overlap, TilingMode mode) throw(Exception)
   {
-    ns_ = source.nsamples();
-    nl_ = source.nlines();
     overlap_ = overlap;
-    int dtSize = getDataTypeSize(source.dataType());
+    int dtSize = getDataTypeSize(source_->dataType());
 
     // Determine tile size by taking memsize and overlap into account.  Scanline tiling.
-    lineChunkSize_ = (int)ceil(memsize / ((double)ns_ * (double)dtSize));
+    // The line count is limited before it is converted to int, so memsizes of many GB cannot overflow it.
+    double lines = ceil((double)memsize / ((double)ns_ * (double)dtSize));
     if (mode == TilingModeAllBands)
-      lineChunkSize_ /= (double)(source.nbands());
+      lines = floor(lines / (double)(source_->nbands()));
+    lines = (lines > (double)nl_ + 2.0 * overlap) ? (double)nl_ + 2.0 * overlap : lines;
+    lineChunkSize_ = (int)lines;
 
     if (lineChunkSize_ - (2 * overlap) <= 0)
     {
@@ -126,7 +131,43 @@ public:
       lineChunkSize_ = nl_;
     }
     nTiles_ = (int)ceil((double)nl_ / (double)lineChunkSize_);
+  };
+
+public:
 
+  /** Constructor
+   * @param source DataRaster object representing the raster to be iterated over.
+   * @param memsize The memsize in bytes of the desired chunk size
+   * @param overlap The desired overlap in pixels between adjacent tiles
+   * @param mode The desired tiling mode for iterating over the raster
+   */
+  DataRasterIterator(const DataRaster& source, long long memsize, int overlap, TilingMode mode = TilingModeSingleBand) throw (Exception)
+    : previewDims_(source.dims()), preview_(false)
+  {
+    source_ = &source;
+    ns_ = source.nsamples();
+    nl_ = source.nlines();
+    initialize(memsize, overlap, mode);
+  };
+
+  /** Constructor for iterating over a preview of a raster.  The tiles are windows of the preview grid,
+   *  to be read with DataRaster::getPreview.
+   * @param source DataRaster object representing the raster to be iterated over.
+   * @param previewDims The dimensions of the preview grid, e.g. from DataRaster::previewDims
+   * @param memsize The memsize in bytes of the desired chunk size
+   * @param overlap The desired overlap in pixels of the preview between adjacent tiles
+   * @param mode The desired tiling mode for iterating over the raster
+   */
+  DataRasterIterator(const DataRaster& source, const RasterDims& previewDims, long long memsize, int overlap = 0,
+    TilingMode mode = TilingModeSingleBand) throw (Exception)
+    : previewDims_(0, previewDims.width() - 1, 0, previewDims.height() - 1), preview_(true)
+  {
+    if (previewDims.width() < 1 || previewDims.height() < 1 || previewDims.width() > source.nsamples() || previewDims.height() > source.nlines())
+      throw Exception("DataRasterIterator: Error: the preview may not be larger than the raster.");
+    source_ = &source;
+    ns_ = previewDims.width();
+    nl_ = previewDims.height();
+    initialize(memsize, overlap, mode);
   };
   
   /** Destructor */
@@ -165,9 +206,72 @@ public:
     }
   };
 
+  /** Reports whether the input region of a tile contains any stored data, combined over all bands.
+   *  Tiles reported as DataCoverageEmpty can be skipped without reading.
+   * @param tileNum The tile number to be queried
+   */
+  DataCoverage tileCoverage(int tileNum) throw(Exception)
+  {
+    RasterDims tiledims;
+    getTileDims(tileNum, tiledims);
+    if (preview_)
+      tiledims = source_->previewSourceDims(tiledims, previewDims_);
+    bool anyData = false, anyEmpty = false;
+    for (int band=1; band<=source_->nbands(); band++)
+    {
+      DataCoverage cov = source_->coverage(tiledims, band);
+      if (cov == DataCoverageUnknown)
+        return(DataCoverageUnknown);
+      anyData |= (cov != DataCoverageEmpty);
+      anyEmpty |= (cov != DataCoverageFull);
+    }
+    if (!anyData)
+      return(DataCoverageEmpty);
+    return(anyEmpty ? DataCoveragePartial : DataCoverageFull);
+  };
+
+  /** Splits the tiles into nshards contiguous ranges of near equal size and returns the range of one shard.
+   *  firstTile is greater than lastTile when the shard has no tiles.
+   * @param shard The zero based shard number
+   * @param nshards The number of shards
+   * @param firstTile The first tile of the shard
+   * @param lastTile The last tile of the shard
+   */
+  void getShardTiles(int shard, int nshards, int& firstTile, int& lastTile) throw(Exception)
+  {
+    if (nshards < 1 || shard < 0 || shard >= nshards)
+      throw Exception("DataRasterIterator::getShardTiles Error: invalid shard.");
+    firstTile = (int)(((long long)nTiles_ * shard) / nshards);
+    lastTile = (int)(((long long)nTiles_ * (shard + 1)) / nshards) - 1;
+  };
+
+  /** Returns the output region covered by the tiles of one shard.  Returns false if the shard has no tiles.
+   * @param shard The zero based shard number
+   * @param nshards The number of shards
+   * @param shard_dims The region of the shard
+   */
+  bool getShardDims(int shard, int nshards, RasterDims& shard_dims) throw(Exception)
+  {
+    int firstTile, lastTile;
+    getShardTiles(shard, nshards, firstTile, lastTile);
+    if (firstTile > lastTile)
+      return(false);
+    RasterDims input, first, last;
+    getTileDims(firstTile, input, &first);
+    getTileDims(lastTile, input, &last);
+    shard_dims = RasterDims(first.startSample(), first.endSample(), first.startLine(), last.endLine());
+    return(true);
+  };
+
   /** Returns the number of tiles for this source raster */
   int ntiles(void) { return(nTiles_); };
 
+  /** Returns true if the tiles are windows of a preview grid, see DataRaster::getPreview */
+  bool preview(void) const { return(preview_); };
+
+  /** Returns the dimensions of the grid the tiles cover: the preview grid, or the dimensions of the source raster */
+  const RasterDims& previewDims(void) const { return(previewDims_); };
+
   /** Returns the overlap in pixels between adjacent tiles for this source raster */
   int overlap(void) { return(overlap_); };
 
@@ -0,0 +1,144 @@
+#ifndef _DATAVIEWH_
+#define _DATAVIEWH_
+//================================================================
+//
+// File: DataView.h
+// Created: 10/19/2026
+// Purpose: Lightweight non-owning views into DataBuffer memory
+//
+//================================================================
+
+#include "Exception.h"
+
+/** Bounds checks on view accesses are compiled in for debug builds only.  Define
+ *  DATAVIEW_CHECKED to keep them in a release (NDEBUG) build.
+ */
+#if !defined(NDEBUG) || defined(DATAVIEW_CHECKED)
+#define DATAVIEW_CHECK(cond, msg) if (!(cond)) throw Exception(msg)
+#else
+#define DATAVIEW_CHECK(cond, msg)
+#endif
+
+/** RowView: a non-owning view of a contiguous run of elements, e.g. one row or one whole band.
+ *  The iterators are plain pointers, so loops over a row vectorize like loops over a raw array.
+ *  A view does not keep its buffer alive and is invalid once the buffer is destroyed.
+ */
+template <typename T> class RowView
+{
+
+private:
+
+  T* data_;
+  long long size_;
+
+public:
+
+  typedef T value_type;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  /** Constructor.
+   * @param data The first element
+   * @param size The number of elements
+   */
+  RowView(T* data, long long size) : data_(data), size_(size) {};
+
+  /** operator [], checked in debug builds only */
+  inline T& operator[](long long idx) const
+  {
+    DATAVIEW_CHECK(idx >= 0 && idx < size_, "RowView: Error: out of bounds index attempt");
+    return(data_[idx]);
+  };
+
+  /** Returns the number of elements */
+  long long size(void) const { return(size_); };
+
+  /** Returns a pointer to the first element */
+  T* data(void) const { return(data_); };
+
+  /** Returns an iterator to the first element */
+  iterator begin(void) const { return(data_); };
+
+  /** Returns an iterator one past the last element */
+  iterator end(void) const { return(data_ + size_); };
+
+};
+
+/** DataView: a non-owning 2D view of a band or a window of a band.  Rows are contiguous and
+ *  separated by a stride, in elements, which is the width of the underlying buffer.
+ *  A view does not keep its buffer alive and is invalid once the buffer is destroyed.
+ */
+template <typename T> class DataView
+{
+
+private:
+
+  T* data_;
+  long long width_, height_, stride_;
+
+public:
+
+  typedef T value_type;
+
+  /** Constructor.
+   * @param data The top left element
+   * @param width The width of the view in elements
+   * @param height The height of the view in rows
+   * @param stride The distance between the starts of adjacent rows, in elements
+   */
+  DataView(T* data, long long width, long long height, long long stride)
+    : data_(data), width_(width), height_(height), stride_(stride) {};
+
+  /** Element access by row and column, checked in debug builds only */
+  inline T& operator()(long long row, long long col) const
+  {
+    DATAVIEW_CHECK(row >= 0 && row < height_ && col >= 0 && col < width_,
+      "DataView: Error: out of bounds index attempt");
+    return(data_[row * stride_ + col]);
+  };
+
+  /** Returns a view of one row */
+  inline RowView<T> row(long long row) const
+  {
+    DATAVIEW_CHECK(row >= 0 && row < height_, "DataView::row Error: out of bounds row");
+    return(RowView<T>(data_ + row * stride_, width_));
+  };
+
+  /** Returns true if the rows follow each other without gaps */
+  bool contiguous(void) const { return(stride_ == width_ || height_ <= 1); };
+
+  /** Returns the whole view as a single run of elements.  The view must be contiguous. */
+  RowView<T> flat(void) const throw(Exception)
+  {
+    if (!contiguous())
+      throw Exception("DataView::flat Error: view is not contiguous");
+    return(RowView<T>(data_, width_ * height_));
+  };
+
+  /** Returns a view of a window of this view.
+   * @param col The first column of the window, relative to this view
+   * @param row The first row of the window, relative to this view
+   * @param width The width of the window
+   * @param height The height of the window
+   */
+  DataView<T> window(long long col, long long row, long long width, long long height) const throw(Exception)
+  {
+    if (col < 0 || row < 0 || width < 0 || height < 0 || col + width > width_ || row + height > height_)
+      throw Exception("DataView::window Error: window exceeds dimensions of view");
+    return(DataView<T>(data_ + row * stride_ + col, width, height, stride_));
+  };
+
+  /** Returns the width in elements */
+  long long width(void) const { return(width_); };
+
+  /** Returns the height in rows */
+  long long height(void) const { return(height_); };
+
+  /** Returns the row stride in elements */
+  long long stride(void) const { return(stride_); };
+
+  /** Returns a pointer to the top left element */
+  T* data(void) const { return(data_); };
+
+};
+#endif
@@ -0,0 +1,167 @@
+#ifndef _FLOAT16H_
+#define _FLOAT16H_
+//================================================================
+//
+// File: Float16.h
+// Created: 10/19/2026
+// Purpose: An IEEE 754 half precision pixel type
+//
+//================================================================
+
+#include <string.h>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+/** float16: an IEEE 754 binary16 value for storing pixels at half the size of a float.
+ *  Arithmetic is done in single precision: values convert to float on load and back on store,
+ *  rounding to nearest even.  The bulk conversions use the F16C instructions when the code is
+ *  compiled with them enabled (e.g. -mf16c) and a scalar fallback otherwise.
+ */
+class float16
+{
+
+private:
+
+  unsigned short bits_;
+
+public:
+
+  /** Constructor.  The value is left uninitialized, like the built in types. */
+  float16(void) {};
+
+  /** Constructor from a float, rounding to nearest even */
+  float16(float val) : bits_(fromFloatBits(val)) {};
+
+  /** Conversion to float */
+  operator float(void) const { return(toFloatBits(bits_)); };
+
+  /** Returns the raw bits */
+  unsigned short bits(void) const { return(bits_); };
+
+  /** Constructs a value from raw bits */
+  static float16 fromBits(unsigned short bits)
+  {
+    float16 val;
+    val.bits_ = bits;
+    return(val);
+  };
+
+  /** Converts a float to half precision bits, rounding to nearest even */
+  static inline unsigned short fromFloatBits(float val)
+  {
+    unsigned int x;
+    memcpy(&x, &val, sizeof(x));
+    unsigned int sign = (x >> 16) & 0x8000u;
+    unsigned int exponent = (x >> 23) & 0xffu;
+    unsigned int mantissa = x & 0x7fffffu;
+
+    if (exponent == 0xffu)  //infinity and NaN, keeping NaN quiet
+      return((unsigned short)(sign | 0x7c00u | (mantissa ? (0x200u | (mantissa >> 13)) : 0u)));
+
+    int e = (int)exponent - 127 + 15;
+    if (e >= 0x1f)  //overflow
+      return((unsigned short)(sign | 0x7c00u));
+
+    if (e <= 0)  //subnormal or zero
+    {
+      if (e < -10)
+        return((unsigned short)sign);
+      mantissa |= 0x800000u;
+      unsigned int shift = (unsigned int)(14 - e);
+      unsigned int half = mantissa >> shift;
+      unsigned int rem = mantissa & ((1u << shift) - 1u);
+      unsigned int mid = 1u << (shift - 1u);
+      if (rem > mid || (rem == mid && (half & 1u)))
+        half++;
+      return((unsigned short)(sign | half));
+    }
+
+    unsigned int half = ((unsigned int)e << 10) | (mantissa >> 13);
+    unsigned int rem = mantissa & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (half & 1u)))
+      half++;  //a carry into the exponent rounds up to the next binade or to infinity
+    return((unsigned short)(sign | half));
+  };
+
+  /** Converts half precision bits to a float.  The conversion is exact. */
+  static inline float toFloatBits(unsigned short bits)
+  {
+    unsigned int sign = ((unsigned int)bits & 0x8000u) << 16;
+    unsigned int exponent = ((unsigned int)bits >> 10) & 0x1fu;
+    unsigned int mantissa = (unsigned int)bits & 0x3ffu;
+    unsigned int x;
+
+    if (exponent == 0)
+    {
+      if (mantissa == 0)
+      {
+        x = sign;
+      }
+      else
+      {
+        //normalize the subnormal
+        exponent = 1;
+        while (!(mantissa & 0x400u))
+        {
+          mantissa <<= 1;
+          exponent--;
+        }
+        mantissa &= 0x3ffu;
+        x = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+      }
+    }
+    else if (exponent == 0x1fu)
+    {
+      x = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+      x = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+
+    float val;
+    memcpy(&val, &x, sizeof(val));
+    return(val);
+  };
+
+  /** Converts an array of half precision values to floats
+   * @param input The half precision values
+   * @param output The floats
+   * @param n The number of values
+   */
+  static void toFloat(const float16* input, float* output, long long n)
+  {
+    long long idx = 0;
+#if defined(__F16C__)
+    for (; idx+8<=n; idx+=8)
+    {
+      __m128i h = _mm_loadu_si128((const __m128i*)(input + idx));
+      _mm256_storeu_ps(output + idx, _mm256_cvtph_ps(h));
+    }
+#endif
+    for (; idx<n; idx++)
+      output[idx] = toFloatBits(input[idx].bits_);
+  };
+
+  /** Converts an array of floats to half precision values, rounding to nearest even
+   * @param input The floats
+   * @param output The half precision values
+   * @param n The number of values
+   */
+  static void fromFloat(const float* input, float16* output, long long n)
+  {
+    long long idx = 0;
+#if defined(__F16C__)
+    for (; idx+8<=n; idx+=8)
+    {
+      __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(input + idx), _MM_FROUND_TO_NEAREST_INT);
+      _mm_storeu_si128((__m128i*)(output + idx), h);
+    }
+#endif
+    for (; idx<n; idx++)
+      output[idx].bits_ = fromFloatBits(input[idx]);
+  };
+
+};
+#endif
@@ -0,0 +1,437 @@
+#ifndef _MEMORYBUDGETH_
+#define _MEMORYBUDGETH_
+//================================================================
+//
+// File: MemoryBudget.h
+// Created: 10/19/2026
+// Purpose: A process wide governor of DataBuffer memory
+//
+//================================================================
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <list>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <ostream>
+#include <iomanip>
+#include "Exception.h"
+#include "PerfTypeName.h"
+
+/** Spillable: memory the MemoryBudget may write out to a scratch file and free when over budget. */
+class Spillable
+{
+
+public:
+
+  /** Destructor.  The specification matches DataBuffer's. */
+  virtual ~Spillable(void) throw(Exception) {};
+
+  /** Writes the data to a file and frees it.  Called by the MemoryBudget while the owner is not using the data.
+   * @param filename The scratch file to write
+   * @return The number of bytes freed, 0 if the data could not be written and stays in memory
+   */
+  virtual unsigned long long spill(const std::string& filename) = 0;
+
+  /** Returns the number of bytes spill would free, 0 if there is nothing to spill */
+  virtual unsigned long long spillBytes(void) const = 0;
+
+  /** Returns the allocation site the memory is accounted to, see MemorySite, or NULL */
+  virtual const char* memorySite(void) const { return(NULL); };
+
+  /** Returns the element type the memory is accounted to, or NULL */
+  virtual const char* memoryType(void) const { return(NULL); };
+
+};
+
+/** MemorySite: names the allocation site of the DataBuffers a thread allocates during its lifetime, e.g.
+ *  "Ndvi::input", so MemoryBudget can account memory by site.  Sites nest; the innermost is used.
+ */
+class MemorySite
+{
+
+private:
+
+  const char* previous_;
+
+  /** Creates the key of the current site of each thread.  This is an internal method. */
+  static void createKey(void) { pthread_key_create(&key(), NULL); };
+
+  /** Returns the key of the current site of each thread.  This is an internal method. */
+  static pthread_key_t& key(void)
+  {
+    static pthread_key_t siteKey;
+    return(siteKey);
+  };
+
+  MemorySite(const MemorySite&);
+  MemorySite& operator=(const MemorySite&);
+
+public:
+
+  /** Constructor.  Makes site the current site of the calling thread.
+   * @param site The name of the site.  The string must outlive every buffer allocated under it, e.g. a literal.
+   */
+  MemorySite(const char* site) : previous_(current())
+  {
+    pthread_setspecific(key(), site);
+  };
+
+  /** Destructor.  Restores the previous site. */
+  ~MemorySite(void)
+  {
+    pthread_setspecific(key(), previous_);
+  };
+
+  /** Returns the current site of the calling thread, or NULL outside any site */
+  static const char* current(void)
+  {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, createKey);
+    return(static_cast<const char*>(pthread_getspecific(key())));
+  };
+
+};
+
+/** MemoryUsage: the memory accounted to one allocation site and element type */
+struct MemoryUsage
+{
+  std::string site;
+  std::string type;
+  unsigned long long current;       //live bytes
+  unsigned long long peak;          //the most live bytes at once since the last resetPeak
+  long long allocations;            //the number of allocations
+
+  MemoryUsage(void) : current(0), peak(0), allocations(0) {};
+};
+
+/** MemoryBudget: accounts for the memory of every DataBuffer in the process against one budget.
+ *  DataBuffer reports each allocation and release, and the current and peak usage are kept.  When an
+ *  allocation takes usage over the budget, cold buffers, those their owners marked spillable while they
+ *  wait between stages, are written to scratch files and freed, oldest first; they are read back when
+ *  next used.  Allocations never wait for other threads; the one that spills writes the scratch files
+ *  itself, outside the lock, so allocations elsewhere carry on meanwhile.  Schedulers apply backpressure
+ *  by calling waitForRoom before starting work, which waits until other threads release memory.
+ *  The budget is unlimited until setBudget is called.  All methods are thread safe.
+ */
+class MemoryBudget
+{
+
+private:
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t released_;
+  pthread_cond_t spillDone_;
+  unsigned long long budget_;
+  unsigned long long current_;
+  unsigned long long peak_;
+  unsigned long long mark_;
+  unsigned long long spilledBytes_;
+  long long nspills_;
+  long long nwaits_;
+  long long nfiles_;
+  double maxWait_;
+  std::string scratchDirectory_;
+  std::list<Spillable*> cold_;
+  std::list<Spillable*> spilling_;
+  unsigned long long spillingBytes_;
+  std::map<std::pair<std::string, std::string>, MemoryUsage> usage_;
+
+  /** Returns the usage of a site and type.  This is an internal method and is called with the mutex held. */
+  MemoryUsage& siteUsage(const char* site, const char* type)
+  {
+    std::pair<std::string, std::string> key(site ? site : "unattributed", type ? type : "unknown");
+    MemoryUsage& entry = usage_[key];
+    if (entry.site.empty())
+    {
+      entry.site = key.first;
+      entry.type = key.second;
+    }
+    return(entry);
+  };
+
+  /** Scoped lock of the mutex.  This is an internal class. */
+  class Lock
+  {
+    pthread_mutex_t* mutex_;
+  public:
+    Lock(pthread_mutex_t* mutex) : mutex_(mutex) { pthread_mutex_lock(mutex_); };
+    ~Lock(void) { pthread_mutex_unlock(mutex_); };
+  };
+
+  /** Constructor.  There is one MemoryBudget per process, see instance(). */
+  MemoryBudget(void)
+    : budget_(0), current_(0), peak_(0), mark_(0), spilledBytes_(0), nspills_(0), nwaits_(0), nfiles_(0), maxWait_(10.0),
+      spillingBytes_(0)
+  {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&released_, NULL);
+    pthread_cond_init(&spillDone_, NULL);
+    const char* tmpdir = getenv("TMPDIR");
+    scratchDirectory_ = (tmpdir && *tmpdir) ? tmpdir : "/tmp";
+  };
+
+  MemoryBudget(const MemoryBudget&);
+  MemoryBudget& operator=(const MemoryBudget&);
+
+  /** Spills cold buffers, oldest first, until bytes more fit in the budget.  This is an internal method
+   *  and is called with the mutex held.  The buffers are chosen under the mutex and written with it
+   *  released, so other threads keep allocating during the disk writes; memory other threads are already
+   *  spilling counts as freed.  removeCold waits for a buffer that is being written.
+   */
+  void spillcold(unsigned long long bytes)
+  {
+    for (;;)
+    {
+      std::vector<Spillable*> victims;
+      std::vector<std::string> filenames;
+      std::vector<unsigned long long> sizes;
+      while (budget_ && current_ - spillingBytes_ + bytes > budget_ && !cold_.empty())
+      {
+        Spillable* buffer = cold_.front();
+        cold_.pop_front();
+        unsigned long long size = buffer->spillBytes();
+        if (!size)
+          continue;
+        std::ostringstream ostr;
+        ostr << scratchDirectory_ << "/databuffer_" << getpid() << "_" << nfiles_++ << ".spill";
+        victims.push_back(buffer);
+        filenames.push_back(ostr.str());
+        sizes.push_back(size);
+        spilling_.push_back(buffer);
+        spillingBytes_ += size;
+      }
+      if (victims.empty())
+        return;
+
+      std::vector<unsigned long long> freed(victims.size(), 0ULL);
+      pthread_mutex_unlock(&mutex_);
+      for (size_t idx=0; idx<victims.size(); idx++)
+        freed[idx] = victims[idx]->spill(filenames[idx]);
+      pthread_mutex_lock(&mutex_);
+
+      for (size_t idx=0; idx<victims.size(); idx++)
+      {
+        spillingBytes_ -= sizes[idx];
+        spilling_.remove(victims[idx]);
+        unsigned long long nbytes = (freed[idx] > current_) ? current_ : freed[idx];
+        current_ -= nbytes;
+        MemoryUsage& entry = siteUsage(victims[idx]->memorySite(), victims[idx]->memoryType());
+        entry.current = (nbytes > entry.current) ? 0 : entry.current - nbytes;
+        if (nbytes)
+        {
+          spilledBytes_ += nbytes;
+          nspills_++;
+        }
+      }
+      pthread_cond_broadcast(&spillDone_);
+      pthread_cond_broadcast(&released_);
+    }
+  };
+
+public:
+
+  /** Returns the MemoryBudget of the process */
+  static MemoryBudget& instance(void)
+  {
+    static MemoryBudget budget;
+    return(budget);
+  };
+
+  /** Destructor */
+  virtual ~MemoryBudget(void)
+  {
+    pthread_cond_destroy(&spillDone_);
+    pthread_cond_destroy(&released_);
+    pthread_mutex_destroy(&mutex_);
+  };
+
+  /** Sets the budget.
+   * @param bytes The budget in bytes, 0 for no limit
+   */
+  void setBudget(unsigned long long bytes)
+  {
+    Lock lock(&mutex_);
+    budget_ = bytes;
+    pthread_cond_broadcast(&released_);
+  };
+
+  /** Sets the directory spilled buffers are written to.  The default is $TMPDIR or /tmp. */
+  void setScratchDirectory(const std::string& directory)
+  {
+    Lock lock(&mutex_);
+    scratchDirectory_ = directory;
+  };
+
+  /** Sets the longest time waitForRoom waits, so threads that hold memory while waiting cannot deadlock.
+   * @param seconds The time in seconds
+   */
+  void setMaxWait(double seconds)
+  {
+    Lock lock(&mutex_);
+    maxWait_ = seconds;
+  };
+
+  /** Records an allocation, spilling cold buffers if it takes usage over the budget.  Called by DataBuffer.
+   * @param bytes The size of the allocation
+   * @param site The allocation site, see MemorySite, or NULL
+   * @param type The element type, e.g. PerfTypeName<T>::name(), or NULL
+   */
+  void acquire(unsigned long long bytes, const char* site = NULL, const char* type = NULL)
+  {
+    Lock lock(&mutex_);
+    spillcold(bytes);
+    current_ += bytes;
+    peak_ = (current_ > peak_) ? current_ : peak_;
+    mark_ = (current_ > mark_) ? current_ : mark_;
+    MemoryUsage& entry = siteUsage(site, type);
+    entry.current += bytes;
+    entry.peak = (entry.current > entry.peak) ? entry.current : entry.peak;
+    entry.allocations++;
+  };
+
+  /** Records a release.  Called by DataBuffer.
+   * @param bytes The size of the allocation
+   * @param site The allocation site given to acquire
+   * @param type The element type given to acquire
+   */
+  void release(unsigned long long bytes, const char* site = NULL, const char* type = NULL)
+  {
+    Lock lock(&mutex_);
+    current_ = (bytes > current_) ? 0 : current_ - bytes;
+    MemoryUsage& entry = siteUsage(site, type);
+    entry.current = (bytes > entry.current) ? 0 : entry.current - bytes;
+    pthread_cond_broadcast(&released_);
+  };
+
+  /** Waits until an allocation fits in the budget, spilling cold buffers first.  Returns at once if
+   *  nothing else holds memory, so work larger than the budget still runs on its own.
+   * @param bytes The size of the allocation about to be made
+   * @return false if the wait timed out, see setMaxWait
+   */
+  bool waitForRoom(unsigned long long bytes)
+  {
+    Lock lock(&mutex_);
+    spillcold(bytes);
+    if (!budget_ || current_ + bytes <= budget_ || current_ == 0)
+      return(true);
+
+    nwaits_++;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    double end = (double)now.tv_sec + (double)now.tv_usec * 1e-6 + maxWait_;
+    struct timespec deadline;
+    deadline.tv_sec = (time_t)end;
+    deadline.tv_nsec = (long)((end - (double)deadline.tv_sec) * 1e9);
+    while (budget_ && current_ + bytes > budget_ && current_ > 0)
+    {
+      if (pthread_cond_timedwait(&released_, &mutex_, &deadline) == ETIMEDOUT)
+        return(false);
+      spillcold(bytes);
+    }
+    return(true);
+  };
+
+  /** Makes a buffer a candidate for spilling.  Its owner must not use its data until removeCold.  Called by DataBuffer. */
+  void addCold(Spillable* buffer)
+  {
+    Lock lock(&mutex_);
+    cold_.push_back(buffer);
+  };
+
+  /** Withdraws a buffer from spilling.  Once this returns the buffer is either in memory or fully spilled.  Called by DataBuffer. */
+  void removeCold(Spillable* buffer)
+  {
+    Lock lock(&mutex_);
+    cold_.remove(buffer);
+    while (std::find(spilling_.begin(), spilling_.end(), buffer) != spilling_.end())
+      pthread_cond_wait(&spillDone_, &mutex_);
+  };
+
+  /** Returns the budget in bytes, 0 for no limit */
+  unsigned long long budget(void) { Lock lock(&mutex_); return(budget_); };
+
+  /** Returns the bytes currently held by DataBuffers */
+  unsigned long long current(void) { Lock lock(&mutex_); return(current_); };
+
+  /** Returns the most bytes held at once since the last resetPeak */
+  unsigned long long peak(void) { Lock lock(&mutex_); return(peak_); };
+
+  /** Returns the most bytes held at once since the last resetMark.  The mark is a high water mark of its
+   *  own, for measuring one stretch of work, e.g. a tile, without disturbing peak and the site peaks.
+   */
+  unsigned long long mark(void) { Lock lock(&mutex_); return(mark_); };
+
+  /** Restarts the high water mark from the current usage, see mark() */
+  void resetMark(void)
+  {
+    Lock lock(&mutex_);
+    mark_ = current_;
+  };
+
+  /** Restarts peak tracking, of the total and of every site, from the current usage */
+  void resetPeak(void)
+  {
+    Lock lock(&mutex_);
+    peak_ = current_;
+    for (std::map<std::pair<std::string, std::string>, MemoryUsage>::iterator iter=usage_.begin(); iter!=usage_.end(); ++iter)
+      iter->second.peak = iter->second.current;
+  };
+
+  /** Returns the memory accounted to every allocation site and element type, ordered by site */
+  std::vector<MemoryUsage> usage(void)
+  {
+    Lock lock(&mutex_);
+    std::vector<MemoryUsage> result;
+    for (std::map<std::pair<std::string, std::string>, MemoryUsage>::const_iterator iter=usage_.begin(); iter!=usage_.end(); ++iter)
+      result.push_back(iter->second);
+    return(result);
+  };
+
+  /** Returns the memory accounted to one allocation site and element type */
+  MemoryUsage usage(const std::string& site, const std::string& type)
+  {
+    Lock lock(&mutex_);
+    std::map<std::pair<std::string, std::string>, MemoryUsage>::const_iterator iter = usage_.find(std::make_pair(site, type));
+    return((iter == usage_.end()) ? MemoryUsage() : iter->second);
+  };
+
+  /** Writes a table of the live and peak MB and the allocations of every site and type, and the totals
+   * @param ostr The stream
+   */
+  void report(std::ostream& ostr)
+  {
+    std::vector<MemoryUsage> entries = usage();
+    unsigned long long total = current(), totalPeak = peak();
+    ostr << std::left << std::setw(40) << "site" << std::setw(10) << "type" << std::right << std::setw(12) << "live MB"
+         << std::setw(12) << "peak MB" << std::setw(14) << "allocations" << std::endl;
+    ostr << std::fixed << std::setprecision(2);
+    for (size_t idx=0; idx<entries.size(); idx++)
+      ostr << std::left << std::setw(40) << entries[idx].site << std::setw(10) << entries[idx].type << std::right
+           << std::setw(12) << (double)entries[idx].current / (1024.0 * 1024.0) << std::setw(12) << (double)entries[idx].peak / (1024.0 * 1024.0)
+           << std::setw(14) << entries[idx].allocations << std::endl;
+    ostr << std::left << std::setw(50) << "total" << std::right << std::setw(12) << (double)total / (1024.0 * 1024.0)
+         << std::setw(12) << (double)totalPeak / (1024.0 * 1024.0) << std::endl;
+    ostr.unsetf(std::ios::fixed);
+  };
+
+  /** Returns true if the current usage exceeds the budget */
+  bool overBudget(void) { Lock lock(&mutex_); return(budget_ && current_ > budget_); };
+
+  /** Returns the number of buffers spilled */
+  long long nspills(void) { Lock lock(&mutex_); return(nspills_); };
+
+  /** Returns the number of bytes spilled */
+  unsigned long long spilledBytes(void) { Lock lock(&mutex_); return(spilledBytes_); };
+
+  /** Returns the number of times waitForRoom had to wait */
+  long long nwaits(void) { Lock lock(&mutex_); return(nwaits_); };
+
+};
+#endif
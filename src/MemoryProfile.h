@@ -0,0 +1,263 @@
+#ifndef _MEMORYPROFILEH_
+#define _MEMORYPROFILEH_
+//================================================================
+//
+// File: MemoryProfile.h
+// Created: 10/19/2026
+// Purpose: Per run and per tile memory high water marks
+//
+//================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <gdal.h>
+#include "MemoryBudget.h"
+
+/** TileMemory: the memory high water marks of one tile, or of a whole run */
+struct TileMemory
+{
+  int tile;                         //the tile number, -1 for a run
+  unsigned long long buffers;       //the most DataBuffer bytes live at once, see MemoryBudget
+  unsigned long long gdalCache;     //the GDAL block cache in use
+  unsigned long long rss;           //the resident set size of the process
+
+  TileMemory(int tilenum = -1) : tile(tilenum), buffers(0), gdalCache(0), rss(0) {};
+
+  /** Raises each mark to the mark of other */
+  void merge(const TileMemory& other)
+  {
+    buffers = (other.buffers > buffers) ? other.buffers : buffers;
+    gdalCache = (other.gdalCache > gdalCache) ? other.gdalCache : gdalCache;
+    rss = (other.rss > rss) ? other.rss : rss;
+  };
+};
+
+/** MemoryProfile: records how much memory a run and each of its tiles really use, to size containers and
+ *  pack jobs per node.  DataBuffer memory is taken from the MemoryBudget high water mark, see
+ *  MemoryBudget::mark, which is restarted at each tile and leaves the peaks by site and type intact.  The
+ *  resident set size is the kernel's high water mark (VmHWM), restarted at each tile through
+ *  /proc/self/clear_refs; where that is not available it is sampled.  The GDAL block cache is sampled at
+ *  the start and end of each tile and by sample(), which the loops call while the tile's buffers are live.
+ *  The accounting by allocation site and element type is kept by the MemoryBudget, see MemorySite, and is
+ *  included in the report.  The MemoryBudget and the process are shared, so the marks of runs that
+ *  overlap in one process include each other's memory.  Ndvi and Pipeline fill a profile given to
+ *  setMemoryProfile.
+ */
+class MemoryProfile
+{
+
+private:
+
+  std::string name_;
+  std::vector<TileMemory> tiles_;
+  TileMemory run_;
+  TileMemory tile_;
+  bool inTile_;
+  bool highWater_;
+
+  /** Samples the GDAL cache and the resident set size into a mark.  This is an internal method. */
+  void samplemark(TileMemory& mark) const
+  {
+    TileMemory now;
+    now.gdalCache = gdalCacheBytes();
+    now.rss = highWater_ ? residentHighWater() : residentBytes();
+    mark.merge(now);
+  };
+
+  /** Restarts the high water marks of the MemoryBudget and of the kernel.  This is an internal method. */
+  void restart(void)
+  {
+    MemoryBudget::instance().resetMark();
+    highWater_ = resetResidentHighWater();
+  };
+
+public:
+
+  /** Scoped tile: calls beginTile and endTile on a profile, which may be NULL */
+  class TileScope
+  {
+    MemoryProfile* profile_;
+    TileScope(const TileScope&);
+    TileScope& operator=(const TileScope&);
+  public:
+    TileScope(MemoryProfile* profile, int tilenum) : profile_(profile) { if (profile_) profile_->beginTile(tilenum); };
+    ~TileScope(void) { if (profile_) profile_->endTile(); };
+  };
+
+  /** Constructor.
+   * @param name The name of the run in the report
+   */
+  MemoryProfile(const std::string& name = std::string("run")) : name_(name), inTile_(false), highWater_(false) {};
+
+  /** Destructor */
+  virtual ~MemoryProfile(void) {};
+
+  /** Returns the resident set size of the process in bytes, or 0 where it cannot be read */
+  static unsigned long long residentBytes(void)
+  {
+    unsigned long long pages = 0, resident = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (!fp)
+      return(0ULL);
+    int n = fscanf(fp, "%llu %llu", &pages, &resident);
+    fclose(fp);
+    return((n == 2) ? resident * (unsigned long long)sysconf(_SC_PAGESIZE) : 0ULL);
+  };
+
+  /** Returns the largest resident set size of the process since the last resetResidentHighWater, or
+   *  since it started, in bytes.  Returns 0 where it cannot be read.
+   */
+  static unsigned long long residentHighWater(void)
+  {
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp)
+      return(0ULL);
+    char line[256];
+    unsigned long long kb = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+      if (strncmp(line, "VmHWM:", 6) == 0)
+      {
+        sscanf(line + 6, "%llu", &kb);
+        break;
+      }
+    }
+    fclose(fp);
+    return(kb * 1024ULL);
+  };
+
+  /** Restarts the resident set size high water mark of the process from its current size
+   * @return false where the kernel does not support it
+   */
+  static bool resetResidentHighWater(void)
+  {
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (!fp)
+      return(false);
+    bool ok = (fputs("5", fp) >= 0);
+    ok = (fclose(fp) == 0) && ok;
+    return(ok && residentHighWater() > 0);
+  };
+
+  /** Returns the largest resident set size of the process reported by getrusage in bytes.  On Linux
+   *  this includes the kernel's high water mark, so it is restarted by resetResidentHighWater as well.
+   */
+  static unsigned long long peakResidentBytes(void)
+  {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return(0ULL);
+    return((unsigned long long)usage.ru_maxrss * 1024ULL);
+  };
+
+  /** Returns the bytes of the GDAL block cache in use */
+  static unsigned long long gdalCacheBytes(void)
+  {
+    GIntBig used = GDALGetCacheUsed64();
+    return((used > 0) ? (unsigned long long)used : 0ULL);
+  };
+
+  /** Starts a run, discarding the marks of an earlier one */
+  void begin(void)
+  {
+    tiles_.clear();
+    run_ = TileMemory();
+    inTile_ = false;
+    restart();
+    run_.buffers = MemoryBudget::instance().current();
+    samplemark(run_);
+  };
+
+  /** Starts a tile
+   * @param tilenum The tile number
+   */
+  void beginTile(int tilenum)
+  {
+    if (inTile_)
+      endTile();
+    samplemark(run_);
+    run_.buffers = std::max(run_.buffers, MemoryBudget::instance().mark());
+    restart();
+    tile_ = TileMemory(tilenum);
+    samplemark(tile_);
+    inTile_ = true;
+  };
+
+  /** Samples the GDAL cache and the resident set size of the current tile.  Call while the tile's buffers
+   *  are live, e.g. after it has been processed; the DataBuffer and resident set marks need no sampling.
+   */
+  void sample(void)
+  {
+    if (inTile_)
+      samplemark(tile_);
+  };
+
+  /** Ends the current tile and records its marks */
+  void endTile(void)
+  {
+    if (!inTile_)
+      return;
+    tile_.buffers = MemoryBudget::instance().mark();
+    samplemark(tile_);
+    tiles_.push_back(tile_);
+    run_.merge(tile_);
+    inTile_ = false;
+  };
+
+  /** Ends the run */
+  void end(void)
+  {
+    endTile();
+    run_.buffers = std::max(run_.buffers, MemoryBudget::instance().mark());
+    samplemark(run_);
+  };
+
+  /** Returns the high water marks of the run */
+  const TileMemory& peak(void) const { return(run_); };
+
+  /** Returns the high water marks of every tile, in the order they were processed */
+  const std::vector<TileMemory>& tiles(void) const { return(tiles_); };
+
+  /** Returns the name of the run */
+  const std::string& name(void) const { return(name_); };
+
+  /** Writes the high water marks of the run, the tiles with the most DataBuffer memory and the memory of
+   *  every allocation site and element type.
+   * @param ostr The stream
+   * @param ntiles The number of tiles listed
+   */
+  void report(std::ostream& ostr, int ntiles = 5)
+  {
+    const double mb = 1024.0 * 1024.0;
+    ostr << std::fixed << std::setprecision(2);
+    ostr << name_ << ": " << tiles_.size() << " tiles, peak buffers " << (double)run_.buffers / mb << " MB, GDAL cache "
+         << (double)run_.gdalCache / mb << " MB, RSS " << (double)run_.rss / mb << " MB, process peak RSS "
+         << (double)peakResidentBytes() / mb << " MB" << std::endl;
+
+    std::vector<TileMemory> largest(tiles_);
+    std::stable_sort(largest.begin(), largest.end(), largerBuffers);
+    largest.resize(std::min(largest.size(), (size_t)(ntiles < 0 ? 0 : ntiles)));
+    if (!largest.empty())
+    {
+      ostr << std::right << std::setw(8) << "tile" << std::setw(14) << "buffers MB" << std::setw(14) << "GDAL MB" << std::setw(14) << "RSS MB" << std::endl;
+      for (size_t idx=0; idx<largest.size(); idx++)
+        ostr << std::setw(8) << largest[idx].tile << std::setw(14) << (double)largest[idx].buffers / mb
+             << std::setw(14) << (double)largest[idx].gdalCache / mb << std::setw(14) << (double)largest[idx].rss / mb << std::endl;
+    }
+    ostr.unsetf(std::ios::fixed);
+    MemoryBudget::instance().report(ostr);
+  };
+
+  /** Orders tiles by decreasing DataBuffer memory.  This is an internal method. */
+  static bool largerBuffers(const TileMemory& a, const TileMemory& b) { return(a.buffers > b.buffers); };
+
+};
+#endif
@@ -0,0 +1,243 @@
+#ifndef _MULTIRASTERITERATORH_
+#define _MULTIRASTERITERATORH_
+//================================================================
+//
+// File: MultiRasterIterator.h
+// Created: 10/19/2026
+// Purpose: A class that iterates over several co-registered rasters
+//          together, e.g. two dates of the same scene.
+//
+//================================================================
+
+#include <math.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "RasterDims.h"
+
+/** MultiRasterIterator: iterates over the common area of several rasters on the same pixel grid.
+ *  The rasters must share the projection, pixel size and rotation, and their origins must differ by
+ *  whole pixels; they may have different extents.  The offset of each raster is found by mapping the
+ *  origin of the first raster through imageToMap and mapToImage, and the iterator covers the area
+ *  present in every raster.  Rasters without georeferencing must have the same size.  Rasters that are
+ *  not on the same grid must be brought onto it first, e.g. with RasterWarper.
+ *  Tiles are strips of lines in the coordinates of the first raster.  getData reads the matching window
+ *  of every raster concurrently.
+ */
+class MultiRasterIterator
+{
+
+private:
+
+  std::vector<DataRaster*> inputs_;
+  std::vector<int> sampleOffsets_;
+  std::vector<int> lineOffsets_;
+  RasterDims dims_;
+  int lineChunkSize_;
+  int nTiles_;
+
+  /** Finds the offset of an input relative to the first input.  This is an internal method. */
+  void findoffset(size_t input, double tolerance) throw(Exception)
+  {
+    DataRaster& reference = *inputs_[0];
+    DataRaster& raster = *inputs_[input];
+    double refgt[6], gt[6];
+    bool refgeo = reference.getGeoTransform(refgt);
+    bool geo = raster.getGeoTransform(gt);
+    std::ostringstream ostr;
+    ostr << "MultiRasterIterator: Error: input " << input << " ";
+
+    if (!refgeo || !geo)
+    {
+      if (refgeo != geo || !(raster.dims() == reference.dims()))
+      {
+        ostr << "is not georeferenced like input 0 and does not have its size.";
+        throw Exception(ostr.str());
+      }
+      sampleOffsets_[input] = 0;
+      lineOffsets_[input] = 0;
+      return;
+    }
+
+    std::string refproj = reference.projection(), proj = raster.projection();
+    if (!refproj.empty() && !proj.empty() && refproj != proj)
+    {
+      ostr << "has a different projection than input 0.";
+      throw Exception(ostr.str());
+    }
+    double pixel = fabs(refgt[1]) + fabs(refgt[2]);
+    for (int idx=1; idx<6; idx++)
+    {
+      if (idx != 3 && fabs(gt[idx] - refgt[idx]) > tolerance * pixel)
+      {
+        ostr << "has a different pixel size or rotation than input 0.";
+        throw Exception(ostr.str());
+      }
+    }
+
+    double x = 0.0, y = 0.0;
+    reference.imageToMap(0, 0, &x, &y);
+    raster.mapToImage(1, &x, &y);
+    double sample = floor(x + 0.5), line = floor(y + 0.5);
+    if (fabs(x - sample) > tolerance || fabs(y - line) > tolerance)
+    {
+      ostr << "is not aligned with the pixel grid of input 0.";
+      throw Exception(ostr.str());
+    }
+    sampleOffsets_[input] = (int)sample;
+    lineOffsets_[input] = (int)line;
+  };
+
+  /** Reads one band of a window of one input.  This is an internal method. */
+  template <typename T> void readinput(size_t input, int tileNum, DataBuffer<T>& buffer, GDALDataType dataType, int band, int bufferBand) throw(Exception)
+  {
+    RasterDims window;
+    getInputDims((int)input, tileNum, window);
+    if (!(buffer.dims() == window))
+      throw Exception("MultiRasterIterator::getData Error: buffer does not match the window of its input.");
+    inputs_[input]->getData(buffer, band, dataType, bufferBand);
+  };
+
+public:
+
+  /** Constructor
+   * @param inputs The rasters to iterate over.  They must stay open while the iterator is used.
+   * @param memsize The memsize in bytes of the desired chunk size of each input
+   * @param tolerance The largest difference, in pixels, accepted between the grids
+   */
+  MultiRasterIterator(const std::vector<DataRaster*>& inputs, long long memsize, double tolerance = 1e-3) throw(Exception)
+    : inputs_(inputs), sampleOffsets_(inputs.size(), 0), lineOffsets_(inputs.size(), 0),
+      lineChunkSize_(0), nTiles_(0)
+  {
+    if (inputs_.empty())
+      throw Exception("MultiRasterIterator: Error: there must be at least one input.");
+
+    int startSample = 0, endSample = inputs_[0]->nsamples() - 1;
+    int startLine = 0, endLine = inputs_[0]->nlines() - 1;
+    int dtSize = 1;
+    for (size_t input=0; input<inputs_.size(); input++)
+    {
+      if (input > 0)
+        findoffset(input, tolerance);
+
+      //the area of the first input covered by this one
+      int s0 = -sampleOffsets_[input], l0 = -lineOffsets_[input];
+      int s1 = s0 + inputs_[input]->nsamples() - 1, l1 = l0 + inputs_[input]->nlines() - 1;
+      startSample = (s0 > startSample) ? s0 : startSample;
+      endSample = (s1 < endSample) ? s1 : endSample;
+      startLine = (l0 > startLine) ? l0 : startLine;
+      endLine = (l1 < endLine) ? l1 : endLine;
+
+      int size = GDALGetDataTypeSize(inputs_[input]->dataType()) / 8;
+      dtSize = (size > dtSize) ? size : dtSize;
+    }
+    if (startSample > endSample || startLine > endLine)
+      throw Exception("MultiRasterIterator: Error: the inputs do not overlap.");
+    dims_ = RasterDims(startSample, endSample, startLine, endLine);
+
+    double lines = ceil((double)memsize / ((double)dims_.width() * (double)dtSize));
+    lines = (lines > (double)dims_.height()) ? (double)dims_.height() : lines;
+    lineChunkSize_ = (lines < 1.0) ? 1 : (int)lines;
+    nTiles_ = (int)ceil((double)dims_.height() / (double)lineChunkSize_);
+  };
+
+  /** Destructor */
+  virtual ~MultiRasterIterator(void) {};
+
+  /** Retrieves the dimensions of a tile in the image coordinates of the first input
+   * @param tileNum The tile number
+   * @param tile_dims The dimensions of the tile
+   */
+  void getTileDims(int tileNum, RasterDims& tile_dims) const
+  {
+    int startLine = dims_.startLine() + tileNum * lineChunkSize_;
+    int endLine = startLine + lineChunkSize_ - 1;
+    tile_dims = RasterDims(dims_.startSample(), dims_.endSample(), startLine, (endLine > dims_.endLine()) ? dims_.endLine() : endLine);
+  };
+
+  /** Retrieves the dimensions of a tile in the image coordinates of one input
+   * @param input The zero based input number
+   * @param tileNum The tile number
+   * @param input_dims The window of the input that matches the tile
+   */
+  void getInputDims(int input, int tileNum, RasterDims& input_dims) const
+  {
+    RasterDims tile;
+    getTileDims(tileNum, tile);
+    input_dims = RasterDims(tile.startSample() + sampleOffsets_[input], tile.endSample() + sampleOffsets_[input],
+                            tile.startLine() + lineOffsets_[input], tile.endLine() + lineOffsets_[input]);
+  };
+
+  /** Reads one band of a tile from every input.  The inputs are read concurrently, even when one
+   *  DataRaster is given more than once, see DataRaster.
+   * @param tileNum The tile number
+   * @param buffers One buffer per input, each with the dimensions getInputDims gives for it
+   * @param dataType The type to read the data as
+   * @param band The band to read from every input.  This follows GDAL and is 1 based.
+   * @param bufferBand The band of each buffer that receives the data.  This is a zero based index.
+   */
+  template <typename T> void getData(int tileNum, std::vector<DataBuffer<T>*>& buffers, GDALDataType dataType, int band = 1,
+    int bufferBand = 0) throw(Exception)
+  {
+    if (buffers.size() != inputs_.size())
+      throw Exception("MultiRasterIterator::getData Error: there must be one buffer per input.");
+
+    int ninputs = (int)inputs_.size();
+    if (ninputs == 1)
+    {
+      for (int input=0; input<ninputs; input++)
+        readinput(input, tileNum, *buffers[input], dataType, band, bufferBand);
+      return;
+    }
+
+    //exceptions may not leave a parallel region, so the first error is rethrown after it
+    std::string error;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(ninputs) schedule(static, 1)
+#endif
+    for (int input=0; input<ninputs; input++)
+    {
+      try
+      {
+        readinput(input, tileNum, *buffers[input], dataType, band, bufferBand);
+      }
+      catch (std::exception& e)
+      {
+#ifdef _OPENMP
+#pragma omp critical(multirasteriterator_error)
+#endif
+        if (error.empty())
+          error = e.what();
+      }
+    }
+    if (!error.empty())
+      throw Exception(error);
+  };
+
+  /** Returns the number of inputs */
+  int ninputs(void) const { return((int)inputs_.size()); };
+
+  /** Returns the number of tiles */
+  int ntiles(void) const { return(nTiles_); };
+
+  /** Returns the area common to every input, in the image coordinates of the first input */
+  const RasterDims& dims(void) const { return(dims_); };
+
+  /** Returns the sample offset of an input: its sample coordinate of sample 0 of the first input
+   * @param input The zero based input number
+   */
+  int sampleOffset(int input) const { return(sampleOffsets_[input]); };
+
+  /** Returns the line offset of an input: its line coordinate of line 0 of the first input
+   * @param input The zero based input number
+   */
+  int lineOffset(int input) const { return(lineOffsets_[input]); };
+
+};
+#endif
@@ -17,6 +17,12 @@
 #include "DataBuffer.h"
 #include "DataRasterIterator.h"
 #include "RasterDims.h"
+#include "Quantizer.h"
+#include "TileManifest.h"
+#include "BandRatioLut.h"
+#include "ShardedRun.h"
+#include "PerfCounters.h"
+#include "MemoryProfile.h"
 
 /** Ndvi: a class that compute the Normalized Difference Vegetation Index for a multispectral image. */
 class Ndvi
@@ -24,42 +30,333 @@ class Ndvi
 
 private:
 
-  DataRaster inputraster_;
-  DataRaster outputraster_;
+  DataRaster ownedinputraster_;
+  DataRaster ownedoutputraster_;
+  DataRaster& inputraster_;
+  DataRaster& outputraster_;
+  bool externaloutput_;
+  Quantizer quantizer_;
+  std::string inputfilename_;
+  std::string outputfilename_;
+  GDALDataType outputType_;
+  std::string manifestfilename_;
+  int tilesProcessed_;
+  bool halfPrecision_;
+  BandRatioLut lut_;
+  int lutBits_;
+  int shard_;
+  int nshards_;
+  bool preview_;
+  GDALRIOResampleAlg previewResampling_;
+  MemoryProfile* memoryProfile_;
+
+  /** The arguments of a sharded run, passed to the shard workers */
+  struct ShardJob
+  {
+    std::string inputfilename;
+    std::string outputfilename;
+    GDALDataType outputType;
+    bool halfPrecision;
+  };
+
+  /** Runs one shard in a worker process, writing the shard's partial output.  This is an internal method. */
+  static int shardworker(int shard, int nshards, void* context)
+  {
+    ShardJob* job = static_cast<ShardJob*>(context);
+    Ndvi ndvicalc(job->inputfilename, ShardedRun::shardFilename(job->outputfilename, shard), job->outputType);
+    ndvicalc.setHalfPrecisionOutput(job->halfPrecision);
+    ndvicalc.setShard(shard, nshards);
+    ndvicalc.run();
+    return(0);
+  };
+
+  /** Returns the largest chunk in bytes that is read into memory.  This is an internal method. */
+  static int chunkmemsize(void) { return(static_cast<int>(0.1 * 1024. * 1024.)); };
   
 protected:
 
+  /** Opens the output raster.  An existing output is reopened for update when resuming from a
+   *  checkpoint manifest, otherwise a new output is created.  If the output cannot be reopened the
+   *  manifest is discarded, since its tiles are not in the new output.  This is an internal method.
+   * @param manifest The checkpoint manifest, or NULL
+   */
+  void openoutput(TileManifest* manifest)
+  {
+    if (externaloutput_)
+    {
+      describeoutput();
+      return;
+    }
+
+    if (manifest && manifest->resumed())
+    {
+      try
+      {
+        outputraster_.open(outputfilename_, GA_Update);
+        if (outputraster_.dims() == inputraster_.dims() && (outputraster_.dataType() == outputType_ || halfPrecision_))
+          return;
+        outputraster_.close();
+      }
+      catch (Exception&)
+      {
+      }
+      manifest->discard();
+    }
+
+    //create the output raster
+    std::vector<std::string> options(1, std::string("SPARSE_OK=TRUE"));
+    GDALDataType storageType = outputType_;
+    if (halfPrecision_)
+    {
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3110000
+      storageType = GDT_Float16;
+#else
+      options.push_back(std::string("NBITS=16"));  //GeoTIFF stores the Float32 band at half precision
+#endif
+    }
+    outputraster_.create(outputfilename_, inputraster_.dims(), 1, storageType, "GTiff", &inputraster_, options);
+    describeoutput();
+  };
+
+  /** Writes the scale, offset and nodata value of quantized outputs.  This is an internal method. */
+  void describeoutput(void)
+  {
+    bool hasNoData = false;
+    inputraster_.noDataValue(3, &hasNoData);
+    if (outputType_ != GDT_Float32 || hasNoData)
+      quantizer_.describe(outputraster_);
+  };
+
+  /** Returns the string that identifies everything a checkpoint depends on.  This is an internal method. */
+  std::string checkpointparameters(int memsize)
+  {
+    std::ostringstream ostr;
+    ostr << "ndvi input=" << inputfilename_ << " output=" << outputfilename_
+         << " size=" << inputraster_.nsamples() << "x" << inputraster_.nlines() << "x" << inputraster_.nbands()
+         << " inputtype=" << inputraster_.dataType() << " outputtype=" << outputType_ << " half=" << halfPrecision_ << " memsize=" << memsize;
+    return(ostr.str());
+  };
+
+  /** Counts the pixels of a chunk where the red or NIR band holds the nodata value.  This is an internal method. */
+  template <typename T> static long long countNoData(DataBuffer<T>& inputdata, T noData)
+  {
+    long long sz = (long long)inputdata.dims().width() * inputdata.dims().height();
+    const T* band4ptr = inputdata.data() + sz * 3;
+    const T* band3ptr = inputdata.data() + sz * 2;
+    long long count = 0;
+    for (long long idx=0; idx<sz; idx++)
+      count += (band4ptr[idx] == noData || band3ptr[idx] == noData) ? 1 : 0;
+    return(count);
+  };
+
+  /** Returns the bit depth for a lookup table NDVI kernel, or 0 if the arithmetic kernel should be used.
+   *  Tables are used for unsigned 8 and 16 bit inputs whose declared bit depth is at most
+   *  BandRatioLut::maxBits, when the output has at least as many pixels as the table has entries.
+   *  This is an internal method.
+   */
+  template <typename T> int lutbits(void)
+  {
+    if (!std::numeric_limits<T>::is_integer || std::numeric_limits<T>::is_signed || sizeof(T) > 2)
+      return(0);
+    int bits = inputraster_.bitDepth(3) > inputraster_.bitDepth(4) ? inputraster_.bitDepth(3) : inputraster_.bitDepth(4);
+    if (bits > BandRatioLut::maxBits || (1LL << (2 * bits)) > outputraster_.dims().npixels())
+      return(0);
+    return(bits);
+  };
+
+  /** Computes and writes one chunk of NDVI data in the output type.  This is an internal method.
+   * @param inputdata The input chunk
+   * @param chunkdims The dimensions of the chunk
+   * @param maskNoData Set to false when the chunk is known to contain no nodata pixels
+   */
+  template <typename T, typename OutT> void writechunk(DataBuffer<T>& inputdata, const RasterDims& chunkdims, bool maskNoData)
+  {
+    bool hasNoData = false;
+    double noData = inputraster_.noDataValue(3, &hasNoData);
+
+    //allocate a data buffer for the ndvi result.
+    MemorySite site("Ndvi::output");
+    DataBuffer<OutT> outputdata(chunkdims, 1, false);
+
+    //process the data, by table lookup when the input bit depth allows it.
+    if (lutBits_ && lut_.empty())
+      lut_.build<T, OutT>(lutBits_, QuantizedValue<T, OutT>(quantizer_, hasNoData, noData));
+    if (!lutBits_ || !processchunk(inputdata, outputdata, lut_))
+      processchunk(inputdata, outputdata, quantizer_, hasNoData && maskNoData, noData);
+
+    //write the data out to the output file.
+    PerfScope scope("DataRaster::setData", PerfTypeName<OutT>::name(), NULL, (unsigned long long)chunkdims.npixels() * sizeof(OutT));
+    for (int band=0; band<outputraster_.nbands(); band++)
+      outputraster_.setData(outputdata, chunkdims, band+1, outputraster_.dataType(), band);
+  };
+
   /** Generate an outputfile containing the NDVI data. This is an internal method. */
   template <typename T> void generate(void)
   {
     //setup the memory chunk size.  This is the largest chunk we are willing to read into memory.
-    int memsize = static_cast<int>(0.1 * 1024. * 1024.);
-    DataRasterIterator iter(inputraster_, memsize, 0);
+    //a preview is tiled over the output grid and read at its resolution.
+    int memsize = chunkmemsize();
+    DataRasterIterator iter = preview_ ? DataRasterIterator(inputraster_, outputraster_.dims(), memsize, 0) : DataRasterIterator(inputraster_, memsize, 0);
+
+    //with a checkpoint manifest, tiles completed by an earlier run from the same input are skipped.
+    TileManifest* manifest = NULL;
+    if (!manifestfilename_.empty() && !preview_)
+      manifest = new TileManifest(manifestfilename_, checkpointparameters(memsize));
+    try
+    {
+      openoutput(manifest);
+      generatetiles<T>(iter, manifest);
+    }
+    catch (...)
+    {
+      delete(manifest);
+      throw;
+    }
+    delete(manifest);
+    
+    //close the file to ensure the data is written to the file.  An output passed in by the caller stays open.
+    if (externaloutput_)
+      outputraster_.flush();
+    else
+      outputraster_.close();
+  };
+
+  /** Records a tile as complete in the manifest, after making sure its output is on disk.  This is an internal method. */
+  void completetile(TileManifest* manifest, int tilenum, unsigned long long checksum)
+  {
+    if (!manifest)
+      return;
+    outputraster_.flush();
+    manifest->markComplete(tilenum, checksum);
+  };
+
+  /** Processes the tiles of the input raster.  This is an internal method. */
+  template <typename T> void generatetiles(DataRasterIterator& iter, TileManifest* manifest)
+  {
+    bool hasNoData = false;
+    T noData = static_cast<T>(inputraster_.noDataValue(3, &hasNoData));
+    tilesProcessed_ = 0;
+    lut_.clear();
+    lutBits_ = lutbits<T>();
+
+    //a shard only computes its own range of tiles, the rest of its output stays sparse.
+    int firsttile, lasttile;
+    iter.getShardTiles(shard_, nshards_, firsttile, lasttile);
+    if (memoryProfile_)
+      memoryProfile_->begin();
     
-    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    for (int tilenum=firsttile; tilenum<=lasttile; tilenum++)
     {
+      MemoryProfile::TileScope tilememory(memoryProfile_, tilenum);
+
       //get the dimensions of the chunk to be processed.
       RasterDims chunkdims;
       iter.getTileDims(tilenum, chunkdims);
+
+      //an earlier run wrote this tile, so it has to be rewritten if its input changed.
+      bool stale = (manifest && manifest->contains(tilenum));
+
+      //chunks without stored input data are neither read nor written, the output block stays sparse.
+      if (iter.tileCoverage(tilenum) == DataCoverageEmpty && (!stale || manifest->isComplete(tilenum, 0ULL)))
+      {
+        if (manifest && !stale)
+          completetile(manifest, tilenum, 0ULL);
+        continue;
+      }
       
-      //read the data for the chunk from the input file.
+      //read the data for the chunk from the input file, once other work leaves room in the memory budget.
+      MemoryBudget::instance().waitForRoom((unsigned long long)chunkdims.width() * chunkdims.height() * inputraster_.nbands() * sizeof(T));
+      MemorySite inputsite("Ndvi::input");
       DataBuffer<T> inputdata(chunkdims, inputraster_.nbands());
-      for (int band=0; band<inputraster_.nbands(); band++)
-        inputraster_.getData(inputdata, band+1, inputraster_.dataType(), band);
-        
-      //allocate a data buffer for the ndvi result.
-      DataBuffer<float> outputdata(chunkdims, 1);
+      {
+        PerfScope scope(preview_ ? "DataRaster::getPreview" : "DataRaster::getData", PerfTypeName<T>::name(), NULL,
+          (unsigned long long)chunkdims.npixels() * inputraster_.nbands() * sizeof(T));
+        for (int band=0; band<inputraster_.nbands(); band++)
+        {
+          if (preview_)
+            inputraster_.getPreview(inputdata, iter.previewDims(), band+1, inputraster_.dataType(), previewResampling_, band);
+          else
+            inputraster_.getData(inputdata, band+1, inputraster_.dataType(), band);
+        }
+      }
+
+      unsigned long long checksum = 0ULL;
+      if (manifest)
+      {
+        checksum = TileManifest::checksum(inputdata);
+        if (manifest->isComplete(tilenum, checksum))
+          continue;
+      }
+
+      //chunks that are entirely nodata are skipped as well.  Chunks without nodata use the unmasked kernel.
+      bool maskNoData = false;
+      if (hasNoData)
+      {
+        long long nnodata = countNoData(inputdata, noData);
+        if (nnodata == (long long)chunkdims.width() * chunkdims.height() && !stale)
+        {
+          completetile(manifest, tilenum, checksum);
+          continue;
+        }
+        maskNoData = (nnodata > 0);
+      }
+
+      tilesProcessed_++;
+      switch(outputraster_.dataType())
+      {
+        case (GDT_Byte):
+        {
+          writechunk<T, unsigned char>(inputdata, chunkdims, maskNoData);
+          break;
+        }
+        case (GDT_UInt16):
+        {
+          writechunk<T, unsigned short>(inputdata, chunkdims, maskNoData);
+          break;
+        }
+        case (GDT_Int16):
+        {
+          writechunk<T, short>(inputdata, chunkdims, maskNoData);
+          break;
+        }
+        default:
+        {
+          if (halfPrecision_)
+          {
+            writechunk<T, float16>(inputdata, chunkdims, maskNoData);
+            break;
+          }
+          if (hasNoData)
+          {
+            writechunk<T, float>(inputdata, chunkdims, maskNoData);
+            break;
+          }
+
+          //allocate a data buffer for the ndvi result.
+          MemorySite site("Ndvi::output");
+          DataBuffer<float> outputdata(chunkdims, 1);
       
-      //process the data.
-      processchunk(inputdata, outputdata);
+          //process the data.
+          if (lutBits_ && lut_.empty())
+            lut_.build<T, float>(lutBits_, Value<T>());
+          if (!lutBits_ || !processchunk(inputdata, outputdata, lut_))
+            processchunk(inputdata, outputdata);
       
-      //write the data out to the output file.
-      for (int band=0; band<outputraster_.nbands(); band++)
-        outputraster_.setData(outputdata, chunkdims, band+1, outputraster_.dataType(), band);
+          //write the data out to the output file.
+          PerfScope scope("DataRaster::setData", PerfTypeName<float>::name(), NULL, (unsigned long long)chunkdims.npixels() * sizeof(float));
+          for (int band=0; band<outputraster_.nbands(); band++)
+            outputraster_.setData(outputdata, chunkdims, band+1, outputraster_.dataType(), band);
+          break;
+        }
+      }
+
+      //the input is still live and the output blocks are in the GDAL cache
+      if (memoryProfile_)
+        memoryProfile_->sample();
+      completetile(manifest, tilenum, checksum);
     }
-    
-    //close the file to ensure the data is written to the file.
-    outputraster_.close();
+    if (memoryProfile_)
+      memoryProfile_->end();
   };
 
 
@@ -70,45 +367,325 @@ public:
      * @param inputfilename The pathname to the multispectral file that NDVI will be computed for.
      *   The input file must contain 4 bands and is assumed to be int he order Blue,Green,Red,NIR
      * @param outputfilename The filename of the output file that will contain the computed NDVI results.
+     * @param outputType The data type of the output file.  GDT_Float32 stores NDVI directly.  GDT_Int16
+     *   (NDVI * 10000), GDT_UInt16 and GDT_Byte store scaled integers, with the scale, offset and nodata
+     *   value written to the output file.  Chunks without input data are not written, so the output
+     *   GeoTIFF is created sparse and those blocks read back as nodata.
      */
-    Ndvi(const std::string& inputfilename, const std::string& outputfilename) throw(Exception)
+    Ndvi(const std::string& inputfilename, const std::string& outputfilename,
+      GDALDataType outputType = GDT_Float32) throw(Exception)
+      : inputraster_(ownedinputraster_), outputraster_(ownedoutputraster_), externaloutput_(false),
+        quantizer_(Quantizer::unitRange(outputType)), inputfilename_(inputfilename),
+        outputfilename_(outputfilename), outputType_(outputType), tilesProcessed_(0), halfPrecision_(false), lutBits_(0), shard_(0), nshards_(1),
+        preview_(false), previewResampling_(GRIORA_Average), memoryProfile_(NULL)
     {
+      if (outputType_ != GDT_Float32 && outputType_ != GDT_Int16 && outputType_ != GDT_UInt16 && outputType_ != GDT_Byte)
+        throw Exception("Ndvi: Error: output data type not implemented.");
       inputraster_.open(inputfilename, GA_ReadOnly);  //open the input raster
       if (inputraster_.nbands() != 4)
         throw Exception("The input data must contain 4 bands.");
-        
-      //create the output raster
-      outputraster_.create(outputfilename, inputraster_.dims(), 1, GDT_Float32, "GTiff", &inputraster_);
+    };
+
+    /** Constructor for rasters the caller has opened, e.g. in memory rasters from DataRaster::createInMemory
+     *  or DataRaster::wrap, so a chip can be processed without touching the filesystem.  Both rasters stay
+     *  open after run() and must outlive this object.
+     * @param input The multispectral raster, 4 bands in the order Blue,Green,Red,NIR
+     * @param output A single band raster with the dimensions of the input, open for update.  Its data type
+     *   is the output type, one of GDT_Float32, GDT_Int16, GDT_UInt16 and GDT_Byte, as for the filename constructor.
+     *   An output smaller than the input receives a preview: the input is read at the output's resolution,
+     *   see DataRaster::getPreview and setPreviewResampling, and NDVI is computed on the reduced data.
+     */
+    Ndvi(DataRaster& input, DataRaster& output) throw(Exception)
+      : inputraster_(input), outputraster_(output), externaloutput_(true),
+        quantizer_(Quantizer::unitRange(output.dataType())), outputType_(output.dataType()), tilesProcessed_(0),
+        halfPrecision_(false), lutBits_(0), shard_(0), nshards_(1), preview_(false), previewResampling_(GRIORA_Average),
+        memoryProfile_(NULL)
+    {
+      if (inputraster_.nbands() != 4)
+        throw Exception("The input data must contain 4 bands.");
+      if (outputraster_.nbands() != 1 || outputraster_.nsamples() > inputraster_.nsamples() || outputraster_.nlines() > inputraster_.nlines())
+        throw Exception("Ndvi: Error: the output must have one band and at most the dimensions of the input.");
+      preview_ = !(outputraster_.dims() == inputraster_.dims());
+      if (outputType_ != GDT_Float32 && outputType_ != GDT_Int16 && outputType_ != GDT_UInt16 && outputType_ != GDT_Byte)
+        throw Exception("Ndvi: Error: output data type not implemented.");
     };
     
     //* Destructor */
     virtual ~Ndvi(void) 
     {
-      inputraster_.close();
-      outputraster_.close();
+      ownedinputraster_.close();
+      ownedoutputraster_.close();
     };
     
+    /** The NDVI of one pixel.  Every kernel and lookup table evaluates it through this expression, in single
+     *  precision, so a pixel gets the same value whichever path computes it.
+     * @param band4val The NIR value
+     * @param band3val The red value
+     */
+    static inline float ndvi(float band4val, float band3val)
+    {
+      return((band4val - band3val) / (band4val + band3val + 1e-6f));
+    };
+
+    /** The NDVI of one pixel, evaluated exactly as processchunk does.  Used to build lookup tables. */
+    template <typename T> struct Value
+    {
+      float operator()(T band4, T band3) const
+      {
+        return(ndvi(static_cast<float>(band4), static_cast<float>(band3)));
+      };
+    };
+
+    /** The quantized NDVI of one pixel, evaluated exactly as the quantizing processchunk does.  Used to build lookup tables. */
+    template <typename T, typename OutT> struct QuantizedValue
+    {
+      const Quantizer& quantizer;
+      bool hasNoData;
+      T noData;
+
+      QuantizedValue(const Quantizer& q, bool hasNd, double nd) : quantizer(q), hasNoData(hasNd), noData(static_cast<T>(nd)) {};
+
+      OutT operator()(T band4, T band3) const
+      {
+        if (hasNoData && (band4 == noData || band3 == noData))
+          return(static_cast<OutT>(quantizer.noData()));
+        return(quantizer.quantize<OutT>(ndvi(static_cast<float>(band4), static_cast<float>(band3))));
+      };
+    };
+
+    /** Processes a chunk of imagery by table lookup.  The results are identical to the arithmetic kernel
+     *  the table was built from, e.g. with Value<T> or QuantizedValue<T, OutT>.
+     * @param inputdata A data buffer containing a chunk of imagery to be processed.
+     * @param outputdata A data buffer for storing the output.
+     * @param lut The table
+     * @return false, with the output untouched, if the chunk holds values beyond the bit depth of the table
+     */
+    template <typename T, typename OutT> static bool processchunk(DataBuffer<T>& inputdata, DataBuffer<OutT>& outputdata,
+      const BandRatioLut& lut)
+    {
+      RowView<T> band4 = inputdata.band(3).flat();  //the 4th band
+      RowView<T> band3 = inputdata.band(2).flat();  //the 3rd band
+      RowView<OutT> output = outputdata.band(0).flat();
+      PerfScope scope("BandRatioLut::apply", PerfTypeName<T>::name(), PerfTypeName<OutT>::name(),
+        (unsigned long long)output.size() * (2 * sizeof(T) + sizeof(OutT)));
+      return(lut.apply(band4.data(), band3.data(), output.data(), output.size()));
+    };
+
     /** Processes a chunk of imagery.  This method is public so it can be called by clients who just want a chunk of data processed rather than an output file.
      * @param inputdata A data buffer containing a chunk of imagery to be processed.
      * @param outputdata A data buffer for storing the output.
      */
     template <typename T> static void processchunk(DataBuffer<T>& inputdata, DataBuffer<float>& outputdata)
     { 
-      int sz = inputdata.dims().width() * inputdata.dims().height();  //the size of 1 band of data
+      long long sz = inputdata.dims().npixels();  //the size of 1 band of data
       T* band4ptr = inputdata.data() + sz * 3;  //wind ptr forward to the 4th band
       T* band3ptr = inputdata.data() + sz * 2;  //wind ptr forward to the 3rd band
       float* outputptr = outputdata.data();  //ptr to the output data
+      PerfScope scope("Ndvi::processchunk", PerfTypeName<T>::name(), PerfTypeName<float>::name(), (unsigned long long)sz * (2 * sizeof(T) + sizeof(float)));
       
       //loop through all the pixels in the band and compute the NDVI
-      for (int idx=0; idx<sz; idx++)
+      for (long long idx=0; idx<sz; idx++)
       {
         float band4val = static_cast<float>(band4ptr[idx]);
         float band3val = static_cast<float>(band3ptr[idx]);
-        outputptr[idx] = (band4val - band3val) / (band4val + band3val + 1e-6);  //NDVI calculation
+        outputptr[idx] = ndvi(band4val, band3val);  //NDVI calculation
       }
     
     };
     
+    /** Processes a chunk of imagery into a scaled integer output.  NDVI is computed in single precision and
+     *  quantized in the same pass, so no intermediate float buffer is written.
+     * @param inputdata A data buffer containing a chunk of imagery to be processed.
+     * @param outputdata A data buffer for storing the quantized output.
+     * @param quantizer The mapping from NDVI to stored values.
+     * @param hasNoData Set to true if the input has a nodata value.
+     * @param noData The input nodata value.  Pixels where the red or NIR band equals it are written as output nodata.
+     */
+    template <typename T, typename OutT> static void processchunk(DataBuffer<T>& inputdata, DataBuffer<OutT>& outputdata,
+      const Quantizer& quantizer, bool hasNoData = false, double noData = 0.0)
+    {
+      RowView<T> band4 = inputdata.band(3).flat();  //the 4th band
+      RowView<T> band3 = inputdata.band(2).flat();  //the 3rd band
+      RowView<OutT> output = outputdata.band(0).flat();
+      long long sz = output.size();
+      OutT outNoData = static_cast<OutT>(quantizer.noData());
+      PerfScope scope("Ndvi::processchunk", PerfTypeName<T>::name(), PerfTypeName<OutT>::name(), (unsigned long long)sz * (2 * sizeof(T) + sizeof(OutT)));
+
+      if (!hasNoData)
+      {
+        for (long long idx=0; idx<sz; idx++)
+        {
+          float band4val = static_cast<float>(band4[idx]);
+          float band3val = static_cast<float>(band3[idx]);
+          output[idx] = quantizer.quantize<OutT>(ndvi(band4val, band3val));
+        }
+        return;
+      }
+
+      T inNoData = static_cast<T>(noData);
+      for (long long idx=0; idx<sz; idx++)
+      {
+        float band4val = static_cast<float>(band4[idx]);
+        float band3val = static_cast<float>(band3[idx]);
+        OutT val = quantizer.quantize<OutT>(ndvi(band4val, band3val));
+        //integer outputs blend nodata in arithmetically so the loop stays branch free and vectorizes
+        int masked = ((band4[idx] == inNoData) | (band3[idx] == inNoData)) ? 1 : 0;
+        output[idx] = std::numeric_limits<OutT>::is_integer ? static_cast<OutT>(val + masked * (outNoData - val)) : (masked ? outNoData : val);
+      }
+    };
+    
+    /** Enables checkpointing.  Completed tiles are recorded in a manifest together with a checksum of
+     *  their input window.  A later run with the same manifest, input and output skips tiles that are
+     *  complete and unchanged, so only tiles missing after a failure or affected by an input edit are
+     *  recomputed.  Call before run().
+     * @param manifestfilename The filename of the manifest
+     */
+    void setCheckpointFile(const std::string& manifestfilename) { manifestfilename_ = manifestfilename; };
+
+    /** Stores the NDVI at half precision, halving the memory of the output buffers and the bytes written.
+     *  NDVI is still computed in single precision and rounded on store.  The output is a Float16 band
+     *  where GDAL supports it and a Float32 GeoTIFF band with NBITS=16 otherwise.  Only valid with the
+     *  default GDT_Float32 output type.  Call before run().
+     * @param enable Set to true to store half precision values
+     */
+    void setHalfPrecisionOutput(bool enable = true) throw(Exception)
+    {
+      if (enable && outputType_ != GDT_Float32)
+        throw Exception("Ndvi::setHalfPrecisionOutput Error: half precision requires a GDT_Float32 output type.");
+      halfPrecision_ = enable;
+    };
+
+    /** Sets the resampling used to read the input of a preview, see the constructor for rasters.  The default
+     *  is GRIORA_Average; GRIORA_NearestNeighbour reads the fewest pixels when there are no overviews.
+     * @param resampling The resampling
+     */
+    void setPreviewResampling(GDALRIOResampleAlg resampling) { previewResampling_ = resampling; };
+
+    /** Returns true if run() computes a preview at a reduced resolution */
+    bool preview(void) const { return(preview_); };
+
+    /** Computes a preview of the NDVI of a file, e.g. a QA thumbnail, without processing the full resolution
+     *  scene.  The output covers the extent of the input with its georeferencing scaled to the preview.
+     *  Checkpointing and sharding do not apply.
+     * @param inputfilename The pathname to the multispectral file, as for the constructor
+     * @param outputfilename The filename of the preview GeoTIFF
+     * @param maxsize The size in pixels of the longer side of the preview, see DataRaster::previewDims
+     * @param outputType The data type of the output file, as for the constructor
+     * @param resampling The resampling used to read the input, see setPreviewResampling
+     */
+    static void preview(const std::string& inputfilename, const std::string& outputfilename, int maxsize = 1024,
+      GDALDataType outputType = GDT_Float32, GDALRIOResampleAlg resampling = GRIORA_Average) throw(Exception)
+    {
+      DataRaster input;
+      input.open(inputfilename, GA_ReadOnly);
+      RasterDims dims = input.previewDims(maxsize);
+      DataRaster output;
+      output.create(outputfilename, dims, 1, outputType, "GTiff", &input);
+      double gt[6];
+      if (input.getGeoTransform(gt))
+      {
+        double scalex = (double)input.nsamples() / (double)dims.width(), scaley = (double)input.nlines() / (double)dims.height();
+        gt[1] *= scalex;
+        gt[2] *= scaley;
+        gt[4] *= scalex;
+        gt[5] *= scaley;
+        output.setGeoTransform(gt);
+      }
+
+      Ndvi ndvicalc(input, output);
+      ndvicalc.setPreviewResampling(resampling);
+      ndvicalc.run();
+      output.close();
+    };
+
+    /** Restricts the run to one shard of the tiles.  The output is still a full size raster, in which only
+     *  the shard's tiles are written.  Use runSharded() to run every shard and merge the outputs.
+     *  Call before run().
+     * @param shard The zero based shard number
+     * @param nshards The number of shards
+     */
+    void setShard(int shard, int nshards) throw(Exception)
+    {
+      if (nshards < 1 || shard < 0 || shard >= nshards)
+        throw Exception("Ndvi::setShard Error: invalid shard.");
+      shard_ = shard;
+      nshards_ = nshards;
+    };
+
+    /** Computes NDVI in nshards local worker processes, each writing a partial output next to the output
+     *  file, then merges the partial outputs into the output file.  Shards recorded as complete in the
+     *  manifest by an earlier run are not rerun.  The partial outputs are removed after the merge.
+     * @param inputfilename The pathname to the multispectral file, as for the constructor
+     * @param outputfilename The filename of the merged output
+     * @param nshards The number of shards and worker processes
+     * @param outputType The data type of the output file, as for the constructor
+     * @param halfPrecision Set to true to store half precision values, see setHalfPrecisionOutput()
+     */
+    static void runSharded(const std::string& inputfilename, const std::string& outputfilename, int nshards,
+      GDALDataType outputType = GDT_Float32, bool halfPrecision = false) throw(Exception)
+    {
+      //the shard regions follow the tiling the workers use.  The input is closed before the workers start.
+      std::vector<std::string> shardfilenames;
+      std::vector<RasterDims> regions;
+      std::ostringstream parameters;
+      {
+        Ndvi ndvicalc(inputfilename, outputfilename, outputType);
+        ndvicalc.setHalfPrecisionOutput(halfPrecision);
+        parameters << ndvicalc.checkpointparameters(chunkmemsize());
+        DataRasterIterator iter(ndvicalc.inputraster_, chunkmemsize(), 0);
+        for (int shard=0; shard<nshards; shard++)
+        {
+          RasterDims region;
+          if (iter.getShardDims(shard, nshards, region))
+          {
+            shardfilenames.push_back(ShardedRun::shardFilename(outputfilename, shard));
+            regions.push_back(region);
+          }
+        }
+      }
+
+      ShardJob job;
+      job.inputfilename = inputfilename;
+      job.outputfilename = outputfilename;
+      job.outputType = outputType;
+      job.halfPrecision = halfPrecision;
+      std::string manifestfilename = outputfilename + ".shards";
+      {
+        ShardedRun sharded(manifestfilename, parameters.str(), nshards);
+        sharded.run(shardworker, &job);
+      }
+
+      std::vector<std::string> options(1, std::string("SPARSE_OK=TRUE"));
+#if !defined(GDAL_VERSION_NUM) || GDAL_VERSION_NUM < 3110000
+      if (halfPrecision)
+        options.push_back(std::string("NBITS=16"));
+#endif
+      ShardedRun::merge(shardfilenames, regions, outputfilename, options);
+      for (int shard=0; shard<nshards; shard++)
+        remove(ShardedRun::shardFilename(outputfilename, shard).c_str());
+      remove(manifestfilename.c_str());
+    };
+
+    /** Sets the number of threads used to decode the input, see DataRaster::setDecodeThreads().  An input
+     *  passed in by the caller is changed as well.
+     * @param nthreads The number of threads
+     */
+    void setDecodeThreads(int nthreads) throw(Exception) { inputraster_.setDecodeThreads(nthreads); };
+
+    /** Sets a persistent cache of decoded input windows, see DataRaster::setTileCache().
+     * @param cache The cache, or NULL
+     */
+    void setTileCache(TileCache* cache) { inputraster_.setTileCache(cache); };
+
+    /** Records the memory high water marks of each run and of its tiles, see MemoryProfile.  Buffers are
+     *  accounted to the sites Ndvi::input and Ndvi::output.
+     * @param profile The profile, or NULL.  It must outlive the runs.
+     */
+    void setMemoryProfile(MemoryProfile* profile) { memoryProfile_ = profile; };
+
+    /** Returns the number of tiles computed and written by the last run. */
+    int tilesProcessed(void) const { return(tilesProcessed_); };
+
     /** Runs the algorithm.  Most clients should call this method after constructing the object. */
     void run(void)
     {
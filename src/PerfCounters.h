@@ -0,0 +1,408 @@
+#ifndef _PERFCOUNTERSH_
+#define _PERFCOUNTERSH_
+//================================================================
+//
+// File: PerfCounters.h
+// Created: 10/19/2026
+// Purpose: Hardware performance counters scoped around kernels
+//          and I/O, aggregated per kernel
+//
+//================================================================
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <sstream>
+#include <iomanip>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "PerfTypeName.h"
+
+/** Enumeration for the hardware events counted around a scope */
+enum PerfEvent
+{
+  PerfCycles = 0,           //CPU cycles
+  PerfInstructions = 1,     //instructions retired
+  PerfCacheMisses = 2,      //last level cache misses
+  PerfBranchMisses = 3,     //mispredicted branches
+  PerfEventCount = 4
+};
+
+/** PerfStats: the totals of one kernel over every scope recorded for it */
+struct PerfStats
+{
+  long long calls;
+  double seconds;
+  unsigned long long bytes;
+  long long counts[PerfEventCount];   //-1 where the counter was unavailable
+
+  PerfStats(void) : calls(0), seconds(0.0), bytes(0)
+  {
+    for (int event=0; event<PerfEventCount; event++)
+      counts[event] = -1;
+  };
+
+  /** Returns true if the event was counted */
+  bool has(PerfEvent event) const { return(counts[event] >= 0); };
+
+  /** Returns instructions per cycle, or 0 if either was not counted */
+  double ipc(void) const
+  {
+    return((counts[PerfCycles] > 0 && has(PerfInstructions)) ? (double)counts[PerfInstructions] / (double)counts[PerfCycles] : 0.0);
+  };
+
+  /** Returns the bytes the kernel read and wrote per cycle, or 0 if cycles were not counted */
+  double bytesPerCycle(void) const
+  {
+    return((counts[PerfCycles] > 0) ? (double)bytes / (double)counts[PerfCycles] : 0.0);
+  };
+};
+
+/** PerfCounters: collects wall time and hardware counters around kernel and I/O calls, see PerfScope.
+ *  Collection is off until setEnabled is called, and a disabled scope costs a flag test.  The counters
+ *  are read with perf_event_open, for the user space of the calling thread only: threads a kernel starts
+ *  and time spent in the kernel, e.g. decoding inside system calls, are not counted.  Each thread opens
+ *  its counters once.  Where perf_event_open is missing or refused, as in most containers and under a
+ *  restrictive perf_event_paranoid, or an event is not supported, e.g. in virtual machines, the
+ *  counts are reported as unavailable and calls, wall time and bytes are still collected.
+ *  All methods are thread safe.
+ */
+class PerfCounters
+{
+
+private:
+
+  /** The counters of one thread.  This is an internal class. */
+  class Group
+  {
+  public:
+    int leader_;
+    std::vector<int> fds_;
+    std::vector<int> events_;
+
+    Group(void) : leader_(-1) {};
+
+    ~Group(void)
+    {
+      for (size_t idx=0; idx<fds_.size(); idx++)
+        close(fds_[idx]);
+    };
+
+    /** Opens the events that are supported as one group.  Returns false if none could be opened. */
+    bool open(void)
+    {
+#ifdef __linux__
+      static const unsigned long long configs[PerfEventCount] =
+        { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+      for (int event=0; event<PerfEventCount; event++)
+      {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[event];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leader_, 0);
+        if (fd < 0)
+          continue;
+        leader_ = (leader_ < 0) ? fd : leader_;
+        fds_.push_back(fd);
+        events_.push_back(event);
+      }
+#endif
+      return(!fds_.empty());
+    };
+
+    /** Reads the running totals, scaled when the events were multiplexed.  Returns false on failure. */
+    bool read(long long* counts)
+    {
+      for (int event=0; event<PerfEventCount; event++)
+        counts[event] = -1;
+      unsigned long long values[3 + PerfEventCount];
+      ssize_t nbytes = ::read(leader_, values, sizeof(values));
+      if (nbytes < (ssize_t)(3 * sizeof(unsigned long long)) || values[0] != (unsigned long long)events_.size())
+        return(false);
+      double scale = (values[2] > 0 && values[2] < values[1]) ? (double)values[1] / (double)values[2] : 1.0;
+      for (size_t idx=0; idx<events_.size(); idx++)
+        counts[events_[idx]] = (long long)((double)values[3 + idx] * scale);
+      return(true);
+    };
+  };
+
+  pthread_mutex_t mutex_;
+  pthread_key_t key_;
+  volatile bool enabled_;
+  bool useCounters_;
+  int available_;   //-1 unknown, 0 unavailable, 1 available
+  std::map<std::string, PerfStats> stats_;
+
+  /** Scoped lock of the mutex.  This is an internal class. */
+  class Lock
+  {
+    pthread_mutex_t* mutex_;
+  public:
+    Lock(pthread_mutex_t* mutex) : mutex_(mutex) { pthread_mutex_lock(mutex_); };
+    ~Lock(void) { pthread_mutex_unlock(mutex_); };
+  };
+
+  /** Closes the counters of a thread when it exits.  This is an internal method. */
+  static void closeGroup(void* group) { delete(static_cast<Group*>(group)); };
+
+  /** Constructor.  There is one PerfCounters per process, see instance(). */
+  PerfCounters(void) : enabled_(false), useCounters_(true), available_(-1)
+  {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_key_create(&key_, closeGroup);
+  };
+
+  PerfCounters(const PerfCounters&);
+  PerfCounters& operator=(const PerfCounters&);
+
+  /** Returns the counters of the calling thread, opening them the first time, or NULL where they are
+   *  unavailable.  This is an internal method.
+   */
+  Group* group(void)
+  {
+    {
+      Lock lock(&mutex_);
+      if (!useCounters_ || available_ == 0)
+        return(NULL);
+    }
+    Group* current = static_cast<Group*>(pthread_getspecific(key_));
+    if (current)
+      return(current);
+
+    current = new Group;
+    bool opened = current->open();
+    {
+      Lock lock(&mutex_);
+      available_ = (opened || available_ == 1) ? 1 : 0;
+    }
+    if (!opened)
+    {
+      delete(current);
+      return(NULL);
+    }
+    pthread_setspecific(key_, current);
+    return(current);
+  };
+
+public:
+
+  /** Returns the PerfCounters of the process */
+  static PerfCounters& instance(void)
+  {
+    static PerfCounters counters;
+    return(counters);
+  };
+
+  /** Destructor */
+  virtual ~PerfCounters(void)
+  {
+    pthread_mutex_destroy(&mutex_);
+  };
+
+  /** Turns collection on or off.  Scopes started while it is off are not recorded. */
+  void setEnabled(bool enable = true) { enabled_ = enable; };
+
+  /** Returns true if collection is on */
+  bool enabled(void) const { return(enabled_); };
+
+  /** Sets whether hardware counters are read.  With counters off only calls, wall time and bytes are
+   *  collected, e.g. to measure the overhead of the counters.
+   */
+  void setUseCounters(bool use)
+  {
+    Lock lock(&mutex_);
+    useCounters_ = use;
+  };
+
+  /** Returns true if hardware counters can be read on the calling thread */
+  bool countersAvailable(void)
+  {
+    return(group() != NULL);
+  };
+
+  /** Reads the running wall time and counter totals of the calling thread.  Called by PerfScope.
+   * @param seconds The monotonic time in seconds
+   * @param counts The counter totals, -1 where unavailable
+   */
+  void sample(double& seconds, long long* counts)
+  {
+    Group* current = group();
+    if (!current || !current->read(counts))
+    {
+      for (int event=0; event<PerfEventCount; event++)
+        counts[event] = -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    seconds = (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+  };
+
+  /** Adds one scope to the totals of a kernel.  Called by PerfScope.
+   * @param name The kernel, e.g. "Ndvi::processchunk<uint16,float32>"
+   * @param seconds The wall time of the scope
+   * @param bytes The bytes the scope read and wrote
+   * @param counts The counts of the scope, -1 where unavailable
+   */
+  void record(const std::string& name, double seconds, unsigned long long bytes, const long long* counts)
+  {
+    Lock lock(&mutex_);
+    PerfStats& stats = stats_[name];
+    stats.calls++;
+    stats.seconds += seconds;
+    stats.bytes += bytes;
+    for (int event=0; event<PerfEventCount; event++)
+    {
+      if (counts[event] >= 0)
+        stats.counts[event] = ((stats.counts[event] < 0) ? 0 : stats.counts[event]) + counts[event];
+    }
+  };
+
+  /** Returns the totals of a kernel.  calls is 0 if nothing was recorded for it. */
+  PerfStats stats(const std::string& name)
+  {
+    Lock lock(&mutex_);
+    std::map<std::string, PerfStats>::const_iterator iter = stats_.find(name);
+    return((iter == stats_.end()) ? PerfStats() : iter->second);
+  };
+
+  /** Returns the names of the kernels recorded, in alphabetical order */
+  std::vector<std::string> names(void)
+  {
+    Lock lock(&mutex_);
+    std::vector<std::string> result;
+    for (std::map<std::string, PerfStats>::const_iterator iter=stats_.begin(); iter!=stats_.end(); ++iter)
+      result.push_back(iter->first);
+    return(result);
+  };
+
+  /** Discards the totals */
+  void reset(void)
+  {
+    Lock lock(&mutex_);
+    stats_.clear();
+  };
+
+  /** Writes a table of the totals of every kernel: calls, seconds, MB, cycles, IPC, bytes per cycle,
+   *  LLC misses per thousand instructions and branch misses per thousand instructions.  Counts that
+   *  were unavailable are shown as n/a.
+   * @param ostr The stream
+   */
+  void report(std::ostream& ostr)
+  {
+    Lock lock(&mutex_);
+    ostr << std::left << std::setw(48) << "kernel" << std::right << std::setw(8) << "calls" << std::setw(11) << "seconds"
+         << std::setw(11) << "MB" << std::setw(14) << "cycles" << std::setw(7) << "IPC" << std::setw(10) << "B/cycle"
+         << std::setw(10) << "LLC/kI" << std::setw(10) << "br/kI" << std::endl;
+    for (std::map<std::string, PerfStats>::const_iterator iter=stats_.begin(); iter!=stats_.end(); ++iter)
+    {
+      const PerfStats& stats = iter->second;
+      double kinstructions = stats.has(PerfInstructions) ? (double)stats.counts[PerfInstructions] / 1000.0 : 0.0;
+      ostr << std::left << std::setw(48) << iter->first << std::right << std::setw(8) << stats.calls
+           << std::fixed << std::setprecision(4) << std::setw(11) << stats.seconds
+           << std::setprecision(1) << std::setw(11) << (double)stats.bytes / (1024.0 * 1024.0);
+      if (stats.has(PerfCycles))
+        ostr << std::setw(14) << stats.counts[PerfCycles];
+      else
+        ostr << std::setw(14) << "n/a";
+      if (stats.has(PerfCycles) && stats.has(PerfInstructions))
+        ostr << std::setprecision(2) << std::setw(7) << stats.ipc();
+      else
+        ostr << std::setw(7) << "n/a";
+      if (stats.has(PerfCycles))
+        ostr << std::setprecision(2) << std::setw(10) << stats.bytesPerCycle();
+      else
+        ostr << std::setw(10) << "n/a";
+      if (stats.has(PerfCacheMisses) && kinstructions > 0.0)
+        ostr << std::setprecision(2) << std::setw(10) << (double)stats.counts[PerfCacheMisses] / kinstructions;
+      else
+        ostr << std::setw(10) << "n/a";
+      if (stats.has(PerfBranchMisses) && kinstructions > 0.0)
+        ostr << std::setprecision(2) << std::setw(10) << (double)stats.counts[PerfBranchMisses] / kinstructions;
+      else
+        ostr << std::setw(10) << "n/a";
+      ostr << std::endl;
+    }
+    ostr.unsetf(std::ios::fixed);
+  };
+
+};
+
+/** PerfScope: records the wall time and counters of its lifetime under a kernel name, see PerfCounters.
+ *  The name is the kernel followed by up to two element types, e.g. Ndvi::processchunk<uint16,float32>.
+ *  Nothing is read or recorded while PerfCounters is disabled.
+ */
+class PerfScope
+{
+
+private:
+
+  const char* kernel_;
+  const char* type_;
+  const char* type2_;
+  unsigned long long bytes_;
+  bool active_;
+  double start_;
+  long long counts_[PerfEventCount];
+
+  PerfScope(const PerfScope&);
+  PerfScope& operator=(const PerfScope&);
+
+public:
+
+  /** Constructor.  Starts the scope.
+   * @param kernel The kernel, e.g. "Ndvi::processchunk".  The string must outlive the scope.
+   * @param type The element type the kernel is instantiated for, e.g. PerfTypeName<T>::name(), or NULL
+   * @param type2 A second element type, e.g. of the output, or NULL
+   * @param bytes The bytes the scope reads and writes, for bytes per cycle
+   */
+  PerfScope(const char* kernel, const char* type = NULL, const char* type2 = NULL, unsigned long long bytes = 0)
+    : kernel_(kernel), type_(type), type2_(type2), bytes_(bytes), active_(PerfCounters::instance().enabled()), start_(0.0)
+  {
+    if (active_)
+      PerfCounters::instance().sample(start_, counts_);
+  };
+
+  /** Destructor.  Ends the scope and records it. */
+  ~PerfScope(void)
+  {
+    if (!active_)
+      return;
+    double end = 0.0;
+    long long counts[PerfEventCount];
+    PerfCounters::instance().sample(end, counts);
+    for (int event=0; event<PerfEventCount; event++)
+      counts[event] = (counts[event] >= 0 && counts_[event] >= 0) ? counts[event] - counts_[event] : -1;
+
+    std::string name(kernel_);
+    if (type_)
+    {
+      name += "<";
+      name += type_;
+      if (type2_)
+      {
+        name += ",";
+        name += type2_;
+      }
+      name += ">";
+    }
+    PerfCounters::instance().record(name, end - start_, bytes_, counts);
+  };
+
+  /** Sets the bytes the scope reads and writes, when they are only known once the work is done */
+  void setBytes(unsigned long long bytes) { bytes_ = bytes; };
+
+};
+#endif
@@ -0,0 +1,25 @@
+#ifndef _PERFTYPENAMEH_
+#define _PERFTYPENAMEH_
+//================================================================
+//
+// File: PerfTypeName.h
+// Created: 10/19/2026
+// Purpose: Short names of pixel element types for kernel and
+//          memory accounting reports
+//
+//================================================================
+
+#include "Float16.h"
+
+/** The name of an element type in kernel names and memory reports, e.g. "uint16" */
+template <typename T> struct PerfTypeName { static const char* name(void) { return("unknown"); }; };
+template <> struct PerfTypeName<unsigned char> { static const char* name(void) { return("uint8"); }; };
+template <> struct PerfTypeName<short> { static const char* name(void) { return("int16"); }; };
+template <> struct PerfTypeName<unsigned short> { static const char* name(void) { return("uint16"); }; };
+template <> struct PerfTypeName<int> { static const char* name(void) { return("int32"); }; };
+template <> struct PerfTypeName<unsigned int> { static const char* name(void) { return("uint32"); }; };
+template <> struct PerfTypeName<float16> { static const char* name(void) { return("float16"); }; };
+template <> struct PerfTypeName<float> { static const char* name(void) { return("float32"); }; };
+template <> struct PerfTypeName<double> { static const char* name(void) { return("float64"); }; };
+
+#endif
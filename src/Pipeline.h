@@ -0,0 +1,523 @@
+#ifndef _PIPELINEH_
+#define _PIPELINEH_
+//================================================================
+//
+// File: Pipeline.h
+// Created: 10/19/2026
+// Purpose: A lazily evaluated chain of tile operators that is run
+//          tile by tile over a DataRaster.
+//
+//================================================================
+
+#include <math.h>
+#include <vector>
+#include <limits>
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "DataRasterIterator.h"
+#include "RasterDims.h"
+#include "Quantizer.h"
+#include "PerfCounters.h"
+#include "MemoryProfile.h"
+
+/** TileOperator: the base class for an operator in a Pipeline.
+ *  Operators work on single precision tiles.  A tile covers the input tile dimensions, which include
+ *  the overlap the pipeline derived from its operators; outputdims is the part of the tile that is kept.
+ */
+class TileOperator
+{
+
+public:
+
+  /** Destructor */
+  virtual ~TileOperator(void) {};
+
+  /** Returns the number of pixels of context this operator needs on each side of an output pixel */
+  virtual int overlap(void) const { return(0); };
+
+  /** Returns the name the operator is reported under, see PerfCounters */
+  virtual const char* name(void) const { return("TileOperator"); };
+
+  /** Called once before the first tile
+   * @param source The raster the pipeline reads from
+   */
+  virtual void begin(const DataRaster& source) { (void)source; };
+
+  /** Processes a tile.  The operator either modifies the tile in place, or builds a new buffer and
+   *  swaps it into the tile, see DataBuffer::swap, so the input is released when the new buffer goes out
+   *  of scope.  Tiles are never copied between operators.
+   * @param tile The tile produced by the previous operator, replaced by the result
+   * @param outputdims The part of the tile that will be kept, in image coordinates
+   */
+  virtual void process(DataBuffer<float>& tile, const RasterDims& outputdims) = 0;
+
+  /** Called once after the last tile */
+  virtual void end(void) {};
+
+};
+
+/** NormalizedDifferenceOp: computes (a - b) / (a + b) from two bands, e.g. NDVI from NIR and red. */
+class NormalizedDifferenceOp : public TileOperator
+{
+
+private:
+
+  int bandA_;
+  int bandB_;
+
+public:
+
+  /** Constructor.
+   * @param bandA The zero based index of the first band, e.g. NIR
+   * @param bandB The zero based index of the second band, e.g. red
+   */
+  NormalizedDifferenceOp(int bandA, int bandB) : bandA_(bandA), bandB_(bandB) {};
+
+  const char* name(void) const { return("NormalizedDifferenceOp"); };
+
+  void process(DataBuffer<float>& tile, const RasterDims& outputdims) throw(Exception)
+  {
+    (void)outputdims;
+    if (bandA_ >= tile.nbands() || bandB_ >= tile.nbands())
+      throw Exception("NormalizedDifferenceOp::process Error: band exceeds dimensions of buffer.");
+
+    DataBuffer<float> output(tile.dims(), 1, false);
+    RowView<float> a = tile.band(bandA_).flat();
+    RowView<float> b = tile.band(bandB_).flat();
+    RowView<float> out = output.band(0).flat();
+    for (long long idx=0; idx<out.size(); idx++)
+      out[idx] = (a[idx] - b[idx]) / (a[idx] + b[idx] + 1e-6f);
+    tile.swap(output);
+  };
+
+};
+
+/** BandMathOp: applies a per pixel function to the bands of a tile and produces a single band. */
+class BandMathOp : public TileOperator
+{
+
+public:
+
+  /** A per pixel function.  values holds one value per input band. */
+  typedef float (*Function)(const float* values, int nbands);
+
+private:
+
+  Function function_;
+
+public:
+
+  /** Constructor.
+   * @param function The function to apply
+   */
+  BandMathOp(Function function) : function_(function) {};
+
+  const char* name(void) const { return("BandMathOp"); };
+
+  void process(DataBuffer<float>& tile, const RasterDims& outputdims)
+  {
+    (void)outputdims;
+    long long sz = (long long)tile.width() * tile.height();
+    int nbands = tile.nbands();
+    DataBuffer<float> output(tile.dims(), 1, false);
+    const float* inptr = tile.data();
+    float* outptr = output.data();
+    std::vector<float> values(nbands);
+    for (long long idx=0; idx<sz; idx++)
+    {
+      for (int band=0; band<nbands; band++)
+        values[band] = inptr[sz * band + idx];
+      outptr[idx] = function_(&values[0], nbands);
+    }
+    tile.swap(output);
+  };
+
+};
+
+/** BoxFilterOp: a separable mean filter over a (2 * radius + 1) square window.  Edges are clamped. */
+class BoxFilterOp : public TileOperator
+{
+
+private:
+
+  int radius_;
+
+public:
+
+  /** Constructor.
+   * @param radius The radius of the filter window in pixels
+   */
+  BoxFilterOp(int radius) : radius_(radius) {};
+
+  int overlap(void) const { return(radius_); };
+
+  const char* name(void) const { return("BoxFilterOp"); };
+
+  void process(DataBuffer<float>& tile, const RasterDims& outputdims)
+  {
+    (void)outputdims;
+    int width = tile.width();
+    int height = tile.height();
+    float norm = 1.0f / (float)(2 * radius_ + 1);
+    DataBuffer<float> output(tile.dims(), tile.nbands(), false);
+    DataBuffer<float> rows(tile.dims(), 1, false);
+    DataView<float> tmp = rows.band(0);
+
+    for (int band=0; band<tile.nbands(); band++)
+    {
+      DataView<float> in = tile.band(band);
+      DataView<float> out = output.band(band);
+
+      //horizontal pass
+      for (int yy=0; yy<height; yy++)
+      {
+        RowView<float> inrow = in.row(yy);
+        RowView<float> row = tmp.row(yy);
+        for (int xx=0; xx<width; xx++)
+        {
+          float sum = 0.0f;
+          for (int kk=-radius_; kk<=radius_; kk++)
+          {
+            int x = xx + kk;
+            x = (x < 0) ? 0 : ((x > width - 1) ? width - 1 : x);
+            sum += inrow[x];
+          }
+          row[xx] = sum * norm;
+        }
+      }
+
+      //vertical pass, row at a time so the inner loop runs over contiguous memory
+      for (int yy=0; yy<height; yy++)
+      {
+        RowView<float> outrow = out.row(yy);
+        for (int xx=0; xx<width; xx++)
+          outrow[xx] = 0.0f;
+        for (int kk=-radius_; kk<=radius_; kk++)
+        {
+          int y = yy + kk;
+          y = (y < 0) ? 0 : ((y > height - 1) ? height - 1 : y);
+          RowView<float> row = tmp.row(y);
+          for (int xx=0; xx<width; xx++)
+            outrow[xx] += row[xx];
+        }
+        for (int xx=0; xx<width; xx++)
+          outrow[xx] *= norm;
+      }
+    }
+    tile.swap(output);
+  };
+
+};
+
+/** ThresholdOp: sets pixels above a threshold to one value and all others to another.  Works in place. */
+class ThresholdOp : public TileOperator
+{
+
+private:
+
+  float threshold_;
+  float above_;
+  float below_;
+
+public:
+
+  /** Constructor.
+   * @param threshold The threshold
+   * @param above The value for pixels greater than the threshold
+   * @param below The value for all other pixels
+   */
+  ThresholdOp(float threshold, float above = 1.0f, float below = 0.0f)
+    : threshold_(threshold), above_(above), below_(below) {};
+
+  const char* name(void) const { return("ThresholdOp"); };
+
+  void process(DataBuffer<float>& tile, const RasterDims& outputdims)
+  {
+    (void)outputdims;
+    long long n = (long long)tile.width() * tile.height() * tile.nbands();
+    float* ptr = tile.data();
+    for (long long idx=0; idx<n; idx++)
+      ptr[idx] = (ptr[idx] > threshold_) ? above_ : below_;
+  };
+
+};
+
+/** StatisticsOp: accumulates the count, minimum, maximum and mean of each band over the kept part of
+ *  every tile.  NaN pixels are ignored.  The tile is passed on unchanged.
+ */
+class StatisticsOp : public TileOperator
+{
+
+private:
+
+  std::vector<long long> count_;
+  std::vector<double> sum_;
+  std::vector<double> min_;
+  std::vector<double> max_;
+
+public:
+
+  void begin(const DataRaster& source)
+  {
+    (void)source;
+    count_.clear();
+    sum_.clear();
+    min_.clear();
+    max_.clear();
+  };
+
+  const char* name(void) const { return("StatisticsOp"); };
+
+  void process(DataBuffer<float>& tile, const RasterDims& outputdims)
+  {
+    if (count_.empty())
+    {
+      count_.assign(tile.nbands(), 0);
+      sum_.assign(tile.nbands(), 0.0);
+      min_.assign(tile.nbands(), std::numeric_limits<double>::max());
+      max_.assign(tile.nbands(), -std::numeric_limits<double>::max());
+    }
+
+    int width = tile.width();
+    long long sz = (long long)width * tile.height();
+    int xoff = outputdims.startSample() - tile.dims().startSample();
+    int yoff = outputdims.startLine() - tile.dims().startLine();
+    for (int band=0; band<tile.nbands(); band++)
+    {
+      long long count = 0;
+      double sum = 0.0, minval = min_[band], maxval = max_[band];
+      for (int yy=0; yy<outputdims.height(); yy++)
+      {
+        const float* row = tile.data() + sz * band + (long long)(yy + yoff) * width + xoff;
+        for (int xx=0; xx<outputdims.width(); xx++)
+        {
+          float val = row[xx];
+          if (val != val)
+            continue;
+          count++;
+          sum += val;
+          minval = (val < minval) ? val : minval;
+          maxval = (val > maxval) ? val : maxval;
+        }
+      }
+      count_[band] += count;
+      sum_[band] += sum;
+      min_[band] = minval;
+      max_[band] = maxval;
+    }
+  };
+
+  /** Returns the number of valid pixels of a band, or 0 before a tile of the band has been processed */
+  long long count(int band = 0) const { return((band >= 0 && band < (int)count_.size()) ? count_[band] : 0); };
+
+  /** Returns the minimum of a band, or NaN if the band has no valid pixels */
+  double min(int band = 0) const { return(count(band) ? min_[band] : std::numeric_limits<double>::quiet_NaN()); };
+
+  /** Returns the maximum of a band, or NaN if the band has no valid pixels */
+  double max(int band = 0) const { return(count(band) ? max_[band] : std::numeric_limits<double>::quiet_NaN()); };
+
+  /** Returns the mean of a band, or NaN if the band has no valid pixels */
+  double mean(int band = 0) const { return(count(band) ? sum_[band] / count_[band] : std::numeric_limits<double>::quiet_NaN()); };
+
+};
+
+/** WriteOp: writes the kept part of every tile to an output raster.  The tile is passed on unchanged.
+ *  Given a Quantizer, the tile is stored as scaled integers of the quantizer's data type, e.g.
+ *  Quantizer::unitRange(GDT_Int16) for NDVI * 10000, and the scale, offset and nodata value are written
+ *  to every band of the output.
+ */
+class WriteOp : public TileOperator
+{
+
+private:
+
+  DataRaster& output_;
+  Quantizer quantizer_;
+
+  /** Quantizes one band of a tile and writes its kept part.  This is an internal method. */
+  template <typename OutT> void writequantized(DataBuffer<float>& input, const RasterDims& outputdims, int band)
+  {
+    DataBuffer<OutT> stored(input.dims(), 1, false);
+    quantizer_.quantize(input.band(band).flat().data(), stored.data(), stored.dims().npixels());
+    output_.setData(stored, outputdims, band+1, quantizer_.dataType(), 0);
+  };
+
+public:
+
+  /** Constructor.
+   * @param output The raster to write to.  It must match the source dimensions and have at least as
+   *   many bands as the tiles reaching this operator.
+   */
+  WriteOp(DataRaster& output) : output_(output) {};
+
+  /** Constructor for scaled integer output.
+   * @param output The raster to write to, as above.  Its data type must be the data type of the quantizer.
+   * @param quantizer The mapping from tile values to stored values, for GDT_Byte, GDT_Int16 or GDT_UInt16
+   */
+  WriteOp(DataRaster& output, const Quantizer& quantizer) throw(Exception) : output_(output), quantizer_(quantizer)
+  {
+    GDALDataType dt = quantizer_.dataType();
+    if (dt != GDT_Float32 && dt != GDT_Byte && dt != GDT_Int16 && dt != GDT_UInt16)
+      throw Exception("WriteOp: Error: output data type not implemented.");
+    if (output_.dataType() != dt)
+      throw Exception("WriteOp: Error: the output data type does not match the quantizer.");
+  };
+
+  const char* name(void) const { return("WriteOp"); };
+
+  void begin(const DataRaster& source)
+  {
+    (void)source;
+    if (quantizer_.dataType() != GDT_Float32)
+    {
+      for (int band=1; band<=output_.nbands(); band++)
+        quantizer_.describe(output_, band);
+    }
+  };
+
+  void process(DataBuffer<float>& tile, const RasterDims& outputdims)
+  {
+    for (int band=0; band<tile.nbands(); band++)
+    {
+      switch(quantizer_.dataType())
+      {
+        case (GDT_Byte):
+          writequantized<unsigned char>(tile, outputdims, band);
+          break;
+        case (GDT_Int16):
+          writequantized<short>(tile, outputdims, band);
+          break;
+        case (GDT_UInt16):
+          writequantized<unsigned short>(tile, outputdims, band);
+          break;
+        default:
+          output_.setData(tile, outputdims, band+1, GDT_Float32, band);
+      }
+    }
+  };
+
+  void end(void) { output_.flush(); };
+
+};
+
+/** Pipeline: a chain of tile operators evaluated lazily over a source raster.
+ *  Operators are added first and nothing is read until run() is called.  Each tile is then read once
+ *  and passed through every operator in memory, so intermediate results never go to disk.  The tile
+ *  overlap is the sum of the overlaps of the operators, which makes the kept part of every tile
+ *  identical to processing the whole image at once.
+ *
+ *  Example, NDVI statistics and a thresholded mask in one pass:
+ *  \code
+ *  Pipeline pipeline(inputraster);
+ *  StatisticsOp* stats = new StatisticsOp;
+ *  pipeline.add(new NormalizedDifferenceOp(3, 2)).add(stats).add(new ThresholdOp(0.3f)).add(new WriteOp(maskraster));
+ *  pipeline.run();
+ *  \endcode
+ */
+class Pipeline
+{
+
+private:
+
+  DataRaster& source_;
+  std::vector<TileOperator*> operators_;
+  MemoryProfile* memoryProfile_;
+
+  /** Not copyable, the pipeline owns its operators */
+  Pipeline(const Pipeline&);
+  Pipeline& operator=(const Pipeline&);
+
+public:
+
+  /** Constructor.
+   * @param source The raster to read.  All bands are read as single precision.
+   */
+  Pipeline(DataRaster& source) : source_(source), memoryProfile_(NULL) {};
+
+  /** Destructor.  Deletes the operators. */
+  virtual ~Pipeline(void)
+  {
+    for (size_t idx=0; idx<operators_.size(); idx++)
+      delete(operators_[idx]);
+  };
+
+  /** Appends an operator to the chain.  The pipeline takes ownership of it.
+   * @param op The operator
+   */
+  Pipeline& add(TileOperator* op) throw(Exception)
+  {
+    if (!op)
+      throw Exception("Pipeline::add Error: null operator");
+    operators_.push_back(op);
+    return(*this);
+  };
+
+  /** Records the memory high water marks of each run and of its tiles, see MemoryProfile.  Tiles are
+   *  accounted to the site Pipeline::tile and the buffers an operator allocates to the operator's name.
+   * @param profile The profile, or NULL.  It must outlive the runs.
+   */
+  void setMemoryProfile(MemoryProfile* profile) { memoryProfile_ = profile; };
+
+  /** Returns the tile overlap required by the chain of operators */
+  int overlap(void) const
+  {
+    int total = 0;
+    for (size_t idx=0; idx<operators_.size(); idx++)
+      total += operators_[idx]->overlap();
+    return(total);
+  };
+
+  /** Runs the chain over the source raster tile by tile.
+   * @param memsize The memsize in bytes of the desired chunk size.  Small chunks keep intermediates in cache.
+   */
+  void run(long long memsize = 256 * 1024) throw(Exception)
+  {
+    DataRasterIterator iter(source_, memsize, overlap());
+
+    for (size_t idx=0; idx<operators_.size(); idx++)
+      operators_[idx]->begin(source_);
+    if (memoryProfile_)
+      memoryProfile_->begin();
+
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      MemoryProfile::TileScope tilememory(memoryProfile_, tilenum);
+      RasterDims inputdims, outputdims;
+      iter.getTileDims(tilenum, inputdims, &outputdims);
+
+      //backpressure: wait for other pipelines to release memory while the process is over its budget
+      MemoryBudget::instance().waitForRoom((unsigned long long)inputdims.width() * inputdims.height() * source_.nbands() * sizeof(float));
+      DataBuffer<float> tile;
+      {
+        MemorySite site("Pipeline::tile");
+        DataBuffer<float> buffer(inputdims, source_.nbands(), false);
+        tile.swap(buffer);
+      }
+      {
+        PerfScope scope("DataRaster::getData", PerfTypeName<float>::name(), NULL, (unsigned long long)inputdims.npixels() * source_.nbands() * sizeof(float));
+        for (int band=0; band<source_.nbands(); band++)
+          source_.getData(tile, band+1, GDT_Float32, band);
+      }
+
+      //operators are reported by name, with the bytes of the tile they are given
+      for (size_t idx=0; idx<operators_.size(); idx++)
+      {
+        PerfScope scope(operators_[idx]->name(), NULL, NULL, (unsigned long long)tile.dims().npixels() * tile.nbands() * sizeof(float));
+        MemorySite site(operators_[idx]->name());
+        operators_[idx]->process(tile, outputdims);
+      }
+
+      //the tile and what the operators made of it are still live
+      if (memoryProfile_)
+        memoryProfile_->sample();
+    }
+
+    for (size_t idx=0; idx<operators_.size(); idx++)
+      operators_[idx]->end();
+    if (memoryProfile_)
+      memoryProfile_->end();
+  };
+
+};
+#endif
@@ -0,0 +1,323 @@
+#ifndef _QUANTILESKETCHH_
+#define _QUANTILESKETCHH_
+//================================================================
+//
+// File: QuantileSketch.h
+// Created: 10/19/2026
+// Purpose: One pass approximate quantiles of raster bands
+//
+//================================================================
+
+#include <math.h>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "DataRasterIterator.h"
+#include "RasterDims.h"
+
+/** QuantileSketch: a KLL sketch, a mergeable summary of a stream of values that answers quantile queries
+ *  within a rank error chosen at construction.  Values are kept in a stack of compactors; when a
+ *  compactor fills it is sorted and every other value, from a random start, is promoted to the next
+ *  compactor with twice the weight.  Memory grows with the logarithm of the number of values.
+ *  The minimum and maximum are tracked exactly.
+ */
+class QuantileSketch
+{
+
+private:
+
+  int k_;
+  long long count_;
+  float min_;
+  float max_;
+  unsigned long long random_;
+  size_t nretained_;
+  size_t maxRetained_;
+  std::vector<std::vector<float> > levels_;
+
+  /** Returns the capacity of a level.  Lower levels shrink geometrically by 2/3.  This is an internal method. */
+  int capacity(size_t level) const
+  {
+    double depth = (double)(levels_.size() - 1 - level);
+    int cap = (int)ceil(k_ * pow(2.0 / 3.0, depth));
+    return((cap < 8) ? 8 : cap);
+  };
+
+  /** Adds a level and updates the number of values the sketch may retain.  This is an internal method. */
+  void addlevel(void)
+  {
+    levels_.push_back(std::vector<float>());
+    maxRetained_ = 0;
+    for (size_t level=0; level<levels_.size(); level++)
+      maxRetained_ += (size_t)capacity(level);
+  };
+
+  /** Scrambles a seed into a nonzero xorshift state (the splitmix64 finalizer).  This is an internal method. */
+  static unsigned long long mixseed(unsigned long long seed)
+  {
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+    seed ^= seed >> 31;
+    return((seed != 0) ? seed : 0x9e3779b97f4a7c15ULL);
+  };
+
+  /** Returns a random bit.  This is an internal method. */
+  int coin(void)
+  {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    return((int)(random_ >> 63));
+  };
+
+  /** Compacts the lowest full level until the sketch fits its capacity.  This is an internal method. */
+  void compress(void)
+  {
+    while (nretained_ >= maxRetained_)
+    {
+      for (size_t level=0; level<levels_.size(); level++)
+      {
+        if ((int)levels_[level].size() < capacity(level))
+          continue;
+        if (level + 1 == levels_.size())
+          addlevel();
+        std::vector<float>& items = levels_[level];
+        std::vector<float>& next = levels_[level + 1];
+
+        //an odd value out stays behind so the weight is conserved
+        float leftover = 0.0f;
+        bool odd = (items.size() % 2 == 1);
+        if (odd)
+        {
+          leftover = items.back();
+          items.pop_back();
+        }
+        std::sort(items.begin(), items.end());
+        for (size_t idx=(size_t)coin(); idx<items.size(); idx+=2)
+          next.push_back(items[idx]);
+        nretained_ -= items.size() - items.size() / 2;
+        items.clear();
+        if (odd)
+          items.push_back(leftover);
+        break;
+      }
+    }
+  };
+
+public:
+
+  /** Constructor.
+   * @param epsilon The normalized rank error, e.g. 0.01 for quantiles within 1% of the true rank with
+   *   high probability.  Smaller errors use proportionally more memory.
+   * @param seed The seed of the coin flips that choose which half of a compacted level survives.  Sketches
+   *   that are built in parallel and merged should be seeded differently so their errors stay independent.
+   */
+  QuantileSketch(double epsilon = 0.01, unsigned long long seed = 0) throw(Exception)
+    : count_(0), min_(std::numeric_limits<float>::max()), max_(-std::numeric_limits<float>::max()),
+      random_(mixseed(seed)), nretained_(0), maxRetained_(0)
+  {
+    if (!(epsilon > 0.0 && epsilon < 1.0))
+      throw Exception("QuantileSketch: Error: the rank error must be between 0 and 1.");
+    k_ = (int)ceil(1.65 / epsilon);
+    k_ = (k_ < 8) ? 8 : k_;
+    addlevel();
+  };
+
+  /** Destructor */
+  virtual ~QuantileSketch(void) {};
+
+  /** Adds a value */
+  inline void add(float value)
+  {
+    count_++;
+    min_ = (value < min_) ? value : min_;
+    max_ = (value > max_) ? value : max_;
+    levels_[0].push_back(value);
+    if (++nretained_ >= maxRetained_)
+      compress();
+  };
+
+  /** Adds the values summarized by another sketch.  The sketches should have the same rank error. */
+  void merge(const QuantileSketch& other)
+  {
+    if (!other.count_)
+      return;
+    while (levels_.size() < other.levels_.size())
+      addlevel();
+    for (size_t level=0; level<other.levels_.size(); level++)
+      levels_[level].insert(levels_[level].end(), other.levels_[level].begin(), other.levels_[level].end());
+    nretained_ += other.nretained_;
+    count_ += other.count_;
+    min_ = (other.min_ < min_) ? other.min_ : min_;
+    max_ = (other.max_ > max_) ? other.max_ : max_;
+    compress();
+  };
+
+  /** Returns the approximate value at a quantile, or NaN if the sketch is empty
+   * @param q The quantile, between 0 and 1.  0 and 1 return the exact minimum and maximum.
+   */
+  float quantile(double q) const
+  {
+    std::vector<double> qs(1, q);
+    return(quantiles(qs)[0]);
+  };
+
+  /** Returns the approximate values at several quantiles, sorting the retained values once
+   * @param qs The quantiles, each between 0 and 1
+   */
+  std::vector<float> quantiles(const std::vector<double>& qs) const
+  {
+    std::vector<float> result(qs.size(), std::numeric_limits<float>::quiet_NaN());
+    if (!count_)
+      return(result);
+
+    std::vector<std::pair<float, long long> > weighted;
+    for (size_t level=0; level<levels_.size(); level++)
+    {
+      for (size_t idx=0; idx<levels_[level].size(); idx++)
+        weighted.push_back(std::make_pair(levels_[level][idx], 1LL << level));
+    }
+    std::sort(weighted.begin(), weighted.end());
+    long long total = 0;
+    for (size_t idx=0; idx<weighted.size(); idx++)
+    {
+      total += weighted[idx].second;
+      weighted[idx].second = total;  //cumulative weight
+    }
+
+    for (size_t idx=0; idx<qs.size(); idx++)
+    {
+      if (qs[idx] <= 0.0)
+        result[idx] = min_;
+      else if (qs[idx] >= 1.0)
+        result[idx] = max_;
+      else
+      {
+        long long rank = (long long)ceil(qs[idx] * (double)total);
+        size_t pos = 0;
+        while (pos + 1 < weighted.size() && weighted[pos].second < rank)
+          pos++;
+        result[idx] = weighted[pos].first;
+      }
+    }
+    return(result);
+  };
+
+  /** Returns the number of values added */
+  long long count(void) const { return(count_); };
+
+  /** Returns the smallest value added */
+  float min(void) const { return(min_); };
+
+  /** Returns the largest value added */
+  float max(void) const { return(max_); };
+
+  /** Returns the number of values retained */
+  size_t nretained(void) const { return(nretained_); };
+
+};
+
+/** RasterQuantiles: approximate quantiles of a raster band, e.g. the 2% and 98% points of a float NDVI
+ *  band for a display stretch, in one pass and bounded memory.  The band is read chunk by chunk with
+ *  a DataRasterIterator; each thread feeds its rows into its own QuantileSketch and the sketches are
+ *  merged at the end.  Nodata and NaN values are ignored.
+ */
+class RasterQuantiles
+{
+
+private:
+
+  DataRaster& raster_;
+  int band_;
+  double epsilon_;
+  QuantileSketch sketch_;
+
+public:
+
+  /** Constructor.
+   * @param raster The raster
+   * @param band The band.  This follows GDAL and is 1 based.
+   * @param epsilon The normalized rank error of the quantiles
+   */
+  RasterQuantiles(DataRaster& raster, int band = 1, double epsilon = 0.01) throw(Exception)
+    : raster_(raster), band_(band), epsilon_(epsilon), sketch_(epsilon) {};
+
+  /** Destructor */
+  virtual ~RasterQuantiles(void) {};
+
+  /** Reads the band and builds the sketch.
+   * @param memsize The memsize in bytes of the chunks read from the raster
+   * @param nthreads The number of threads, or 0 for the OpenMP default
+   */
+  void run(long long memsize = 1024 * 1024, int nthreads = 0) throw(Exception)
+  {
+    bool hasNoData = false;
+    float noData = (float)raster_.noDataValue(band_, &hasNoData);
+
+    int maxthreads = 1;
+#ifdef _OPENMP
+    maxthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#endif
+    (void)nthreads;
+    //each thread flips its own coins, identical seeds would correlate the compaction errors
+    std::vector<QuantileSketch> sketches;
+    for (int thread=0; thread<maxthreads; thread++)
+      sketches.push_back(QuantileSketch(epsilon_, (unsigned long long)thread + 1));
+
+    DataRasterIterator iter(raster_, memsize, 0);
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims chunkdims;
+      iter.getTileDims(tilenum, chunkdims);
+      DataBuffer<float> data(chunkdims, 1, false);
+      raster_.getData(data, band_, GDT_Float32, 0);
+      DataView<float> view = data.band(0);
+      int height = chunkdims.height();
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(maxthreads)
+#endif
+      {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#pragma omp for schedule(static)
+#endif
+        for (int line=0; line<height; line++)
+        {
+          QuantileSketch& sketch = sketches[thread];
+          RowView<float> row = view.row(line);
+          for (long long sample=0; sample<row.size(); sample++)
+          {
+            float value = row[sample];
+            if (value != value || (hasNoData && value == noData))
+              continue;
+            sketch.add(value);
+          }
+        }
+      }
+    }
+
+    sketch_ = QuantileSketch(epsilon_);
+    for (int thread=0; thread<maxthreads; thread++)
+      sketch_.merge(sketches[thread]);
+  };
+
+  /** Returns the approximate value at a quantile of the band, or NaN if it has no valid values
+   * @param q The quantile, between 0 and 1
+   */
+  float quantile(double q) const { return(sketch_.quantile(q)); };
+
+  /** Returns the sketch built by the last run, e.g. to merge with the sketches of other rasters */
+  const QuantileSketch& sketch(void) const { return(sketch_); };
+
+};
+#endif
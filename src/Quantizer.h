@@ -0,0 +1,172 @@
+#ifndef _QUANTIZERH_
+#define _QUANTIZERH_
+//================================================================
+//
+// File: Quantizer.h
+// Created: 10/19/2026
+// Purpose: Scaled integer storage of floating point results
+//
+//================================================================
+
+#include <math.h>
+#include <string.h>
+#include <limits>
+#include <gdal_priv.h>
+#include "Exception.h"
+#include "DataRaster.h"
+
+/** Quantizer: maps floating point values onto a scaled integer output type.
+ *  Stored values follow the GDAL convention, value = stored * scale + offset.
+ *  Non finite values are stored as the nodata value.
+ */
+class Quantizer
+{
+
+private:
+
+  GDALDataType dataType_;
+  double scale_;
+  double offset_;
+  double noData_;
+  float invScale_;
+  float bias_;
+  float lo_;
+  float hi_;
+  int narrowNoData_;
+
+  /** Returns the representable range of a GDAL integer data type */
+  static void typeRange(GDALDataType dt, double& lo, double& hi) throw(Exception)
+  {
+    switch(dt)
+    {
+      case (GDT_Byte):
+        lo = 0.0; hi = 255.0; break;
+      case (GDT_UInt16):
+        lo = 0.0; hi = 65535.0; break;
+      case (GDT_Int16):
+        lo = -32768.0; hi = 32767.0; break;
+      case (GDT_UInt32):
+        lo = 0.0; hi = 4294967295.0; break;
+      case (GDT_Int32):
+        lo = -2147483648.0; hi = 2147483647.0; break;
+      case (GDT_Float32):
+      case (GDT_Float64):
+        lo = -std::numeric_limits<float>::max(); hi = std::numeric_limits<float>::max(); break;
+      default:
+        throw Exception("Quantizer::typeRange Error: data type not implemented");
+    }
+  };
+
+public:
+
+  /** Constructor.
+   * @param dataType The output data type
+   * @param scale The value of one stored count
+   * @param offset The value of a stored zero
+   * @param noData The stored value for invalid pixels.  It is excluded from the range valid pixels clamp to.
+   */
+  Quantizer(GDALDataType dataType = GDT_Float32, double scale = 1.0, double offset = 0.0,
+    double noData = 0.0) throw(Exception)
+    : dataType_(dataType), scale_(scale), offset_(offset), noData_(noData)
+  {
+    if (scale_ == 0.0)
+      throw Exception("Quantizer: Error: scale must be nonzero.");
+    double lo, hi;
+    typeRange(dataType_, lo, hi);
+    if (noData_ == lo)
+      lo += 1.0;
+    else if (noData_ == hi)
+      hi -= 1.0;
+    lo_ = (float)lo;
+    hi_ = (float)hi;
+    invScale_ = (float)(1.0 / scale_);
+    bias_ = (float)(-offset_ / scale_);
+    narrowNoData_ = (noData_ >= -32768.0 && noData_ <= 65535.0) ? (int)noData_ : 0;
+  };
+
+  /** Returns the quantizer used for NDVI style [-1,1] products stored in the given data type.
+   *  Int16 stores value * 10000, UInt16 stores (value + 1) * 10000 and Byte stores (value + 1) * 100.
+   *  Float32 is stored unscaled with NaN as the nodata value.
+   * @param dataType The output data type
+   */
+  static Quantizer unitRange(GDALDataType dataType) throw(Exception)
+  {
+    switch(dataType)
+    {
+      case (GDT_Byte):
+        return(Quantizer(GDT_Byte, 0.01, -1.0, 255.0));
+      case (GDT_UInt16):
+        return(Quantizer(GDT_UInt16, 0.0001, -1.0, 65535.0));
+      case (GDT_Int16):
+        return(Quantizer(GDT_Int16, 0.0001, 0.0, -32768.0));
+      case (GDT_Float32):
+        return(Quantizer(dataType, 1.0, 0.0, std::numeric_limits<double>::quiet_NaN()));
+      default:
+        throw Exception("Quantizer::unitRange Error: data type not implemented");
+    }
+  };
+
+  /** Quantizes a single value.  Inlined into fused kernels.  For output types of up to 16 bits every
+   *  step is branch free, so the loops that call it vectorize.
+   */
+  template <typename OutT> inline OutT quantize(float val) const
+  {
+    if (!std::numeric_limits<OutT>::is_integer)
+      return(static_cast<OutT>(val));
+    //clamping before rounding gives the same result for integer bounds and keeps the conversion in range
+    float x = val * invScale_ + bias_ + 0.5f;
+    x = (x > lo_) ? x : lo_;
+    x = (x < hi_) ? x : hi_;
+    if (std::numeric_limits<OutT>::digits > 16)
+      return((val == val) ? static_cast<OutT>(floorf(x)) : static_cast<OutT>(noData_));
+
+    //round down through an int conversion and blend NaN to nodata with integer arithmetic; a
+    //floating point NaN test is not if-converted by the compiler
+    int t = static_cast<int>(x);
+    t -= (x < static_cast<float>(t)) ? 1 : 0;
+    unsigned int bits;
+    memcpy(&bits, &val, sizeof(bits));
+    int nan = ((bits & 0x7fffffffu) > 0x7f800000u) ? 1 : 0;
+    t += nan * (narrowNoData_ - t);
+    return(static_cast<OutT>(t));
+  };
+
+  /** Quantizes an array of values.
+   * @param input The floating point values
+   * @param output The quantized values
+   * @param npixels The number of values
+   */
+  template <typename OutT> void quantize(const float* input, OutT* output, long long npixels) const
+  {
+    for (long long idx=0; idx<npixels; idx++)
+      output[idx] = quantize<OutT>(input[idx]);
+  };
+
+  /** Converts a stored value back to its floating point value */
+  double dequantize(double stored) const { return(stored * scale_ + offset_); };
+
+  /** Writes the scale, offset and nodata value to a band of a raster.
+   * @param raster The raster, open for update
+   * @param band The band to describe.  This follows GDAL and is 1 based.
+   */
+  void describe(DataRaster& raster, int band = 1) const throw(Exception)
+  {
+    raster.setNoDataValue(noData_, band);
+    if (scale_ != 1.0 || offset_ != 0.0)
+      raster.setScaleOffset(scale_, offset_, band);
+  };
+
+  /** Returns the output data type */
+  GDALDataType dataType(void) const { return(dataType_); };
+
+  /** Returns the scale */
+  double scale(void) const { return(scale_); };
+
+  /** Returns the offset */
+  double offset(void) const { return(offset_); };
+
+  /** Returns the nodata value */
+  double noData(void) const { return(noData_); };
+
+};
+#endif
@@ -79,6 +79,9 @@ public:
     
     /** Return height */
     int height(void) const { return(endLine_ - startLine_ + 1); };
+
+    /** Return the number of pixels.  This is 64 bit, since width * height overflows int for large rasters. */
+    long long npixels(void) const { return((long long)width() * (long long)height()); };
   
     /** Equality operator */
     inline bool operator==(const RasterDims& rhs) const
@@ -0,0 +1,557 @@
+#ifndef _RASTERWARPERH_
+#define _RASTERWARPERH_
+//================================================================
+//
+// File: RasterWarper.h
+// Created: 10/19/2026
+// Purpose: A class that reprojects/resamples one raster onto the
+//          grid of another in chunks.
+//
+//================================================================
+
+#include <math.h>
+#include <vector>
+#include <limits>
+#include <gdal_alg.h>
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "DataRasterIterator.h"
+#include "RasterDims.h"
+
+enum ResampleMethod
+{
+  ResampleNearest = 0,     //nearest neighbour
+  ResampleBilinear = 1,    //bilinear interpolation over a 2x2 window
+  ResampleCubic = 2        //cubic convolution over a 4x4 window
+};
+
+/** RasterWarper: a class that warps a source raster onto the grid of a destination raster.
+ *  The destination is processed tile by tile.  For each tile the exact source coordinates are
+ *  computed on a sparse grid with one batched transform call, the per pixel coordinates are
+ *  interpolated from that grid, and only the source window covering the tile is read.
+ *  The resampling kernels work on blocks of pixels: a first pass computes the tap indices and
+ *  weights, clamping them to the source window so edge pixels need no special case, and the
+ *  interpolation pass that follows has no per pixel branches.  Pixels that fall outside the
+ *  source are masked out with a blend rather than skipped.  A destination pixel is written when the
+ *  centre it maps to lies inside the source, so the footprint is the same for every method.
+ */
+class RasterWarper
+{
+
+private:
+
+  DataRaster& source_;
+  DataRaster& destination_;
+  ResampleMethod method_;
+  int gridStep_;
+  double noData_;
+  void* transformer_;
+  double affine_[6];
+
+  static const int BlockSize = 128;
+
+  /** Returns the number of source pixels the resampling kernel reaches past the sample point */
+  int kernelRadius(void) const
+  {
+    switch(method_)
+    {
+      case (ResampleBilinear):
+        return(1);
+      case (ResampleCubic):
+        return(2);
+      default:
+        return(1);
+    }
+  };
+
+  /** Transforms a batch of destination pixel coordinates to source pixel coordinates in place.
+   * @param npoints The number of points
+   * @param x The column coordinates
+   * @param y The row coordinates
+   * @param valid Set to nonzero for each point that could be transformed
+   */
+  void transform(int npoints, double* x, double* y, int* valid) throw(Exception)
+  {
+    if (transformer_)
+    {
+      std::vector<double> z(npoints, 0.0);
+      GDALGenImgProjTransform(transformer_, TRUE, npoints, x, y, &z[0], valid);
+      return;
+    }
+
+    //both rasters share a coordinate system, the composed geotransforms are exact
+    const double* a = affine_;
+    for (int idx=0; idx<npoints; idx++)
+    {
+      double dx = x[idx];
+      double dy = y[idx];
+      x[idx] = a[0] + dx * a[1] + dy * a[2];
+      y[idx] = a[3] + dx * a[4] + dy * a[5];
+      valid[idx] = 1;
+    }
+  };
+
+  /** Converts a double to the pixel type with rounding and saturation */
+  template <typename T> static inline T saturate(double val)
+  {
+    if (std::numeric_limits<T>::is_integer)
+    {
+      val = floor(val + 0.5);
+      val = (val < (double)std::numeric_limits<T>::min()) ? (double)std::numeric_limits<T>::min() : val;
+      val = (val > (double)std::numeric_limits<T>::max()) ? (double)std::numeric_limits<T>::max() : val;
+    }
+    return(static_cast<T>(val));
+  };
+
+  /** Clamps an index to [0, hi] */
+  static inline int clampIndex(int val, int hi)
+  {
+    val = (val < 0) ? 0 : val;
+    return((val > hi) ? hi : val);
+  };
+
+  /** Clamps a source coordinate to [lo, hi] and splits it into its floor and fractional part.
+   *  Clamping first keeps the integer conversion defined for coordinates far outside the window.
+   */
+  static inline int splitCoordinate(float val, float lo, float hi, float& frac)
+  {
+    val = (val < lo) ? lo : val;
+    val = (val > hi) ? hi : val;
+    int ival = (int)val;
+    ival -= (val < (float)ival) ? 1 : 0;
+    frac = val - (float)ival;
+    return(ival);
+  };
+
+  /** Cubic convolution weights (Keys, a = -0.5) for a sample at fractional offset t */
+  static inline void cubicWeights(double t, double* w)
+  {
+    double t2 = t * t;
+    double t3 = t2 * t;
+    w[0] = -0.5 * t3 + t2 - 0.5 * t;
+    w[1] = 1.5 * t3 - 2.5 * t2 + 1.0;
+    w[2] = -1.5 * t3 + 2.0 * t2 + 0.5 * t;
+    w[3] = 0.5 * t3 - 0.5 * t2;
+  };
+
+  /** Warps a single destination tile.  This is an internal method. */
+  template <typename T> void warpTile(const RasterDims& tiledims)
+  {
+    int width = tiledims.width();
+    int height = tiledims.height();
+    std::vector<float> srcx, srcy;
+    std::vector<unsigned char> valid;
+    computeSourceCoordinates(tiledims, srcx, srcy, valid);
+
+    DataBuffer<T> outputdata(tiledims, destination_.nbands(), false);
+    T fill = saturate<T>(noData_);
+    long long sz = (long long)width * height;
+    for (long long idx=0; idx<sz * outputdata.nbands(); idx++)
+      outputdata.data()[idx] = fill;
+
+    RasterDims window;
+    if (sourceWindow(srcx, srcy, valid, window))
+    {
+      DataBuffer<T> inputdata(window, source_.nbands(), false);
+      for (int band=0; band<source_.nbands(); band++)
+        source_.getData(inputdata, band+1, source_.dataType(), band);
+
+      //shift the coordinates into the window and resample every band
+      float x0 = (float)window.startSample();
+      float y0 = (float)window.startLine();
+      for (long long idx=0; idx<sz; idx++)
+      {
+        srcx[idx] -= x0;
+        srcy[idx] -= y0;
+      }
+
+      int nbands = (destination_.nbands() < source_.nbands()) ? destination_.nbands() : source_.nbands();
+      for (int band=0; band<nbands; band++)
+      {
+        long long inoffset = (long long)window.width() * window.height() * band;
+        switch(method_)
+        {
+          case (ResampleBilinear):
+            resampleBilinear(inputdata.data() + inoffset, window.width(), window.height(),
+              &srcx[0], &srcy[0], &valid[0], sz, outputdata.data() + sz * band);
+            break;
+          case (ResampleCubic):
+            resampleCubic(inputdata.data() + inoffset, window.width(), window.height(),
+              &srcx[0], &srcy[0], &valid[0], sz, outputdata.data() + sz * band);
+            break;
+          default:
+            resampleNearest(inputdata.data() + inoffset, window.width(), window.height(),
+              &srcx[0], &srcy[0], &valid[0], sz, outputdata.data() + sz * band);
+            break;
+        }
+      }
+    }
+
+    for (int band=0; band<destination_.nbands(); band++)
+      destination_.setData(outputdata, tiledims, band+1, destination_.dataType(), band);
+  };
+
+  /** Computes the bounding source window of all valid coordinates, padded by the kernel radius
+   *  and clipped to the source raster.  Returns false if the tile does not touch the source.
+   */
+  bool sourceWindow(const std::vector<float>& srcx, const std::vector<float>& srcy,
+    const std::vector<unsigned char>& valid, RasterDims& window) const
+  {
+    float minx = std::numeric_limits<float>::max(), maxx = -std::numeric_limits<float>::max();
+    float miny = std::numeric_limits<float>::max(), maxy = -std::numeric_limits<float>::max();
+    bool any = false;
+    for (size_t idx=0; idx<srcx.size(); idx++)
+    {
+      if (!valid[idx])
+        continue;
+      any = true;
+      minx = (srcx[idx] < minx) ? srcx[idx] : minx;
+      maxx = (srcx[idx] > maxx) ? srcx[idx] : maxx;
+      miny = (srcy[idx] < miny) ? srcy[idx] : miny;
+      maxy = (srcy[idx] > maxy) ? srcy[idx] : maxy;
+    }
+    if (!any)
+      return(false);
+
+    int radius = kernelRadius();
+    int x0 = (int)floor(minx) - radius, x1 = (int)floor(maxx) + radius;
+    int y0 = (int)floor(miny) - radius, y1 = (int)floor(maxy) + radius;
+    if (x1 < 0 || y1 < 0 || x0 > source_.nsamples() - 1 || y0 > source_.nlines() - 1)
+      return(false);
+
+    window.setStartSample((x0 < 0) ? 0 : x0);
+    window.setEndSample((x1 > source_.nsamples() - 1) ? source_.nsamples() - 1 : x1);
+    window.setStartLine((y0 < 0) ? 0 : y0);
+    window.setEndLine((y1 > source_.nlines() - 1) ? source_.nlines() - 1 : y1);
+    return(true);
+  };
+
+  /** Nearest neighbour resampling kernel.  Coordinates are in window pixel units. */
+  template <typename T> static void resampleNearest(const T* in, int inwidth, int inheight,
+    const float* srcx, const float* srcy, const unsigned char* valid, long long sz, T* out)
+  {
+    float w = (float)inwidth, h = (float)inheight;
+    for (long long idx=0; idx<sz; idx++)
+    {
+      float tx, ty;
+      int ix = splitCoordinate(srcx[idx], -1.0f, w, tx);
+      int iy = splitCoordinate(srcy[idx], -1.0f, h, ty);
+      int inside = (valid[idx] != 0) & (srcx[idx] >= 0.0f) & (srcy[idx] >= 0.0f) & (srcx[idx] < w) & (srcy[idx] < h);
+      T val = in[(long long)clampIndex(iy, inheight - 1) * inwidth + clampIndex(ix, inwidth - 1)];
+      out[idx] = inside ? val : out[idx];
+    }
+  };
+
+  /** Bilinear resampling kernel.  Coordinates are in window pixel units, edges are clamped. */
+  template <typename T> static void resampleBilinear(const T* in, int inwidth, int inheight,
+    const float* srcx, const float* srcy, const unsigned char* valid, long long sz, T* out)
+  {
+    int x0[BlockSize], x1[BlockSize], y0[BlockSize], y1[BlockSize], inside[BlockSize];
+    float tx[BlockSize], ty[BlockSize];
+    double vals[BlockSize];
+    float w = (float)inwidth, h = (float)inheight;
+    for (long long start=0; start<sz; start+=BlockSize)
+    {
+      int n = (sz - start < BlockSize) ? (int)(sz - start) : BlockSize;
+      const float* bx = srcx + start;
+      const float* by = srcy + start;
+      const unsigned char* bvalid = valid + start;
+
+      //tap indices and weights, clamped to the window
+      for (int kk=0; kk<n; kk++)
+      {
+        float fx = bx[kk] - 0.5f;
+        float fy = by[kk] - 0.5f;
+        inside[kk] = (bvalid[kk] != 0) & (bx[kk] >= 0.0f) & (by[kk] >= 0.0f) & (bx[kk] < w) & (by[kk] < h);
+        int ix = splitCoordinate(fx, -1.0f, w, tx[kk]);
+        int iy = splitCoordinate(fy, -1.0f, h, ty[kk]);
+        x0[kk] = clampIndex(ix, inwidth - 1);
+        x1[kk] = clampIndex(ix + 1, inwidth - 1);
+        y0[kk] = clampIndex(iy, inheight - 1);
+        y1[kk] = clampIndex(iy + 1, inheight - 1);
+      }
+
+      //interpolation
+      for (int kk=0; kk<n; kk++)
+      {
+        const T* r0 = in + (long long)y0[kk] * inwidth;
+        const T* r1 = in + (long long)y1[kk] * inwidth;
+        double top = r0[x0[kk]] + tx[kk] * ((double)r0[x1[kk]] - r0[x0[kk]]);
+        double bot = r1[x0[kk]] + tx[kk] * ((double)r1[x1[kk]] - r1[x0[kk]]);
+        vals[kk] = top + ty[kk] * (bot - top);
+      }
+
+      T* bout = out + start;
+      for (int kk=0; kk<n; kk++)
+      {
+        T val = saturate<T>(vals[kk]);
+        bout[kk] = inside[kk] ? val : bout[kk];
+      }
+    }
+  };
+
+  /** Cubic convolution resampling kernel.  Coordinates are in window pixel units, edges are clamped. */
+  template <typename T> static void resampleCubic(const T* in, int inwidth, int inheight,
+    const float* srcx, const float* srcy, const unsigned char* valid, long long sz, T* out)
+  {
+    int xx[4][BlockSize], yy[4][BlockSize], inside[BlockSize];
+    double wx[4][BlockSize], wy[4][BlockSize];
+    double vals[BlockSize];
+    float w = (float)inwidth, h = (float)inheight;
+    for (long long start=0; start<sz; start+=BlockSize)
+    {
+      int n = (sz - start < BlockSize) ? (int)(sz - start) : BlockSize;
+      const float* bx = srcx + start;
+      const float* by = srcy + start;
+      const unsigned char* bvalid = valid + start;
+
+      //tap indices and weights, clamped to the window
+      for (int kk=0; kk<n; kk++)
+      {
+        float fx = bx[kk] - 0.5f;
+        float fy = by[kk] - 0.5f;
+        inside[kk] = (bvalid[kk] != 0) & (bx[kk] >= 0.0f) & (by[kk] >= 0.0f) & (bx[kk] < w) & (by[kk] < h);
+        float tx, ty;
+        int ix = splitCoordinate(fx, -1.0f, w, tx);
+        int iy = splitCoordinate(fy, -1.0f, h, ty);
+        double cx[4], cy[4];
+        cubicWeights(tx, cx);
+        cubicWeights(ty, cy);
+        for (int tap=0; tap<4; tap++)
+        {
+          xx[tap][kk] = clampIndex(ix - 1 + tap, inwidth - 1);
+          yy[tap][kk] = clampIndex(iy - 1 + tap, inheight - 1);
+          wx[tap][kk] = cx[tap];
+          wy[tap][kk] = cy[tap];
+        }
+      }
+
+      //interpolation
+      for (int kk=0; kk<n; kk++)
+      {
+        double sum = 0.0;
+        for (int jj=0; jj<4; jj++)
+        {
+          const T* row = in + (long long)yy[jj][kk] * inwidth;
+          double rowsum = wx[0][kk] * row[xx[0][kk]] + wx[1][kk] * row[xx[1][kk]]
+            + wx[2][kk] * row[xx[2][kk]] + wx[3][kk] * row[xx[3][kk]];
+          sum += wy[jj][kk] * rowsum;
+        }
+        vals[kk] = sum;
+      }
+
+      T* bout = out + start;
+      for (int kk=0; kk<n; kk++)
+      {
+        T val = saturate<T>(vals[kk]);
+        bout[kk] = inside[kk] ? val : bout[kk];
+      }
+    }
+  };
+
+public:
+
+  /** Constructor.
+   * @param source The raster to be warped
+   * @param destination The raster to warp into.  Its size, geotransform and projection define the output grid.
+   * @param method The resampling method
+   * @param gridStep The spacing in pixels of the sparse grid on which the exact transform is evaluated
+   */
+  RasterWarper(DataRaster& source, DataRaster& destination, ResampleMethod method = ResampleNearest,
+    int gridStep = 16) throw(Exception)
+    : source_(source), destination_(destination), method_(method), gridStep_(gridStep),
+      noData_(0.0), transformer_(NULL)
+  {
+    if (source_.nbands() < 1 || destination_.nbands() < 1)
+      throw Exception("RasterWarper: Error: source and destination rasters must be open.");
+    if (gridStep_ < 1)
+      throw Exception("RasterWarper: Error: gridStep must be at least 1.");
+
+    bool hasNoData = false;
+    double val = destination_.noDataValue(1, &hasNoData);
+    if (hasNoData)
+      noData_ = val;
+
+    double srcgt[6], dstgt[6];
+    source_.getGeoTransform(srcgt);
+    destination_.getGeoTransform(dstgt);
+    std::string srcproj = source_.projection();
+    std::string dstproj = destination_.projection();
+    if (srcproj.empty() || dstproj.empty() || srcproj == dstproj)
+    {
+      //compose destination image->map with source map->image
+      double inv[6];
+      if (!GDALInvGeoTransform(srcgt, inv))
+        throw Exception("RasterWarper: Error: source geotransform is not invertible.");
+      const double* d = dstgt;
+      affine_[0] = inv[0] + d[0] * inv[1] + d[3] * inv[2];
+      affine_[1] = d[1] * inv[1] + d[4] * inv[2];
+      affine_[2] = d[2] * inv[1] + d[5] * inv[2];
+      affine_[3] = inv[3] + d[0] * inv[4] + d[3] * inv[5];
+      affine_[4] = d[1] * inv[4] + d[4] * inv[5];
+      affine_[5] = d[2] * inv[4] + d[5] * inv[5];
+    }
+    else
+    {
+      transformer_ = GDALCreateGenImgProjTransformer3(srcproj.c_str(), srcgt, dstproj.c_str(), dstgt);
+      if (!transformer_)
+        throw Exception("RasterWarper: Error: unable to create a transformer between the rasters.");
+    }
+  };
+
+  /** Destructor */
+  virtual ~RasterWarper(void)
+  {
+    if (transformer_)
+      GDALDestroyGenImgProjTransformer(transformer_);
+  };
+
+  /** Sets the value written to destination pixels that fall outside the source.  The default is
+   *  the destination nodata value, or 0 if none is set.
+   */
+  void setNoDataValue(double val) { noData_ = val; };
+
+  /** Computes the source pixel coordinates of the centers of every pixel of a destination tile.
+   *  The exact transform is evaluated on a sparse grid and interpolated bilinearly between grid nodes.
+   * @param tiledims The destination tile
+   * @param srcx Output column coordinates, one per tile pixel
+   * @param srcy Output row coordinates, one per tile pixel
+   * @param valid Output validity flags, one per tile pixel
+   */
+  void computeSourceCoordinates(const RasterDims& tiledims, std::vector<float>& srcx,
+    std::vector<float>& srcy, std::vector<unsigned char>& valid) throw(Exception)
+  {
+    int width = tiledims.width();
+    int height = tiledims.height();
+
+    //grid node positions, always including the last row and column of the tile
+    std::vector<int> gx, gy;
+    for (int xx=0; xx<width-1; xx+=gridStep_)
+      gx.push_back(xx);
+    gx.push_back(width - 1);
+    for (int yy=0; yy<height-1; yy+=gridStep_)
+      gy.push_back(yy);
+    gy.push_back(height - 1);
+
+    //one batched transform for all of the grid nodes
+    int ngx = (int)gx.size(), ngy = (int)gy.size();
+    int nnodes = ngx * ngy;
+    std::vector<double> nx(nnodes), ny(nnodes);
+    std::vector<int> nvalid(nnodes);
+    for (int jj=0; jj<ngy; jj++)
+    {
+      for (int ii=0; ii<ngx; ii++)
+      {
+        nx[jj * ngx + ii] = tiledims.startSample() + gx[ii] + 0.5;
+        ny[jj * ngx + ii] = tiledims.startLine() + gy[jj] + 0.5;
+      }
+    }
+    transform(nnodes, &nx[0], &ny[0], &nvalid[0]);
+
+    long long sz = (long long)width * height;
+    srcx.resize(sz);
+    srcy.resize(sz);
+    valid.resize(sz);
+
+    //interpolate between the grid nodes
+    for (int jj=0; jj<ngy; jj++)
+    {
+      int j1 = (jj + 1 < ngy) ? jj + 1 : jj;
+      int ystart = gy[jj];
+      int yend = (jj + 1 < ngy) ? gy[jj+1] : gy[jj] + 1;
+      double yspan = (j1 != jj) ? (double)(gy[j1] - gy[jj]) : 1.0;
+      for (int yy=ystart; yy<yend; yy++)
+      {
+        double ty = (yy - ystart) / yspan;
+        for (int ii=0; ii<ngx; ii++)
+        {
+          int i1 = (ii + 1 < ngx) ? ii + 1 : ii;
+          int xstart = gx[ii];
+          int xend = (ii + 1 < ngx) ? gx[ii+1] : gx[ii] + 1;
+          double xspan = (i1 != ii) ? (double)(gx[i1] - gx[ii]) : 1.0;
+          int n00 = jj * ngx + ii, n01 = jj * ngx + i1, n10 = j1 * ngx + ii, n11 = j1 * ngx + i1;
+          unsigned char cellvalid = (nvalid[n00] && nvalid[n01] && nvalid[n10] && nvalid[n11]) ? 1 : 0;
+          double lx = nx[n00] + ty * (nx[n10] - nx[n00]);
+          double rx = nx[n01] + ty * (nx[n11] - nx[n01]);
+          double ly = ny[n00] + ty * (ny[n10] - ny[n00]);
+          double ry = ny[n01] + ty * (ny[n11] - ny[n01]);
+          long long rowoffset = (long long)yy * width;
+          for (int xx=xstart; xx<xend; xx++)
+          {
+            double tx = (xx - xstart) / xspan;
+            srcx[rowoffset + xx] = (float)(lx + tx * (rx - lx));
+            srcy[rowoffset + xx] = (float)(ly + tx * (ry - ly));
+            valid[rowoffset + xx] = cellvalid;
+          }
+        }
+      }
+    }
+  };
+
+  /** Warps the source into the destination.  The destination raster is iterated over in chunks.
+   * @param memsize The memsize in bytes of the desired destination chunk size
+   */
+  void run(long long memsize = static_cast<long long>(0.1 * 1024. * 1024.)) throw(Exception)
+  {
+    switch(source_.dataType())
+    {
+      case (GDT_Byte):
+      {
+        warp<unsigned char>(memsize);
+        break;
+      }
+      case (GDT_UInt16):
+      {
+        warp<unsigned short>(memsize);
+        break;
+      }
+      case (GDT_Int16):
+      {
+        warp<short>(memsize);
+        break;
+      }
+      case (GDT_UInt32):
+      {
+        warp<unsigned int>(memsize);
+        break;
+      }
+      case (GDT_Int32):
+      {
+        warp<int>(memsize);
+        break;
+      }
+      case (GDT_Float32):
+      {
+        warp<float>(memsize);
+        break;
+      }
+      case (GDT_Float64):
+      {
+        warp<double>(memsize);
+        break;
+      }
+      default:
+      {
+        throw Exception("RasterWarper::run Error: data type not implemented");
+        break;
+      }
+    }
+  };
+
+  /** Warps the source into the destination with the given pixel type.
+   * @param memsize The memsize in bytes of the desired destination chunk size
+   */
+  template <typename T> void warp(long long memsize)
+  {
+    DataRasterIterator iter(destination_, memsize, 0);
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims tiledims;
+      iter.getTileDims(tilenum, tiledims);
+      warpTile<T>(tiledims);
+    }
+  };
+
+};
+#endif
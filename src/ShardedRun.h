@@ -0,0 +1,247 @@
+#ifndef _SHARDEDRUNH_
+#define _SHARDEDRUNH_
+//================================================================
+//
+// File: ShardedRun.h
+// Created: 10/19/2026
+// Purpose: Runs the shards of a tiled job in separate local worker
+//          processes and merges their partial outputs.
+//
+//================================================================
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "RasterDims.h"
+#include "TileManifest.h"
+
+/** ShardedRun: runs the shards of a job in separate worker processes on the local machine.
+ *  Each worker is forked from the caller, handles one shard and writes its own partial output, so
+ *  the workers do not share GDAL's per process locks and caches.  Completed shards are recorded in a
+ *  manifest, so a run that is repeated after a failure only reruns the shards that did not finish.
+ *  merge() assembles the partial outputs into one raster.
+ *  The caller should not hold open GDAL datasets across run(), since the workers inherit them.
+ */
+class ShardedRun
+{
+
+public:
+
+  /** A shard worker.  It runs in the forked worker process and returns 0 on success.
+   * @param shard The zero based shard number
+   * @param nshards The number of shards
+   * @param context The context pointer given to run()
+   */
+  typedef int (*Worker)(int shard, int nshards, void* context);
+
+private:
+
+  TileManifest manifest_;
+  int nshards_;
+
+  /** Builds the manifest parameters for a sharded run.  This is an internal method. */
+  static std::string manifestparameters(const std::string& parameters, int nshards)
+  {
+    std::ostringstream ostr;
+    ostr << "sharded nshards=" << nshards << " " << parameters;
+    return(ostr.str());
+  };
+
+  /** Copies the data covered region of a shard's output into the merged output.  This is an internal method. */
+  template <typename T> static void copyregion(DataRaster& shard, DataRaster& output, const RasterDims& region, long long memsize)
+  {
+    long long linesize = (long long)region.width() * shard.nbands() * sizeof(T);
+    long long lines = memsize / linesize;
+    int nlines = (lines < 1) ? 1 : ((lines > region.height()) ? region.height() : (int)lines);
+
+    for (int line=region.startLine(); line<=region.endLine(); line+=nlines)
+    {
+      int endline = line + nlines - 1;
+      RasterDims chunk(region.startSample(), region.endSample(), line, (endline > region.endLine()) ? region.endLine() : endline);
+
+      //blocks the shard never wrote are left unwritten, so the merged output stays sparse
+      bool empty = true;
+      for (int band=1; band<=shard.nbands() && empty; band++)
+        empty = (shard.coverage(chunk, band) == DataCoverageEmpty);
+      if (empty)
+        continue;
+
+      DataBuffer<T> data(chunk, shard.nbands(), false);
+      for (int band=0; band<shard.nbands(); band++)
+        shard.getData(data, band+1, shard.dataType(), band);
+      for (int band=0; band<shard.nbands(); band++)
+        output.setData(data, chunk, band+1, output.dataType(), band);
+    }
+  };
+
+public:
+
+  /** Constructor.
+   * @param manifestfilename The filename of the shard manifest
+   * @param parameters A single line describing everything that affects the outputs, as for TileManifest
+   * @param nshards The number of shards
+   */
+  ShardedRun(const std::string& manifestfilename, const std::string& parameters, int nshards) throw(Exception)
+    : manifest_(manifestfilename, manifestparameters(parameters, nshards)), nshards_(nshards)
+  {
+    if (nshards_ < 1)
+      throw Exception("ShardedRun: Error: the number of shards must be positive.");
+  };
+
+  /** Destructor */
+  virtual ~ShardedRun(void) {};
+
+  /** Returns the filename of a shard's partial output
+   * @param filename The filename of the merged output
+   * @param shard The zero based shard number
+   */
+  static std::string shardFilename(const std::string& filename, int shard)
+  {
+    std::ostringstream ostr;
+    ostr << filename << ".shard" << shard;
+    return(ostr.str());
+  };
+
+  /** Runs every shard that is not yet complete, one worker process per shard, and waits for them.
+   *  Throws if any worker fails; the shards that succeeded are recorded and skipped by the next run.
+   * @param worker The function each worker runs
+   * @param context A pointer passed to the worker
+   * @return The number of shards run
+   */
+  int run(Worker worker, void* context) throw(Exception)
+  {
+    //flush stdio so buffered output is not written again by every worker
+    fflush(stdout);
+    fflush(stderr);
+
+    std::vector<pid_t> pids(nshards_, (pid_t)0);
+    int nstarted = 0;
+    for (int shard=0; shard<nshards_; shard++)
+    {
+      if (manifest_.contains(shard))
+        continue;
+      pid_t pid = fork();
+      if (pid < 0)
+        break;  //reap the workers already started, then report the failure
+      if (pid == 0)
+      {
+        int status = 1;
+        try
+        {
+          status = worker(shard, nshards_, context);
+        }
+        catch (std::exception& e)
+        {
+          fprintf(stderr, "ShardedRun: shard %d failed: %s\n", shard, e.what());
+        }
+        fflush(stderr);
+        _exit(status == 0 ? 0 : 1);  //skip the parent's exit handlers and static destructors
+      }
+      pids[shard] = pid;
+      nstarted++;
+    }
+
+    std::ostringstream failed;
+    for (int shard=0; shard<nshards_; shard++)
+    {
+      if (manifest_.contains(shard))
+        continue;
+      int status = 0;
+      pid_t result = -1;
+      if (pids[shard] > 0)
+      {
+        do
+          result = waitpid(pids[shard], &status, 0);
+        while (result < 0 && errno == EINTR);
+      }
+      if (result > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        manifest_.markComplete(shard, 1ULL);
+      else
+        failed << " " << shard;
+    }
+    if (!failed.str().empty())
+      throw Exception(std::string("ShardedRun::run Error: shards failed:") + failed.str());
+    return(nstarted);
+  };
+
+  /** Returns true once every shard has completed */
+  bool complete(void) const { return(manifest_.ncomplete() == nshards_); };
+
+  /** Assembles partial outputs into one raster.  Each partial output is a full size raster of which
+   *  only its region is taken.  Blocks with no stored data in the partial outputs are not copied, so
+   *  sparse inputs give a sparse output.  The georeferencing comes from the first partial output and
+   *  the nodata value, scale and offset of every band are carried over.
+   * @param shardfilenames The partial outputs
+   * @param regions The region each partial output owns
+   * @param outputfilename The merged output
+   * @param options The creation options of the merged output, e.g. COMPRESS=DEFLATE
+   * @param memsize The largest chunk in bytes to hold in memory while copying
+   */
+  static void merge(const std::vector<std::string>& shardfilenames, const std::vector<RasterDims>& regions,
+    const std::string& outputfilename, const std::vector<std::string>& options = std::vector<std::string>(1, "SPARSE_OK=TRUE"),
+    long long memsize = 1024 * 1024) throw(Exception)
+  {
+    if (shardfilenames.empty() || shardfilenames.size() != regions.size())
+      throw Exception("ShardedRun::merge Error: there must be one region per partial output.");
+
+    DataRaster first;
+    first.open(shardfilenames[0], GA_ReadOnly);
+    DataRaster output;
+    output.create(outputfilename, first.dims(), first.nbands(), first.dataType(), "GTiff", &first, options);
+    for (int band=1; band<=first.nbands(); band++)
+    {
+      bool hasNoData = false;
+      double noData = first.noDataValue(band, &hasNoData);
+      if (hasNoData)
+        output.setNoDataValue(noData, band);
+      double scale, offset;
+      first.getScaleOffset(scale, offset, band);
+      if (scale != 1.0 || offset != 0.0)
+        output.setScaleOffset(scale, offset, band);
+    }
+    first.close();
+
+    for (size_t idx=0; idx<shardfilenames.size(); idx++)
+    {
+      DataRaster shard;
+      shard.open(shardfilenames[idx], GA_ReadOnly);
+      if (!(shard.dims() == output.dims()) || shard.nbands() != output.nbands() || shard.dataType() != output.dataType())
+        throw Exception(std::string("ShardedRun::merge Error: partial output does not match: ") + shardfilenames[idx]);
+
+      switch(shard.dataType())
+      {
+        case (GDT_Byte):
+          copyregion<unsigned char>(shard, output, regions[idx], memsize); break;
+        case (GDT_UInt16):
+          copyregion<unsigned short>(shard, output, regions[idx], memsize); break;
+        case (GDT_Int16):
+          copyregion<short>(shard, output, regions[idx], memsize); break;
+        case (GDT_UInt32):
+          copyregion<unsigned int>(shard, output, regions[idx], memsize); break;
+        case (GDT_Int32):
+          copyregion<int>(shard, output, regions[idx], memsize); break;
+        case (GDT_Float32):
+          copyregion<float>(shard, output, regions[idx], memsize); break;
+        case (GDT_Float64):
+          copyregion<double>(shard, output, regions[idx], memsize); break;
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3110000
+        case (GDT_Float16):
+          copyregion<float16>(shard, output, regions[idx], memsize); break;
+#endif
+        default:
+          throw Exception("ShardedRun::merge Error: data type not implemented");
+      }
+    }
+    output.close();
+  };
+
+};
+#endif
@@ -0,0 +1,301 @@
+#ifndef _TEMPORALCOMPOSITEH_
+#define _TEMPORALCOMPOSITEH_
+//================================================================
+//
+// File: TemporalComposite.h
+// Created: 10/19/2026
+// Purpose: Per pixel compositing of a stack of co-registered dates
+//
+//================================================================
+
+#include <math.h>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "MultiRasterIterator.h"
+#include "RasterDims.h"
+
+/** Enumeration for the per pixel reducer of a composite */
+enum CompositeMethod
+{
+  CompositeMaxNdvi = 0,     //every band of the date with the greatest NDVI
+  CompositeMedian = 1,      //the median of each band over the valid dates
+  CompositeMean = 2,        //the mean of each band over the valid dates
+  CompositeCount = 3        //the number of valid dates, a single band
+};
+
+/** TemporalComposite: reduces a stack of co-registered dates, e.g. a season of multispectral scenes,
+ *  to one raster in a single pass.  The dates are read together tile by tile with a MultiRasterIterator,
+ *  so memory is one tile per date whatever the depth of the stack, and rows are reduced in parallel.
+ *  A date is valid at a pixel when none of its bands holds its nodata value or NaN.  The mean, count and
+ *  maximum NDVI reducers sweep each row date by date with unit stride loops the compiler vectorizes.
+ *  The NDVI of a date is computed from its red and NIR bands, or taken from band 1 for stacks of NDVI
+ *  rasters.  Pixels with no valid date are NaN in the output, and 0 for CompositeCount.
+ */
+class TemporalComposite
+{
+
+private:
+
+  std::vector<DataRaster*> stack_;
+  CompositeMethod method_;
+  int nbands_;
+  int redBand_;
+  int nirBand_;
+  std::vector<std::vector<float> > noData_;
+  std::vector<std::vector<unsigned char> > hasNoData_;
+
+  /** Marks the pixels of a row where a date is valid.  This is an internal method. */
+  void validrow(std::vector<DataBuffer<float>*>& tiles, int date, int line, unsigned char* valid) const
+  {
+    int width = tiles[date]->width();
+    for (int sample=0; sample<width; sample++)
+      valid[sample] = 1;
+    for (int band=0; band<nbands_; band++)
+    {
+      const float* row = tiles[date]->row(band, line).data();
+      float noData = noData_[date][band];
+      bool hasNoData = (hasNoData_[date][band] != 0);
+      for (int sample=0; sample<width; sample++)
+        valid[sample] &= (row[sample] == row[sample] && !(hasNoData && row[sample] == noData)) ? 1 : 0;
+    }
+  };
+
+  /** Reduces one row of a tile.  This is an internal method.
+   * @param tiles The tiles of the dates
+   * @param output The output tile
+   * @param line The row
+   * @param valid Scratch space for the validity of every date, ndates * width
+   * @param scratch Scratch space for the values of one pixel over the dates
+   */
+  void reducerow(std::vector<DataBuffer<float>*>& tiles, DataBuffer<float>& output, int line,
+    std::vector<unsigned char>& valid, std::vector<float>& scratch) const
+  {
+    int ndates = (int)tiles.size();
+    int width = output.width();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int date=0; date<ndates; date++)
+      validrow(tiles, date, line, &valid[(size_t)date * width]);
+
+    if (method_ == CompositeCount)
+    {
+      float* out = output.row(0, line).data();
+      for (int sample=0; sample<width; sample++)
+        out[sample] = 0.0f;
+      for (int date=0; date<ndates; date++)
+      {
+        const unsigned char* v = &valid[(size_t)date * width];
+        for (int sample=0; sample<width; sample++)
+          out[sample] += (float)v[sample];
+      }
+    }
+    else if (method_ == CompositeMean)
+    {
+      std::vector<float> count(width, 0.0f);
+      for (int date=0; date<ndates; date++)
+      {
+        const unsigned char* v = &valid[(size_t)date * width];
+        for (int sample=0; sample<width; sample++)
+          count[sample] += (float)v[sample];
+      }
+      for (int band=0; band<nbands_; band++)
+      {
+        std::vector<double> sum(width, 0.0);
+        for (int date=0; date<ndates; date++)
+        {
+          const float* row = tiles[date]->row(band, line).data();
+          const unsigned char* v = &valid[(size_t)date * width];
+          for (int sample=0; sample<width; sample++)
+            sum[sample] += v[sample] ? (double)row[sample] : 0.0;
+        }
+        float* out = output.row(band, line).data();
+        for (int sample=0; sample<width; sample++)
+          out[sample] = (count[sample] > 0.0f) ? (float)(sum[sample] / count[sample]) : nan;
+      }
+    }
+    else if (method_ == CompositeMedian)
+    {
+      std::vector<const float*> rows(ndates);
+      for (int band=0; band<nbands_; band++)
+      {
+        for (int date=0; date<ndates; date++)
+          rows[date] = tiles[date]->row(band, line).data();
+        float* out = output.row(band, line).data();
+        for (int sample=0; sample<width; sample++)
+        {
+          int n = 0;
+          for (int date=0; date<ndates; date++)
+          {
+            if (valid[(size_t)date * width + sample])
+              scratch[n++] = rows[date][sample];
+          }
+          if (!n)
+          {
+            out[sample] = nan;
+            continue;
+          }
+          std::nth_element(scratch.begin(), scratch.begin() + n / 2, scratch.begin() + n);
+          float upper = scratch[n / 2];
+          if (n % 2)
+            out[sample] = upper;
+          else
+            out[sample] = 0.5f * (upper + *std::max_element(scratch.begin(), scratch.begin() + n / 2));
+        }
+      }
+    }
+    else
+    {
+      //the first date reaching the greatest NDVI wins; its bands are carried through
+      std::vector<float> best(width, -std::numeric_limits<float>::max());
+      std::vector<int> bestDate(width, -1);
+      for (int date=0; date<ndates; date++)
+      {
+        const unsigned char* v = &valid[(size_t)date * width];
+        const float* red = tiles[date]->row(redBand_, line).data();
+        const float* nir = tiles[date]->row(nirBand_, line).data();
+        for (int sample=0; sample<width; sample++)
+        {
+          float ndvi = (redBand_ == nirBand_) ? red[sample] : (nir[sample] - red[sample]) / (nir[sample] + red[sample]);
+          bool better = v[sample] && ndvi == ndvi && ndvi > best[sample];
+          best[sample] = better ? ndvi : best[sample];
+          bestDate[sample] = better ? date : bestDate[sample];
+        }
+      }
+      std::vector<const float*> rows(ndates);
+      for (int band=0; band<nbands_; band++)
+      {
+        for (int date=0; date<ndates; date++)
+          rows[date] = tiles[date]->row(band, line).data();
+        float* out = output.row(band, line).data();
+        for (int sample=0; sample<width; sample++)
+          out[sample] = (bestDate[sample] >= 0) ? rows[bestDate[sample]][sample] : nan;
+      }
+    }
+  };
+
+public:
+
+  /** Constructor.
+   * @param stack The dates, on one pixel grid and with the same number of bands
+   * @param method The reducer
+   */
+  TemporalComposite(const std::vector<DataRaster*>& stack, CompositeMethod method) throw(Exception)
+    : stack_(stack), method_(method), nbands_(0), redBand_(0), nirBand_(0)
+  {
+    if (stack_.empty())
+      throw Exception("TemporalComposite: Error: the stack is empty.");
+    nbands_ = stack_[0]->nbands();
+    noData_.resize(stack_.size());
+    hasNoData_.resize(stack_.size());
+    for (size_t date=0; date<stack_.size(); date++)
+    {
+      if (stack_[date]->nbands() != nbands_)
+        throw Exception("TemporalComposite: Error: every date must have the same number of bands.");
+      for (int band=1; band<=nbands_; band++)
+      {
+        bool hasNoData = false;
+        noData_[date].push_back((float)stack_[date]->noDataValue(band, &hasNoData));
+        hasNoData_[date].push_back(hasNoData ? 1 : 0);
+      }
+    }
+  };
+
+  /** Destructor */
+  virtual ~TemporalComposite(void) {};
+
+  /** Sets the bands the NDVI of a date is computed from for CompositeMaxNdvi.  By default band 1 is
+   *  taken to hold NDVI already.
+   * @param redBand The red band.  This follows GDAL and is 1 based.
+   * @param nirBand The near infrared band.  This follows GDAL and is 1 based.
+   */
+  void setNdviBands(int redBand, int nirBand) throw(Exception)
+  {
+    if (redBand < 1 || redBand > nbands_ || nirBand < 1 || nirBand > nbands_)
+      throw Exception("TemporalComposite::setNdviBands Error: band out of range.");
+    redBand_ = redBand - 1;
+    nirBand_ = nirBand - 1;
+  };
+
+  /** Returns the dimensions the output must have: the area common to every date */
+  RasterDims outputDims(void) const throw(Exception)
+  {
+    MultiRasterIterator iter(stack_, 1024 * 1024);
+    return(RasterDims(0, iter.dims().width() - 1, 0, iter.dims().height() - 1));
+  };
+
+  /** Returns the number of bands the output must have */
+  int outputBands(void) const { return((method_ == CompositeCount) ? 1 : nbands_); };
+
+  /** Computes the composite.
+   * @param output A raster with outputDims() and outputBands(), open for update.  Values are written as single precision.
+   * @param memsize The memsize in bytes of the tile read from each date
+   * @param nthreads The number of threads, or 0 for the OpenMP default
+   */
+  void run(DataRaster& output, long long memsize = 1024 * 1024, int nthreads = 0) throw(Exception)
+  {
+    MultiRasterIterator iter(stack_, memsize);
+    const RasterDims& common = iter.dims();
+    if (!(output.dims() == RasterDims(0, common.width() - 1, 0, common.height() - 1)) || output.nbands() != outputBands())
+      throw Exception("TemporalComposite::run Error: the output does not have the dimensions and bands of the composite.");
+
+    int maxthreads = 1;
+#ifdef _OPENMP
+    maxthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#endif
+    (void)nthreads;
+    int ndates = (int)stack_.size();
+
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims tiledims;
+      iter.getTileDims(tilenum, tiledims);
+      std::vector<DataBuffer<float>*> tiles(ndates, (DataBuffer<float>*)NULL);
+      RasterDims tileout(0, tiledims.width() - 1, tiledims.startLine() - common.startLine(), tiledims.endLine() - common.startLine());
+      DataBuffer<float> outdata(tileout, outputBands(), false);
+      try
+      {
+        for (int date=0; date<ndates; date++)
+        {
+          RasterDims window;
+          iter.getInputDims(date, tilenum, window);
+          tiles[date] = new DataBuffer<float>(window, nbands_, false);
+        }
+        for (int band=0; band<nbands_; band++)
+          iter.getData(tilenum, tiles, GDT_Float32, band + 1, band);
+
+        int height = tiledims.height();
+#ifdef _OPENMP
+#pragma omp parallel num_threads(maxthreads)
+#endif
+        {
+          std::vector<unsigned char> valid((size_t)ndates * tiledims.width());
+          std::vector<float> scratch(ndates);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (int line=0; line<height; line++)
+            reducerow(tiles, outdata, line, valid, scratch);
+        }
+
+        for (int band=0; band<outputBands(); band++)
+          output.setData(outdata, tileout, band + 1, GDT_Float32, band);
+      }
+      catch (...)
+      {
+        for (int date=0; date<ndates; date++)
+          delete(tiles[date]);
+        throw;
+      }
+      for (int date=0; date<ndates; date++)
+        delete(tiles[date]);
+    }
+  };
+
+};
+#endif
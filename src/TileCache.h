@@ -0,0 +1,298 @@
+#ifndef _TILECACHEH_
+#define _TILECACHEH_
+//================================================================
+//
+// File: TileCache.h
+// Created: 10/19/2026
+// Purpose: A persistent on-disk cache of decoded raster windows
+//
+//================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <utime.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "Exception.h"
+#include "RasterDims.h"
+#include "TileManifest.h"
+
+/** TileCache: a persistent cache of decoded raster windows, shared by the runs that read the same inputs.
+ *  Each entry is one file in the cache directory holding a small header followed by the raw decoded
+ *  values, so entries can also be memory mapped.  Entries are keyed by the identity of the source file
+ *  (path, inode, size and modification time), the band, the window and the data type; an input that changes
+ *  on disk gets new keys and its old entries age out.  When the entries exceed the byte budget the
+ *  least recently used ones are removed; the entries are kept in recency order, so each eviction costs
+ *  constant time.  Recency survives between runs through the entry file times.
+ *  A TileCache object is thread safe, so several DataRasters read concurrently, e.g. by a
+ *  MultiRasterIterator, can share one; the entry files are read, written and removed outside its lock.
+ *  Entries are written to a temporary file and renamed, so concurrent processes can share a directory:
+ *  a key that is not in the index is looked up in the directory, which picks up entries other processes
+ *  wrote after construction, and an indexed entry whose file has gone is dropped from the index.
+ */
+class TileCache
+{
+
+private:
+
+  struct Entry
+  {
+    unsigned long long nbytes;
+    std::list<std::string>::iterator use;  //position in lru_
+  };
+
+  std::string directory_;
+  unsigned long long budget_;
+  unsigned long long nbytes_;
+  long long hits_;
+  long long misses_;
+  unsigned long long ntemp_;
+  std::map<std::string, Entry> entries_;
+  std::list<std::string> lru_;  //keys, most recently used first
+  mutable pthread_mutex_t mutex_;
+
+  /** Scoped lock of the cache.  This is an internal class. */
+  class Lock
+  {
+    pthread_mutex_t* mutex_;
+  public:
+    Lock(pthread_mutex_t* mutex) : mutex_(mutex) { pthread_mutex_lock(mutex_); };
+    ~Lock(void) { pthread_mutex_unlock(mutex_); };
+  };
+
+  /** Returns the path of an entry file.  This is an internal method. */
+  std::string path(const std::string& key) const { return(directory_ + "/" + key + ".tile"); };
+
+  /** Loads the entries already in the directory, oldest first.  This is an internal method. */
+  void scan(void)
+  {
+    DIR* dir = opendir(directory_.c_str());
+    if (!dir)
+      return;
+    std::multimap<long long, std::pair<std::string, unsigned long long> > byTime;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+      std::string name(ent->d_name);
+      if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".tile") != 0)
+        continue;
+      struct stat st;
+      if (stat((directory_ + "/" + name).c_str(), &st) != 0)
+        continue;
+      byTime.insert(std::make_pair((long long)st.st_mtime, std::make_pair(name.substr(0, name.size() - 5), (unsigned long long)st.st_size)));
+    }
+    closedir(dir);
+
+    for (std::multimap<long long, std::pair<std::string, unsigned long long> >::iterator it=byTime.begin(); it!=byTime.end(); ++it)
+      insert(it->second.first, it->second.second);
+  };
+
+  /** Adds or replaces an entry as the most recently used one.  This is an internal method and is called
+   *  with the mutex held.
+   */
+  void insert(const std::string& key, unsigned long long nbytes)
+  {
+    std::map<std::string, Entry>::iterator it = entries_.find(key);
+    if (it != entries_.end())
+    {
+      nbytes_ -= it->second.nbytes;
+      lru_.splice(lru_.begin(), lru_, it->second.use);
+    }
+    else
+    {
+      lru_.push_front(key);
+      it = entries_.insert(std::make_pair(key, Entry())).first;
+      it->second.use = lru_.begin();
+    }
+    it->second.nbytes = nbytes;
+    nbytes_ += nbytes;
+  };
+
+  /** Drops an entry from the index.  This is an internal method and is called with the mutex held. */
+  void erase(std::map<std::string, Entry>::iterator it)
+  {
+    nbytes_ -= it->second.nbytes;
+    lru_.erase(it->second.use);
+    entries_.erase(it);
+  };
+
+  /** Drops least recently used entries from the index until the cache fits in its budget.  The keys are
+   *  appended to victims, whose files the caller removes after releasing the mutex.  This is an internal
+   *  method and is called with the mutex held.
+   */
+  void evict(std::vector<std::string>& victims)
+  {
+    while (nbytes_ > budget_ && !lru_.empty())
+    {
+      victims.push_back(lru_.back());
+      erase(entries_.find(lru_.back()));
+    }
+  };
+
+  /** Removes the files of evicted entries.  This is an internal method and is called without the mutex. */
+  void removeFiles(const std::vector<std::string>& victims) const
+  {
+    for (size_t idx=0; idx<victims.size(); idx++)
+      remove(path(victims[idx]).c_str());
+  };
+
+public:
+
+  /** Constructor.
+   * @param directory The cache directory.  It is created if it does not exist.
+   * @param budget The largest number of bytes the entries may occupy
+   */
+  TileCache(const std::string& directory, unsigned long long budget) throw(Exception)
+    : directory_(directory), budget_(budget), nbytes_(0), hits_(0), misses_(0), ntemp_(0)
+  {
+    pthread_mutex_init(&mutex_, NULL);
+    mkdir(directory_.c_str(), 0755);
+    struct stat st;
+    if (stat(directory_.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+      pthread_mutex_destroy(&mutex_);
+      throw Exception(std::string("TileCache: Error: unable to use directory ") + directory_);
+    }
+    scan();
+    std::vector<std::string> victims;
+    evict(victims);
+    removeFiles(victims);
+  };
+
+  /** Destructor */
+  virtual ~TileCache(void) { pthread_mutex_destroy(&mutex_); };
+
+  /** Returns the key of a window of a band of a file, or an empty string if the file cannot be identified.
+   * @param filename The source file
+   * @param band The band.  This follows GDAL and is 1 based.
+   * @param dims The window
+   * @param dataType The data type the values are decoded to, a GDALDataType
+   */
+  static std::string key(const std::string& filename, int band, const RasterDims& dims, int dataType)
+  {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+      return(std::string());
+    char* resolved = realpath(filename.c_str(), NULL);
+    std::string fullpath(resolved ? resolved : filename.c_str());
+    free(resolved);
+
+    std::ostringstream identity;
+    identity << fullpath << " " << (long long)st.st_size << " " << (long long)st.st_mtime << "." << (long long)st.st_mtim.tv_nsec
+             << " " << (long long)st.st_ino
+             << " " << band << " " << dims.startSample() << " " << dims.endSample() << " "
+             << dims.startLine() << " " << dims.endLine() << " " << dataType;
+    std::string id = identity.str();
+    std::ostringstream ostr;
+    ostr << std::hex << TileManifest::checksum(id.data(), id.size()) << "_" << TileManifest::checksum(id.data(), id.size(), 0x9e3779b9ULL);
+    return(ostr.str());
+  };
+
+  /** Retrieves an entry.
+   * @param key The key
+   * @param data The destination
+   * @param nbytes The size of the destination.  An entry of another size is treated as a miss.
+   * @return true on a hit
+   */
+  bool get(const std::string& key, void* data, unsigned long long nbytes)
+  {
+    //the file is read even when the key is not indexed, it may have been written by another process.
+    //an entry evicted meanwhile is either still readable through the open file or missing.
+    bool hit = false, missing = true;
+    FILE* fp = fopen(path(key).c_str(), "rb");
+    if (fp)
+    {
+      missing = false;
+      char header[16];
+      unsigned long long stored = 0;
+      hit = (fread(header, 1, 16, fp) == 16 && memcmp(header, "TILECAC1", 8) == 0);
+      memcpy(&stored, header + 8, 8);
+      hit = hit && stored == nbytes && fread(data, 1, nbytes, fp) == nbytes;
+      fclose(fp);
+    }
+    if (hit)
+      utime(path(key).c_str(), NULL);  //keeps the recency for later runs
+
+    std::vector<std::string> victims;
+    {
+      Lock lock(&mutex_);
+      std::map<std::string, Entry>::iterator it = entries_.find(key);
+      if (hit)
+      {
+        insert(key, nbytes + 16);
+        evict(victims);
+        hits_++;
+      }
+      else
+      {
+        if (missing && it != entries_.end())
+          erase(it);
+        misses_++;
+      }
+    }
+    removeFiles(victims);
+    return(hit);
+  };
+
+  /** Stores an entry, evicting least recently used entries to stay within the budget.  Entries larger
+   *  than the budget are not stored.  Write failures leave the cache without the entry.
+   * @param key The key
+   * @param data The values
+   * @param nbytes The number of bytes
+   */
+  void put(const std::string& key, const void* data, unsigned long long nbytes)
+  {
+    if (key.empty() || nbytes + 16 > budget_)
+      return;
+
+    std::ostringstream tmpname;
+    {
+      Lock lock(&mutex_);
+      tmpname << path(key) << ".tmp" << getpid() << "_" << ntemp_++;
+    }
+    FILE* fp = fopen(tmpname.str().c_str(), "wb");
+    if (!fp)
+      return;
+    char header[16];
+    memcpy(header, "TILECAC1", 8);
+    memcpy(header + 8, &nbytes, 8);
+    bool ok = (fwrite(header, 1, 16, fp) == 16 && fwrite(data, 1, nbytes, fp) == nbytes);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmpname.str().c_str(), path(key).c_str()) != 0)
+    {
+      remove(tmpname.str().c_str());
+      return;
+    }
+
+    std::vector<std::string> victims;
+    {
+      Lock lock(&mutex_);
+      insert(key, nbytes + 16);
+      evict(victims);
+    }
+    removeFiles(victims);
+  };
+
+  /** Returns the number of bytes the entries occupy */
+  unsigned long long nbytes(void) const { Lock lock(&mutex_); return(nbytes_); };
+
+  /** Returns the number of entries */
+  int nentries(void) const { Lock lock(&mutex_); return((int)entries_.size()); };
+
+  /** Returns the number of hits since construction */
+  long long hits(void) const { Lock lock(&mutex_); return(hits_); };
+
+  /** Returns the number of misses since construction */
+  long long misses(void) const { Lock lock(&mutex_); return(misses_); };
+
+};
+#endif
@@ -0,0 +1,188 @@
+#ifndef _TILEMANIFESTH_
+#define _TILEMANIFESTH_
+//================================================================
+//
+// File: TileManifest.h
+// Created: 10/19/2026
+// Purpose: A persistent record of completed tiles used to resume
+//          and incrementally update tiled processing runs.
+//
+//================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "Exception.h"
+#include "DataBuffer.h"
+
+/** TileManifest: a persistent record of the tiles a run has completed.
+ *  Each entry holds the tile number and a checksum of the input window the tile was computed from.
+ *  The file starts with a parameter string; a manifest written with different parameters is discarded.
+ *  Entries are appended and flushed as tiles complete, so a run that dies loses at most the tile in flight.
+ *  When a tile is recorded more than once the last entry wins.
+ */
+class TileManifest
+{
+
+private:
+
+  std::string filename_;
+  std::string parameters_;
+  std::map<int, unsigned long long> tiles_;
+  FILE* fp_;
+  bool resumed_;
+  long long validBytes_;
+
+  /** Loads an existing manifest.  Returns false if it does not exist or its parameters differ.
+   *  validBytes_ is set to the length of the header and the complete entries that follow it.
+   */
+  bool load(void)
+  {
+    std::ifstream ifs(filename_.c_str());
+    if (!ifs)
+      return(false);
+
+    //a line that hits the end of the file without a newline was cut off by an interrupted write
+    std::string line;
+    if (!std::getline(ifs, line) || ifs.eof() || line != "TILEMANIFEST 1")
+      return(false);
+    if (!std::getline(ifs, line) || ifs.eof() || line != std::string("parameters ") + parameters_)
+      return(false);
+    validBytes_ = (long long)ifs.tellg();
+
+    while (std::getline(ifs, line) && !ifs.eof())
+    {
+      std::istringstream iss(line);
+      std::string tag;
+      int tilenum;
+      unsigned long long checksum;
+      if (!(iss >> tag >> tilenum >> std::hex >> checksum) || tag != "tile")
+        break;
+      tiles_[tilenum] = checksum;
+      validBytes_ = (long long)ifs.tellg();
+    }
+    return(true);
+  };
+
+  /** Starts an empty manifest, replacing any existing file.  This is an internal method. */
+  void start(void) throw(Exception)
+  {
+    if (fp_)
+      fclose(fp_);
+    tiles_.clear();
+    fp_ = fopen(filename_.c_str(), "w");
+    if (!fp_)
+      throw Exception(std::string("TileManifest: Error: unable to open ") + filename_);
+    fprintf(fp_, "TILEMANIFEST 1\nparameters %s\n", parameters_.c_str());
+    if (fflush(fp_) != 0)
+      throw Exception(std::string("TileManifest: Error: unable to write ") + filename_);
+  };
+
+public:
+
+  /** Constructor.  Opens the manifest, resuming it if it was written with the same parameters and
+   *  starting a new one otherwise.
+   * @param filename The manifest filename
+   * @param parameters A single line describing everything that affects the output, e.g. input, tiling and output type
+   */
+  TileManifest(const std::string& filename, const std::string& parameters) throw(Exception)
+    : filename_(filename), parameters_(parameters), fp_(NULL), resumed_(false), validBytes_(0)
+  {
+    if (parameters_.find('\n') != std::string::npos)
+      throw Exception("TileManifest: Error: parameters must be a single line.");
+
+    resumed_ = load();
+    if (!resumed_)
+    {
+      start();
+      return;
+    }
+
+    //drop a partial last line and anything after it, so new entries start on a line of their own
+    if (truncate(filename_.c_str(), (off_t)validBytes_) != 0)
+      throw Exception(std::string("TileManifest: Error: unable to truncate ") + filename_);
+    fp_ = fopen(filename_.c_str(), "a");
+    if (!fp_)
+      throw Exception(std::string("TileManifest: Error: unable to open ") + filename_);
+  };
+
+  /** Destructor */
+  virtual ~TileManifest(void)
+  {
+    if (fp_)
+      fclose(fp_);
+  };
+
+  /** Returns true if an existing manifest with matching parameters was loaded */
+  bool resumed(void) const { return(resumed_); };
+
+  /** Discards every recorded tile and rewrites the manifest empty, e.g. when the output the tiles were
+   *  written to is gone.  resumed() returns false afterwards.
+   */
+  void discard(void) throw(Exception)
+  {
+    resumed_ = false;
+    start();
+  };
+
+  /** Returns the number of tiles recorded as complete */
+  int ncomplete(void) const { return((int)tiles_.size()); };
+
+  /** Returns true if the tile has an entry, whatever its checksum */
+  bool contains(int tilenum) const { return(tiles_.find(tilenum) != tiles_.end()); };
+
+  /** Returns true if the tile was completed from an input window with the given checksum */
+  bool isComplete(int tilenum, unsigned long long checksum) const
+  {
+    std::map<int, unsigned long long>::const_iterator it = tiles_.find(tilenum);
+    return(it != tiles_.end() && it->second == checksum);
+  };
+
+  /** Records a tile as complete.  The caller must have flushed the tile's output first.
+   * @param tilenum The tile number
+   * @param checksum The checksum of the input window
+   */
+  void markComplete(int tilenum, unsigned long long checksum) throw(Exception)
+  {
+    if (fprintf(fp_, "tile %d %llx\n", tilenum, checksum) < 0 || fflush(fp_) != 0)
+      throw Exception(std::string("TileManifest: Error: unable to write ") + filename_);
+    tiles_[tilenum] = checksum;
+  };
+
+  /** Computes a 64 bit checksum of a block of memory.
+   * @param data The data
+   * @param nbytes The number of bytes
+   * @param seed A seed, used to chain checksums
+   */
+  static unsigned long long checksum(const void* data, size_t nbytes, unsigned long long seed = 0ULL)
+  {
+    const unsigned long long prime = 0x100000001b3ULL;
+    unsigned long long h = 0xcbf29ce484222325ULL ^ (seed * prime);
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t nwords = nbytes / 8;
+    for (size_t idx=0; idx<nwords; idx++)
+    {
+      unsigned long long word;
+      memcpy(&word, bytes + idx * 8, 8);
+      h = (h ^ word) * prime;
+      h ^= h >> 29;
+    }
+    for (size_t idx=nwords*8; idx<nbytes; idx++)
+      h = (h ^ bytes[idx]) * prime;
+    h ^= nbytes;
+    return(h ? h : 1ULL);  //zero is reserved for tiles without stored input
+  };
+
+  /** Computes the checksum of all bands of a DataBuffer */
+  template <typename T> static unsigned long long checksum(DataBuffer<T>& buf)
+  {
+    size_t nbytes = (size_t)buf.dims().width() * buf.dims().height() * buf.nbands() * sizeof(T);
+    return(checksum(buf.data(), nbytes));
+  };
+
+};
+#endif
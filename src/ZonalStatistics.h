@@ -0,0 +1,339 @@
+#ifndef _ZONALSTATISTICSH_
+#define _ZONALSTATISTICSH_
+//================================================================
+//
+// File: ZonalStatistics.h
+// Created: 10/19/2026
+// Purpose: Per zone statistics of a value raster over a label raster
+//
+//================================================================
+
+#include <math.h>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Exception.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "DataRasterIterator.h"
+#include "RasterDims.h"
+
+/** ZoneStats: the statistics of one zone */
+struct ZoneStats
+{
+  unsigned int label;
+  long long count;
+  double sum;
+  float min;
+  float max;
+
+  /** Returns the mean value of the zone */
+  double mean(void) const { return(count ? sum / (double)count : 0.0); };
+
+  /** Orders zones by label */
+  bool operator<(const ZoneStats& rhs) const { return(label < rhs.label); };
+};
+
+/** ZoneTable: per zone accumulators.  Labels below a limit are held in a dense array indexed by label,
+ *  larger labels in an open addressing hash table, so small label ranges cost one indexed add per pixel
+ *  and sparse or very large label ranges use memory in proportion to the zones present.
+ */
+class ZoneTable
+{
+
+private:
+
+  std::vector<ZoneStats> dense_;
+  std::vector<ZoneStats> slots_;
+  size_t nslots_;
+  unsigned int denseLimit_;
+
+  /** Returns an empty accumulator */
+  static ZoneStats empty(unsigned int label)
+  {
+    ZoneStats zone;
+    zone.label = label;
+    zone.count = 0;
+    zone.sum = 0.0;
+    zone.min = std::numeric_limits<float>::max();
+    zone.max = -std::numeric_limits<float>::max();
+    return(zone);
+  };
+
+  /** Returns the hash slot of a label in a table of the given power of two size */
+  static size_t slot(unsigned int label, size_t size)
+  {
+    return((size_t)((label * 2654435761u) ^ (label >> 16)) & (size - 1));
+  };
+
+  /** Doubles the hash table */
+  void grow(void)
+  {
+    std::vector<ZoneStats> old;
+    old.swap(slots_);
+    size_t size = old.empty() ? 1024 : old.size() * 2;
+    slots_.assign(size, empty(0));
+    for (size_t idx=0; idx<old.size(); idx++)
+    {
+      if (!old[idx].count)
+        continue;
+      size_t pos = slot(old[idx].label, size);
+      while (slots_[pos].count)
+        pos = (pos + 1) & (size - 1);
+      slots_[pos] = old[idx];
+    }
+  };
+
+public:
+
+  /** Constructor.
+   * @param denseLimit Labels below this value are held in the dense array
+   */
+  ZoneTable(unsigned int denseLimit = 1u << 16) : nslots_(0), denseLimit_(denseLimit) {};
+
+  /** Returns the accumulator of a zone, creating it if needed */
+  inline ZoneStats& zone(unsigned int label)
+  {
+    if (label < denseLimit_)
+    {
+      if (label >= dense_.size())
+      {
+        size_t size = dense_.size() * 2;
+        size = (size < (size_t)label + 1) ? (size_t)label + 1 : size;
+        size = (size > denseLimit_) ? denseLimit_ : size;
+        size_t first = dense_.size();
+        dense_.resize(size);
+        for (size_t idx=first; idx<size; idx++)
+          dense_[idx] = empty((unsigned int)idx);
+      }
+      return(dense_[label]);
+    }
+
+    if ((nslots_ + 1) * 2 > slots_.size())
+      grow();
+    size_t pos = slot(label, slots_.size());
+    while (slots_[pos].count && slots_[pos].label != label)
+      pos = (pos + 1) & (slots_.size() - 1);
+    if (!slots_[pos].count)
+    {
+      //a new zone, counted as present from here on
+      slots_[pos] = empty(label);
+      nslots_++;
+    }
+    return(slots_[pos]);
+  };
+
+  /** Adds a value to a zone */
+  inline void add(unsigned int label, float value)
+  {
+    ZoneStats& z = zone(label);
+    z.count++;
+    z.sum += value;
+    z.min = (value < z.min) ? value : z.min;
+    z.max = (value > z.max) ? value : z.max;
+  };
+
+  /** Adds the statistics of a zone accumulated elsewhere */
+  void merge(const ZoneStats& other)
+  {
+    if (!other.count)
+      return;
+    ZoneStats& z = zone(other.label);
+    z.count += other.count;
+    z.sum += other.sum;
+    z.min = (other.min < z.min) ? other.min : z.min;
+    z.max = (other.max > z.max) ? other.max : z.max;
+  };
+
+  /** Adds every zone of another table */
+  void merge(const ZoneTable& other)
+  {
+    for (size_t idx=0; idx<other.dense_.size(); idx++)
+      merge(other.dense_[idx]);
+    for (size_t idx=0; idx<other.slots_.size(); idx++)
+      merge(other.slots_[idx]);
+  };
+
+  /** Appends the zones with at least one pixel to a vector, unordered */
+  void collect(std::vector<ZoneStats>& zones) const
+  {
+    for (size_t idx=0; idx<dense_.size(); idx++)
+    {
+      if (dense_[idx].count)
+        zones.push_back(dense_[idx]);
+    }
+    for (size_t idx=0; idx<slots_.size(); idx++)
+    {
+      if (slots_[idx].count)
+        zones.push_back(slots_[idx]);
+    }
+  };
+
+};
+
+/** ZonalStatistics: computes the count, sum, mean, minimum and maximum of a value raster, e.g. NDVI,
+ *  for every zone of a label raster, e.g. rasterized field polygons, in one pass.  The rasters are read
+ *  together chunk by chunk with a DataRasterIterator; each thread accumulates its rows into its own
+ *  ZoneTable and the tables are merged at the end.  Pixels where either raster holds its nodata value,
+ *  and NaN values, are ignored.  Labels are unsigned 32 bit integers.  Signed label rasters, e.g. Int16 or
+ *  Int32 with a nodata value of -1, are read as signed integers so their nodata value is matched before
+ *  any conversion; any other negative label is an error.
+ */
+class ZonalStatistics
+{
+
+private:
+
+  DataRaster& values_;
+  DataRaster& labels_;
+  int valueBand_;
+  int labelBand_;
+  unsigned int denseLimit_;
+  std::vector<ZoneStats> zones_;
+
+  /** Converts the label nodata value to the label type.  hasNoData is cleared when no label can hold
+   *  the value.  This is an internal method.
+   */
+  template <typename L> static L labelnodata(double noData, bool& hasNoData)
+  {
+    if (!hasNoData || noData != floor(noData) || noData < (double)std::numeric_limits<L>::min() ||
+        noData > (double)std::numeric_limits<L>::max())
+    {
+      hasNoData = false;
+      return(0);
+    }
+    return(static_cast<L>(noData));
+  };
+
+  /** Reads the labels with type L and accumulates the zones of the whole raster.  This is an internal method. */
+  template <typename L> void accumulate(GDALDataType labelType, long long memsize, int maxthreads,
+    std::vector<ZoneTable>& tables) throw(Exception)
+  {
+    bool hasValueNoData = false, hasLabelNoData = false;
+    float valueNoData = (float)values_.noDataValue(valueBand_, &hasValueNoData);
+    L labelNoData = labelnodata<L>(labels_.noDataValue(labelBand_, &hasLabelNoData), hasLabelNoData);
+    long long nnegative = 0;
+
+    DataRasterIterator iter(values_, memsize, 0);
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims chunkdims;
+      iter.getTileDims(tilenum, chunkdims);
+      DataBuffer<float> valuedata(chunkdims, 1, false);
+      DataBuffer<L> labeldata(chunkdims, 1, false);
+      values_.getData(valuedata, valueBand_, GDT_Float32, 0);
+      labels_.getData(labeldata, labelBand_, labelType, 0);
+      DataView<float> valueview = valuedata.band(0);
+      DataView<L> labelview = labeldata.band(0);
+      int height = chunkdims.height();
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(maxthreads) reduction(+:nnegative)
+#endif
+      {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#pragma omp for schedule(static)
+#endif
+        for (int line=0; line<height; line++)
+        {
+          ZoneTable& table = tables[thread];
+          RowView<float> valuerow = valueview.row(line);
+          RowView<L> labelrow = labelview.row(line);
+          for (long long sample=0; sample<valuerow.size(); sample++)
+          {
+            float value = valuerow[sample];
+            L label = labelrow[sample];
+            if (value != value || (hasValueNoData && value == valueNoData) || (hasLabelNoData && label == labelNoData))
+              continue;
+            if (std::numeric_limits<L>::is_signed && label < 0)
+            {
+              nnegative++;
+              continue;
+            }
+            table.add(static_cast<unsigned int>(label), value);
+          }
+        }
+      }
+    }
+    if (nnegative)
+      throw Exception("ZonalStatistics::run Error: the label raster holds negative labels other than its nodata value.");
+  };
+
+public:
+
+  /** Constructor.
+   * @param values The value raster
+   * @param labels The label raster, with the same dimensions as the value raster
+   * @param valueBand The band of the value raster.  This follows GDAL and is 1 based.
+   * @param labelBand The band of the label raster.  This follows GDAL and is 1 based.
+   */
+  ZonalStatistics(DataRaster& values, DataRaster& labels, int valueBand = 1, int labelBand = 1) throw(Exception)
+    : values_(values), labels_(labels), valueBand_(valueBand), labelBand_(labelBand), denseLimit_(1u << 16)
+  {
+    if (!(values_.dims() == labels_.dims()))
+      throw Exception("ZonalStatistics: Error: the value and label rasters must have the same dimensions.");
+  };
+
+  /** Destructor */
+  virtual ~ZonalStatistics(void) {};
+
+  /** Sets the label below which zones are held in dense arrays rather than hash tables.  Each thread
+   *  allocates up to this many accumulators.  Call before run().
+   * @param denseLimit The limit
+   */
+  void setDenseLimit(unsigned int denseLimit) { denseLimit_ = denseLimit; };
+
+  /** Computes the statistics.
+   * @param memsize The memsize in bytes of the chunks read from the value raster
+   * @param nthreads The number of threads, or 0 for the OpenMP default
+   */
+  void run(long long memsize = 1024 * 1024, int nthreads = 0) throw(Exception)
+  {
+    int maxthreads = 1;
+#ifdef _OPENMP
+    maxthreads = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#endif
+    (void)nthreads;
+    std::vector<ZoneTable> tables(maxthreads, ZoneTable(denseLimit_));
+
+    //unsigned labels are read as they are, anything else as signed integers so negative values survive
+    switch(labels_.dataType(labelBand_))
+    {
+      case (GDT_Byte):
+      case (GDT_UInt16):
+      case (GDT_UInt32):
+        accumulate<unsigned int>(GDT_UInt32, memsize, maxthreads, tables);
+        break;
+      default:
+        accumulate<int>(GDT_Int32, memsize, maxthreads, tables);
+        break;
+    }
+
+    for (int thread=1; thread<maxthreads; thread++)
+      tables[0].merge(tables[thread]);
+    zones_.clear();
+    tables[0].collect(zones_);
+    std::sort(zones_.begin(), zones_.end());
+  };
+
+  /** Returns the zones with at least one valid pixel, ordered by label */
+  const std::vector<ZoneStats>& zones(void) const { return(zones_); };
+
+  /** Returns the statistics of a zone, or NULL if it has no valid pixels
+   * @param label The label of the zone
+   */
+  const ZoneStats* zone(unsigned int label) const
+  {
+    ZoneStats key;
+    key.label = label;
+    std::vector<ZoneStats>::const_iterator it = std::lower_bound(zones_.begin(), zones_.end(), key);
+    return((it != zones_.end() && it->label == label) ? &(*it) : NULL);
+  };
+
+};
+#endif
@@ -0,0 +1,383 @@
+//================================================================
+//
+// File: perf_main.cpp
+// Created: 10/19/2026
+// Purpose: Throughput regression tests of Ndvi and the raster IO
+//          paths on large synthetic rasters.
+//
+//================================================================
+
+#include <gdal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include "DataRaster.h"
+#include "DataBuffer.h"
+#include "DataRasterIterator.h"
+#include "RasterDims.h"
+#include "Ndvi.h"
+#include "PerfCounters.h"
+
+/** The options of a perf run */
+struct PerfOptions
+{
+  std::string baseline;
+  std::string tmpdir;
+  double tolerance;
+  double maxGigabytes;
+  int repeats;
+  int maxThreads;
+  bool update;
+  bool keep;
+  bool counters;
+};
+
+/** One measured case */
+struct PerfResult
+{
+  std::string name;
+  double mpixPerSecond;
+};
+
+/** Returns the wall clock time in seconds */
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return((double)tv.tv_sec + (double)tv.tv_usec * 1e-6);
+}
+
+/** Reads a baseline file of "name MPix/s" lines.  Lines starting with # are comments. */
+static std::map<std::string, double> readBaseline(const std::string& filename)
+{
+  std::map<std::string, double> baseline;
+  std::ifstream in(filename.c_str());
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream istr(line);
+    std::string name;
+    double value = 0.0;
+    if (istr >> name >> value)
+      baseline[name] = value;
+  }
+  return(baseline);
+}
+
+/** Writes a baseline file, keeping the entries of cases that were not run */
+static void writeBaseline(const std::string& filename, std::map<std::string, double> baseline, const std::vector<PerfResult>& results)
+{
+  for (size_t idx=0; idx<results.size(); idx++)
+    baseline[results[idx].name] = results[idx].mpixPerSecond;
+  std::ofstream out(filename.c_str());
+  out << "# Throughput baseline in MPix/s, written by perftest --update on the build host." << std::endl;
+  out << "# Baselines are host specific; regenerate them with 'make perf-baseline' after changing hosts." << std::endl;
+  for (std::map<std::string, double>::iterator it=baseline.begin(); it!=baseline.end(); ++it)
+    out << it->first << " " << std::fixed << std::setprecision(2) << it->second << std::endl;
+}
+
+/** Writes a synthetic 4 band image, strip by strip so memory stays small.  The red and NIR bands vary
+ *  smoothly with some noise, like vegetated terrain.  An existing file of the right size is reused.
+ */
+template <typename T> static void makeImage(const std::string& filename, int size, GDALDataType dt)
+{
+  DataRaster existing;
+  if (access(filename.c_str(), R_OK) == 0)
+  {
+    existing.open(filename, GA_ReadOnly);
+    if (existing.nsamples() == size && existing.nlines() == size && existing.dataType() == dt)
+      return;
+    existing.close();
+  }
+
+  double maxValue = (dt == GDT_Byte) ? 255.0 : 2047.0;
+  RasterDims rd(0, size - 1, 0, size - 1);
+  DataRaster raster;
+  raster.create(filename, rd, 4, dt, "GTiff");
+  int nlines = 256;
+  unsigned int state = 2463534242u;
+  for (int line=0; line<size; line+=nlines)
+  {
+    int endline = (line + nlines - 1 < size - 1) ? line + nlines - 1 : size - 1;
+    RasterDims strip(0, size - 1, line, endline);
+    DataBuffer<T> data(strip, 4, false);
+    for (int band=0; band<4; band++)
+    {
+      T* ptr = data.data() + (long long)band * strip.width() * strip.height();
+      for (long long idx=0; idx<(long long)strip.width() * strip.height(); idx++)
+      {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        double value = 0.3 + 0.2 * band + 0.05 * (double)(state & 1023) / 1024.0;
+        ptr[idx] = static_cast<T>(value * maxValue / 1.2);
+      }
+    }
+    for (int band=0; band<4; band++)
+      raster.setData(data, strip, band+1, dt, band);
+  }
+  raster.close();
+}
+
+/** Times a function of the image size, taking the best of the repeats.  Returns MPix/s. */
+template <typename Function> static double measure(const Function& function, int size, int repeats)
+{
+  double best = 0.0;
+  for (int repeat=0; repeat<repeats; repeat++)
+  {
+    double start = now();
+    function();
+    double elapsed = now() - start;
+    double rate = (double)size * (double)size / 1e6 / (elapsed > 1e-9 ? elapsed : 1e-9);
+    best = (rate > best) ? rate : best;
+  }
+  return(best);
+}
+
+/** Runs Ndvi on an image */
+struct NdviCase
+{
+  std::string input, output;
+  GDALDataType outputType;
+  int threads;
+  void operator()(void) const
+  {
+    Ndvi ndvi(input, output, outputType);
+    ndvi.setDecodeThreads(threads);
+    ndvi.run();
+  };
+};
+
+/** Reads every band of an image chunk by chunk with a DataRasterIterator */
+template <typename T> struct ReadCase
+{
+  std::string input;
+  int threads;
+  void operator()(void) const
+  {
+    DataRaster raster;
+    raster.open(input, GA_ReadOnly);
+    raster.setDecodeThreads(threads);
+    DataRasterIterator iter(raster, 4 * 1024 * 1024, 0, TilingModeAllBands);
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims chunkdims;
+      iter.getTileDims(tilenum, chunkdims);
+      DataBuffer<T> data(chunkdims, raster.nbands(), false);
+      for (int band=0; band<raster.nbands(); band++)
+        raster.getData(data, band+1, raster.dataType(), band);
+    }
+  };
+};
+
+/** Writes a single precision image chunk by chunk */
+struct WriteCase
+{
+  std::string output;
+  int size;
+  void operator()(void) const
+  {
+    RasterDims rd(0, size - 1, 0, size - 1);
+    DataRaster raster;
+    raster.create(output, rd, 1, GDT_Float32, "GTiff");
+    DataRasterIterator iter(raster, 4 * 1024 * 1024, 0);
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims chunkdims;
+      iter.getTileDims(tilenum, chunkdims);
+      DataBuffer<float> data(chunkdims, 1, true);
+      raster.setData(data, chunkdims, 1, GDT_Float32, 0);
+    }
+    raster.close();
+  };
+};
+
+/** Runs every case for one input type at one size */
+template <typename T> static void runSize(const PerfOptions& options, GDALDataType dt, const char* typeName, int size,
+  const std::vector<int>& threads, std::vector<PerfResult>& results)
+{
+  std::ostringstream base;
+  base << options.tmpdir << "/perf_" << typeName << "_" << size;
+  std::string input = base.str() + ".tif", output = base.str() + "_out.tif";
+  std::cout << "generating " << size << "x" << size << " 4 band " << typeName << " image" << std::endl;
+  makeImage<T>(input, size, dt);
+
+  for (size_t t=0; t<threads.size(); t++)
+  {
+    std::ostringstream suffix;
+    suffix << "_" << typeName << "_" << size << "_t" << threads[t];
+    PerfResult result;
+
+    NdviCase ndvi;
+    ndvi.input = input;
+    ndvi.output = output;
+    ndvi.outputType = GDT_Float32;
+    ndvi.threads = threads[t];
+    result.name = "ndvi_float32" + suffix.str();
+    result.mpixPerSecond = measure(ndvi, size, options.repeats);
+    results.push_back(result);
+
+    ndvi.outputType = GDT_Int16;
+    result.name = "ndvi_int16" + suffix.str();
+    result.mpixPerSecond = measure(ndvi, size, options.repeats);
+    results.push_back(result);
+
+    ReadCase<T> read;
+    read.input = input;
+    read.threads = threads[t];
+    result.name = "read" + suffix.str();
+    result.mpixPerSecond = measure(read, size, options.repeats);
+    results.push_back(result);
+  }
+
+  if (dt == GDT_UInt16)
+  {
+    WriteCase write;
+    write.output = output;
+    write.size = size;
+    std::ostringstream name;
+    name << "write_float32_" << size;
+    PerfResult result;
+    result.name = name.str();
+    result.mpixPerSecond = measure(write, size, options.repeats);
+    results.push_back(result);
+  }
+
+  remove(output.c_str());
+  if (!options.keep)
+    remove(input.c_str());
+}
+
+/** Prints the usage */
+static void usage(const char* program)
+{
+  std::cout << "USAGE: " << program << " [options]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  --baseline FILE    The baseline file (default perf_baseline.txt)" << std::endl;
+  std::cout << "  --update           Record the measured rates as the new baseline" << std::endl;
+  std::cout << "  --tolerance X      Fail when a rate drops more than this fraction below its baseline (default 0.2)" << std::endl;
+  std::cout << "  --tmpdir DIR       Where the synthetic images are written (default $TMPDIR or /tmp)" << std::endl;
+  std::cout << "  --max-gb X         The size of the largest UInt16 input in GB (default 2)" << std::endl;
+  std::cout << "  --repeats N        Repeats per case, the best is kept (default 3)" << std::endl;
+  std::cout << "  --threads N        The largest thread count measured (default: all cores)" << std::endl;
+  std::cout << "  --keep             Keep the synthetic images for the next run" << std::endl;
+  std::cout << "  --counters         Report hardware counters per kernel: IPC, bytes per cycle and cache and branch misses" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  PerfOptions options;
+  options.baseline = "perf_baseline.txt";
+  const char* tmpdir = getenv("TMPDIR");
+  options.tmpdir = (tmpdir && *tmpdir) ? tmpdir : "/tmp";
+  options.tolerance = 0.2;
+  options.maxGigabytes = 2.0;
+  options.repeats = 3;
+  options.maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  options.update = false;
+  options.keep = false;
+  options.counters = false;
+
+  for (int idx=1; idx<argc; idx++)
+  {
+    std::string arg(argv[idx]);
+    bool hasValue = (idx + 1 < argc);
+    if (arg == "--baseline" && hasValue) options.baseline = argv[++idx];
+    else if (arg == "--update") options.update = true;
+    else if (arg == "--tolerance" && hasValue) options.tolerance = atof(argv[++idx]);
+    else if (arg == "--tmpdir" && hasValue) options.tmpdir = argv[++idx];
+    else if (arg == "--max-gb" && hasValue) options.maxGigabytes = atof(argv[++idx]);
+    else if (arg == "--repeats" && hasValue) options.repeats = atoi(argv[++idx]);
+    else if (arg == "--threads" && hasValue) options.maxThreads = atoi(argv[++idx]);
+    else if (arg == "--keep") options.keep = true;
+    else if (arg == "--counters") options.counters = true;
+    else
+    {
+      usage(argv[0]);
+      return((arg == "-h" || arg == "--help") ? 0 : 2);
+    }
+  }
+  options.repeats = (options.repeats < 1) ? 1 : options.repeats;
+  options.maxThreads = (options.maxThreads < 1) ? 1 : options.maxThreads;
+
+  GDALAllRegister();
+  PerfCounters::instance().setEnabled(options.counters);
+  std::vector<int> threads(1, 1);
+  if (options.maxThreads > 1)
+    threads.push_back(options.maxThreads);
+
+  //sizes double up to the largest input, 4 bands of UInt16 at 8 bytes per pixel
+  std::vector<int> sizes;
+  for (int size=2048; (double)size * size * 8.0 <= options.maxGigabytes * 1024.0 * 1024.0 * 1024.0; size*=2)
+    sizes.push_back(size);
+  if (sizes.empty())
+    sizes.push_back(2048);
+
+  std::vector<PerfResult> results;
+  try
+  {
+    for (size_t idx=0; idx<sizes.size(); idx++)
+    {
+      runSize<unsigned short>(options, GDT_UInt16, "uint16", sizes[idx], threads, results);
+      runSize<unsigned char>(options, GDT_Byte, "byte", sizes[idx], threads, results);
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "perftest: " << e.what() << std::endl;
+    return(2);
+  }
+
+  std::map<std::string, double> baseline = readBaseline(options.baseline);
+  int nregressions = 0;
+  std::cout << std::endl << std::left << std::setw(36) << "case" << std::right << std::setw(12) << "MPix/s"
+            << std::setw(12) << "baseline" << std::setw(10) << "change" << std::endl;
+  for (size_t idx=0; idx<results.size(); idx++)
+  {
+    std::cout << std::left << std::setw(36) << results[idx].name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << results[idx].mpixPerSecond;
+    std::map<std::string, double>::iterator it = baseline.find(results[idx].name);
+    if (it == baseline.end() || it->second <= 0.0)
+    {
+      std::cout << std::setw(12) << "-" << std::setw(10) << "new" << std::endl;
+      continue;
+    }
+    double change = results[idx].mpixPerSecond / it->second - 1.0;
+    bool regressed = (change < -options.tolerance);
+    nregressions += regressed ? 1 : 0;
+    std::cout << std::setw(12) << it->second << std::setw(9) << std::showpos << change * 100.0 << std::noshowpos << "%"
+              << (regressed ? "  REGRESSION" : "") << std::endl;
+  }
+
+  if (options.counters)
+  {
+    std::cout << std::endl;
+    if (!PerfCounters::instance().countersAvailable())
+      std::cout << "hardware counters are unavailable, e.g. perf_event_paranoid or a container; only wall time is reported" << std::endl;
+    PerfCounters::instance().report(std::cout);
+  }
+
+  if (options.update)
+  {
+    writeBaseline(options.baseline, baseline, results);
+    std::cout << std::endl << "baseline written to " << options.baseline << std::endl;
+    return(0);
+  }
+  if (nregressions)
+  {
+    std::cout << std::endl << nregressions << " case(s) regressed by more than " << options.tolerance * 100.0 << "%" << std::endl;
+    return(1);
+  }
+  std::cout << std::endl << "no regressions" << std::endl;
+  return(0);
+}
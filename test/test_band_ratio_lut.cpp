@@ -0,0 +1,169 @@
+#include <gdal.h>
+#include <string.h>
+#include <vector>
+#include "test_band_ratio_lut.h"
+#include "BandRatioLut.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_band_ratio_lut);
+
+void test_band_ratio_lut::setUp (void)
+{}
+
+void test_band_ratio_lut::tearDown (void)
+{}
+
+/** Fills bands 3 and 4 of a 256x256 buffer with every pair of byte values */
+static void allPairs(DataBuffer<unsigned char>& data)
+{
+  for (int nir=0; nir<256; nir++)
+  {
+    for (int red=0; red<256; red++)
+    {
+      data.band(3)(nir, red) = (unsigned char)nir;
+      data.band(2)(nir, red) = (unsigned char)red;
+    }
+  }
+}
+
+void test_band_ratio_lut::runTest1(void) 
+{
+  try
+  {
+    //every byte pair, through the float kernel and the quantizing kernels
+    RasterDims rd(0, 255, 0, 255);
+    DataBuffer<unsigned char> inputdata(rd, 4);
+    allPairs(inputdata);
+
+    BandRatioLut lut;
+    lut.build<unsigned char, float>(8, Ndvi::Value<unsigned char>());
+    DataBuffer<float> reference(rd, 1), lookup(rd, 1);
+    Ndvi::processchunk(inputdata, reference);
+    if (!Ndvi::processchunk(inputdata, lookup, lut) ||
+        memcmp(reference.data(), lookup.data(), sizeof(float) * 256 * 256) != 0)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest1: float lookup differs from the arithmetic kernel");
+
+    Quantizer quantizer = Quantizer::unitRange(GDT_Int16);
+    lut.build<unsigned char, short>(8, Ndvi::QuantizedValue<unsigned char, short>(quantizer, true, 0.0));
+    DataBuffer<short> qreference(rd, 1), qlookup(rd, 1);
+    Ndvi::processchunk(inputdata, qreference, quantizer, true, 0.0);
+    if (!Ndvi::processchunk(inputdata, qlookup, lut) ||
+        memcmp(qreference.data(), qlookup.data(), sizeof(short) * 256 * 256) != 0)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest1: quantized lookup differs from the arithmetic kernel");
+
+    //a table is only applied to the output type it was built for
+    if (Ndvi::processchunk(inputdata, lookup, lut))
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest1: table applied to the wrong output type");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_band_ratio_lut::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_band_ratio_lut::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_band_ratio_lut::runTest2(void) 
+{
+  try
+  {
+    //11 bit data stored as UInt16
+    RasterDims rd(0, 511, 0, 511);
+    DataBuffer<unsigned short> inputdata(rd, 4);
+    unsigned int seed = 12345;
+    for (int band=2; band<4; band++)
+    {
+      RowView<unsigned short> values = inputdata.band(band).flat();
+      for (long long idx=0; idx<values.size(); idx++)
+      {
+        seed = seed * 1103515245u + 12345u;
+        values[idx] = (unsigned short)((seed >> 8) & 0x7ff);
+      }
+    }
+
+    Quantizer quantizer = Quantizer::unitRange(GDT_UInt16);
+    BandRatioLut lut;
+    lut.build<unsigned short, unsigned short>(11, Ndvi::QuantizedValue<unsigned short, unsigned short>(quantizer, false, 0.0));
+    if (lut.bits() != 11 || lut.nbytes() != 2048 * 2048 * sizeof(unsigned short))
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest2: table has the wrong size");
+
+    DataBuffer<unsigned short> reference(rd, 1), lookup(rd, 1);
+    Ndvi::processchunk(inputdata, reference, quantizer);
+    if (!Ndvi::processchunk(inputdata, lookup, lut) ||
+        memcmp(reference.data(), lookup.data(), sizeof(unsigned short) * 512 * 512) != 0)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest2: 11 bit lookup differs from the arithmetic kernel");
+
+    //a value beyond the declared bit depth falls back to arithmetic
+    inputdata.band(3)(100, 100) = 2048;
+    lookup[0] = 7;
+    if (Ndvi::processchunk(inputdata, lookup, lut) || lookup[0] != 7)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest2: out of range value was not rejected");
+
+    bool threw = false;
+    try { lut.build<unsigned short, float>(12, Ndvi::Value<unsigned short>()); } catch (Exception&) { threw = true; }
+    if (!threw)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest2: table beyond the maximum bit depth was built");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_band_ratio_lut::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_band_ratio_lut::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_band_ratio_lut::runTest3(void) 
+{
+  try
+  {
+    RasterDims rd(0, 255, 0, 255);
+    DataBuffer<unsigned char> inputdata(rd, 4);
+    allPairs(inputdata);
+    DataBuffer<float> reference(rd, 1);
+    Ndvi::processchunk(inputdata, reference);
+
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    {
+      DataRaster byteraster;
+      byteraster.create("byte_input.tif", rd, 4, GDT_Byte, "GTiff", &msraster);
+      for (int band=0; band<4; band++)
+        byteraster.setData(inputdata, rd, band+1, byteraster.dataType(), band);
+    }
+
+    //the declared bit depth of 11 bit data
+    {
+      DataRaster nbitsraster;
+      std::vector<std::string> options(1, std::string("NBITS=11"));
+      nbitsraster.create("nbits_input.tif", rd, 1, GDT_UInt16, "GTiff", &msraster, options);
+    }
+    DataRaster nbitsraster;
+    nbitsraster.open(std::string("nbits_input.tif"), GA_ReadOnly);
+    if (nbitsraster.bitDepth(1) != 11 || msraster.bitDepth(1) != 16)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest3: bit depth is incorrect");
+
+    //Ndvi selects the table for byte input and produces the same output
+    {
+      Ndvi ndvicalc(std::string("byte_input.tif"), std::string("ndvi_byte.tif"));
+      ndvicalc.run();
+    }
+    DataRaster output;
+    output.open(std::string("ndvi_byte.tif"), GA_ReadOnly);
+    DataBuffer<float> outputdata(rd, 1);
+    output.getData(outputdata, 1, output.dataType(), 0);
+    if (memcmp(reference.data(), outputdata.data(), sizeof(float) * 256 * 256) != 0)
+      CPPUNIT_FAIL("test_band_ratio_lut::runTest3: Ndvi output differs from the arithmetic kernel");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_band_ratio_lut::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_band_ratio_lut::runTest3 completed successfully" << std::endl << std::endl;
+}
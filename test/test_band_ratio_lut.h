@@ -0,0 +1,29 @@
+#ifndef _TESTBANDRATIOLUTH_
+#define _TESTBANDRATIOLUTH_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class test_band_ratio_lut : public CPPUNIT_NS::TestFixture
+{
+  CPPUNIT_TEST_SUITE (test_band_ratio_lut);
+  CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST_SUITE_END ();
+
+public:
+
+  void setUp (void);
+  void tearDown (void);
+
+protected:
+
+  void runTest1(void);
+  void runTest2(void);
+  void runTest3(void);
+
+private:
+
+};
+#endif
@@ -0,0 +1,139 @@
+#include <gdal.h>
+#include <math.h>
+#include <vector>
+#include "test_change_detection.h"
+#include "ChangeDetection.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_change_detection);
+
+void test_change_detection::setUp (void)
+{}
+
+void test_change_detection::tearDown (void)
+{}
+
+/** Returns the synthetic NDVI of a global pixel on one of two dates */
+static float ndviAt(int sample, int line, int date)
+{
+  float value = 0.3f + 0.2f * (float)sin(sample * 0.09 + line * 0.05);
+  if (date == 1 && sample >= 40 && sample < 70 && line >= 30 && line < 60)
+    value -= 0.35f;  //a cleared field
+  if ((sample * 31 + line * 17 + date) % 101 == 0)
+    value = -9999.0f;
+  return(value);
+}
+
+/** Writes one date on a 30m grid whose origin is at the given global pixel */
+static void makeDate(const std::string& filename, int date, int originSample, int originLine, int ns, int nl)
+{
+  RasterDims rd(0, ns - 1, 0, nl - 1);
+  DataBuffer<float> data(rd, 1);
+  for (int line=0; line<nl; line++)
+  {
+    for (int sample=0; sample<ns; sample++)
+      data.band(0)(line, sample) = ndviAt(originSample + sample, originLine + line, date);
+  }
+  double gt[6] = { 500000.0 + originSample * 30.0, 30.0, 0.0, 4000000.0 - originLine * 30.0, 0.0, -30.0 };
+  DataRaster raster;
+  raster.create(filename, rd, 1, GDT_Float32, "GTiff");
+  raster.setGeoTransform(gt);
+  raster.setNoDataValue(-9999.0);
+  raster.setData(data, rd, 1, GDT_Float32, 0);
+}
+
+/** Runs a comparison of two dates offset by (10, 5) pixels and checks it pixel by pixel */
+static void checkChange(ChangeMethod method, float threshold, const char* test)
+{
+  makeDate("change_before.tif", 0, 0, 0, 130, 110);
+  makeDate("change_after.tif", 1, 10, 5, 130, 110);
+  DataRaster before, after;
+  before.open(std::string("change_before.tif"), GA_ReadOnly);
+  after.open(std::string("change_after.tif"), GA_ReadOnly);
+
+  ChangeDetection detection(before, after, method, threshold);
+  RasterDims outdims = detection.outputDims();
+  DataRaster change, mask;
+  change.create("change_value.tif", outdims, 1, GDT_Float32, "GTiff");
+  mask.create("change_mask.tif", outdims, 1, GDT_Byte, "GTiff");
+  detection.run(&change, &mask, 120 * 4 * 8, 3);
+
+  DataBuffer<float> changedata(outdims, 1);
+  DataBuffer<unsigned char> maskdata(outdims, 1);
+  change.getData(changedata, 1, GDT_Float32, 0);
+  mask.getData(maskdata, 1, GDT_Byte, 0);
+
+  long long nchanged = 0, nvalid = 0;
+  for (int line=0; line<outdims.height(); line++)
+  {
+    for (int sample=0; sample<outdims.width(); sample++)
+    {
+      float b = ndviAt(sample + 10, line + 5, 0), a = ndviAt(sample + 10, line + 5, 1);
+      unsigned char expectedMask = 255;
+      if (b != -9999.0f && a != -9999.0f)
+      {
+        float value = (method == ChangeRatio) ? a / b : a - b;
+        bool changed = (method == ChangeRatio) ? (value > threshold || value < 1.0f / threshold) : (fabs(value) > threshold);
+        expectedMask = changed ? 1 : 0;
+        nchanged += changed ? 1 : 0;
+        nvalid++;
+        if (changedata.band(0)(line, sample) != value)
+          CPPUNIT_FAIL((std::string(test) + ": change value is incorrect").c_str());
+      }
+      else if (changedata.band(0)(line, sample) == changedata.band(0)(line, sample))
+        CPPUNIT_FAIL((std::string(test) + ": invalid pixel is not NaN").c_str());
+      if (maskdata.band(0)(line, sample) != expectedMask)
+        CPPUNIT_FAIL((std::string(test) + ": change mask is incorrect").c_str());
+    }
+  }
+  if (detection.nchanged() != nchanged || detection.nvalid() != nvalid || nchanged < 800)
+    CPPUNIT_FAIL((std::string(test) + ": changed pixel count is incorrect").c_str());
+}
+
+void test_change_detection::runTest1(void) 
+{
+  try
+  {
+    //NDVI difference of two dates with different extents on one grid
+    checkChange(ChangeDifference, 0.2f, "test_change_detection::runTest1");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_change_detection::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_change_detection::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_change_detection::runTest2(void) 
+{
+  try
+  {
+    //NDVI ratio of the same dates, and a ratio threshold that cannot separate change
+    checkChange(ChangeRatio, 1.5f, "test_change_detection::runTest2");
+
+    DataRaster before, after;
+    before.open(std::string("change_before.tif"), GA_ReadOnly);
+    after.open(std::string("change_after.tif"), GA_ReadOnly);
+    bool thrown = false;
+    try
+    {
+      ChangeDetection detection(before, after, ChangeRatio, 0.5f);
+    }
+    catch (Exception& e)
+    {
+      thrown = true;
+    }
+    if (!thrown)
+      CPPUNIT_FAIL("test_change_detection::runTest2: a ratio threshold below 1 was accepted");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_change_detection::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_change_detection::runTest2 completed successfully" << std::endl << std::endl;
+}
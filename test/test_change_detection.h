@@ -0,0 +1,27 @@
+#ifndef _TESTCHANGEDETECTIONH_
+#define _TESTCHANGEDETECTIONH_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class test_change_detection : public CPPUNIT_NS::TestFixture
+{
+  CPPUNIT_TEST_SUITE (test_change_detection);
+  CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST_SUITE_END ();
+
+public:
+
+  void setUp (void);
+  void tearDown (void);
+
+protected:
+
+  void runTest1(void);
+  void runTest2(void);
+
+private:
+
+};
+#endif
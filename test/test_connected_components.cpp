@@ -0,0 +1,174 @@
+#include <gdal.h>
+#include <vector>
+#include "test_connected_components.h"
+#include "ConnectedComponents.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_connected_components);
+
+void test_connected_components::setUp (void)
+{}
+
+void test_connected_components::tearDown (void)
+{}
+
+/** Writes a mask of blobs, rings and diagonal lines that cross many chunk seams */
+static void makeMask(std::vector<unsigned char>& mask, int ns, int nl)
+{
+  mask.assign(ns * nl, 0);
+  for (int line=0; line<nl; line++)
+  {
+    for (int sample=0; sample<ns; sample++)
+    {
+      int dx = sample % 23 - 11, dy = line % 19 - 9;
+      bool blob = (dx * dx + dy * dy < 40) && ((sample / 23 + line / 19) % 3 != 0);
+      bool ring = (dx * dx + dy * dy >= 64 && dx * dx + dy * dy < 81);
+      bool diagonal = (sample == line || sample == ns - 1 - line / 2);
+      bool speckle = ((line * 7919 + sample * 104729) % 31 == 0);
+      mask[line * ns + sample] = (blob || ring || diagonal || speckle) ? 1 : 0;
+    }
+  }
+
+  RasterDims rd(0, ns - 1, 0, nl - 1);
+  DataBuffer<unsigned char> data(rd, 1);
+  for (int idx=0; idx<ns * nl; idx++)
+    data[idx] = mask[idx];
+  DataRaster raster;
+  raster.create("cc_mask.tif", rd, 1, GDT_Byte, "GTiff");
+  raster.setData(data, rd, 1, GDT_Byte, 0);
+}
+
+/** Labels a mask by flood fill, numbering components in the order their first pixel is met */
+static int floodLabel(const std::vector<unsigned char>& mask, int ns, int nl, int connectivity, std::vector<unsigned int>& labels,
+  std::vector<ComponentStats>& stats)
+{
+  labels.assign(ns * nl, 0u);
+  stats.clear();
+  std::vector<int> stack;
+  for (int start=0; start<ns * nl; start++)
+  {
+    if (!mask[start] || labels[start])
+      continue;
+    ComponentStats component = { (unsigned int)stats.size() + 1u, 0, ns, -1, nl, -1 };
+    labels[start] = component.label;
+    stack.push_back(start);
+    while (!stack.empty())
+    {
+      int idx = stack.back();
+      stack.pop_back();
+      int line = idx / ns, sample = idx % ns;
+      component.area++;
+      component.startSample = (sample < component.startSample) ? sample : component.startSample;
+      component.endSample = (sample > component.endSample) ? sample : component.endSample;
+      component.startLine = (line < component.startLine) ? line : component.startLine;
+      component.endLine = (line > component.endLine) ? line : component.endLine;
+      for (int dy=-1; dy<=1; dy++)
+      {
+        for (int dx=-1; dx<=1; dx++)
+        {
+          if ((dx == 0 && dy == 0) || (connectivity == 4 && dx != 0 && dy != 0))
+            continue;
+          int y = line + dy, x = sample + dx;
+          if (y < 0 || y >= nl || x < 0 || x >= ns || !mask[y * ns + x] || labels[y * ns + x])
+            continue;
+          labels[y * ns + x] = component.label;
+          stack.push_back(y * ns + x);
+        }
+      }
+    }
+    stats.push_back(component);
+  }
+  return((int)stats.size());
+}
+
+/** Runs the labeling and compares the label raster and statistics with flood fill */
+static void checkComponents(Connectivity connectivity, int nthreads, const char* test)
+{
+  int ns = 157, nl = 131;
+  std::vector<unsigned char> mask;
+  makeMask(mask, ns, nl);
+  std::vector<unsigned int> expected;
+  std::vector<ComponentStats> expectedStats;
+  floodLabel(mask, ns, nl, (int)connectivity, expected, expectedStats);
+
+  DataRaster input, output;
+  input.open(std::string("cc_mask.tif"), GA_ReadOnly);
+  output.create("cc_labels.tif", input.dims(), 1, GDT_UInt32, "GTiff");
+  ConnectedComponents components(input, connectivity);
+  components.run(&output, ns * 4 * 5, nthreads);  //five lines per chunk
+  output.close();
+
+  std::ostringstream ostr;
+  ostr << test << ": ";
+  if (components.ncomponents() != (int)expectedStats.size())
+  {
+    ostr << "found " << components.ncomponents() << " components, expected " << expectedStats.size();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  for (size_t idx=0; idx<expectedStats.size(); idx++)
+  {
+    const ComponentStats& found = components.components()[idx];
+    const ComponentStats& want = expectedStats[idx];
+    if (found.label != want.label || found.area != want.area || found.startSample != want.startSample ||
+        found.endSample != want.endSample || found.startLine != want.startLine || found.endLine != want.endLine)
+    {
+      ostr << "statistics of component " << want.label << " are incorrect";
+      CPPUNIT_FAIL(ostr.str().c_str());
+    }
+  }
+
+  DataRaster labels;
+  labels.open(std::string("cc_labels.tif"), GA_ReadOnly);
+  DataBuffer<unsigned int> data(labels.dims(), 1);
+  labels.getData(data, 1, GDT_UInt32, 0);
+  for (int idx=0; idx<ns * nl; idx++)
+  {
+    if (data[idx] != expected[idx])
+    {
+      ostr << "label of pixel " << idx << " is " << data[idx] << ", expected " << expected[idx];
+      CPPUNIT_FAIL(ostr.str().c_str());
+    }
+  }
+}
+
+void test_connected_components::runTest1(void) 
+{
+  try
+  {
+    //8 connectivity, serial and with chunks labeled in parallel
+    checkComponents(Connectivity8, 1, "test_connected_components::runTest1");
+    checkComponents(Connectivity8, 4, "test_connected_components::runTest1");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_connected_components::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_connected_components::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_connected_components::runTest2(void) 
+{
+  try
+  {
+    //4 connectivity splits the diagonal lines into single pixels
+    checkComponents(Connectivity4, 3, "test_connected_components::runTest2");
+
+    DataRaster input;
+    input.open(std::string("cc_mask.tif"), GA_ReadOnly);
+    ConnectedComponents four(input, Connectivity4), eight(input, Connectivity8);
+    four.run(NULL, 157 * 4 * 5, 2);
+    eight.run(NULL, 157 * 4 * 5, 2);
+    if (four.ncomponents() <= eight.ncomponents())
+      CPPUNIT_FAIL("test_connected_components::runTest2: 4 connectivity should find more components than 8 connectivity");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_connected_components::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_connected_components::runTest2 completed successfully" << std::endl << std::endl;
+}
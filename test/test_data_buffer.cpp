@@ -1,3 +1,4 @@
+#include <vector>
 #include "test_data_buffer.h"
 #include "DataBuffer.h"
 
@@ -97,5 +98,140 @@ void test_data_buffer::runTest3(void)
   std::cout << std::endl << "test_data_buffer::runTest3 completed successfully" << std::endl << std::endl;
 }
 
+void test_data_buffer::runTest4(void) 
+{
+  try
+  {
+    RasterDims rd(100, 109, 200, 207);
+    DataBuffer<short> db(rd, 2, true);
+    for (long long idx=0; idx<10*8*2; idx++)
+      db[idx] = (short)idx;
+
+    //band and row views
+    DataView<short> band1 = db.band(1);
+    if (band1.width() != 10 || band1.height() != 8 || band1(3, 4) != 80 + 34 || !band1.contiguous())
+      CPPUNIT_FAIL("test_data_buffer::runTest4: band view is incorrect");
+    RowView<short> row = db.row(0, 5);
+    short expected = 50;
+    for (RowView<short>::iterator it=row.begin(); it!=row.end(); ++it, ++expected)
+    {
+      if (*it != expected)
+        CPPUNIT_FAIL("test_data_buffer::runTest4: row view is incorrect");
+    }
+
+    //a window, in image coordinates, and a window of the window
+    DataView<short> window = db.window(0, RasterDims(102, 105, 203, 206));
+    if (window.width() != 4 || window.height() != 4 || window.stride() != 10 || window.contiguous() ||
+        window(0, 0) != 32 || window(3, 3) != 65)
+      CPPUNIT_FAIL("test_data_buffer::runTest4: window view is incorrect");
+    window.window(1, 1, 2, 2)(1, 1) = -1;
+    if (db[54] != -1)
+      CPPUNIT_FAIL("test_data_buffer::runTest4: write through nested window failed");
+
+    //windows outside the buffer are rejected
+    bool threw = false;
+    try { db.window(0, RasterDims(105, 110, 200, 201)); } catch (Exception&) { threw = true; }
+    if (!threw)
+      CPPUNIT_FAIL("test_data_buffer::runTest4: window outside the buffer was accepted");
+
+#ifndef NDEBUG
+    threw = false;
+    try { row[10] = 0; } catch (Exception&) { threw = true; }
+    if (!threw)
+      CPPUNIT_FAIL("test_data_buffer::runTest4: out of bounds access was not checked in a debug build");
+#endif
+
+    //a 64 bit index is not truncated onto a valid element
+    threw = false;
+    try { db[4294967301LL] = 0; } catch (Exception&) { threw = true; }
+    if (!threw || db[5] != 5)
+      CPPUNIT_FAIL("test_data_buffer::runTest4: 64 bit index was truncated");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in runTest4: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_data_buffer::runTest4 completed successfully" << std::endl << std::endl;
+}
+
+static int deleterCalls = 0;
+
+static void countingDeleter(float* data, void* context)
+{
+  deleterCalls += (context == (void*)&deleterCalls) ? 1 : 0;
+  delete[](data);
+}
 
+static DataBuffer<float> makeTile(const RasterDims& rd, float val)
+{
+  DataBuffer<float> tile(rd, 2, false);
+  for (long long idx=0; idx<rd.width()*rd.height()*2; idx++)
+    tile[idx] = val;
+  return(tile);
+}
+
+void test_data_buffer::runTest5(void) 
+{
+  try
+  {
+    RasterDims rd(0, 9, 0, 4);
+
+    //moves hand over the memory without copying it
+    DataBuffer<float> tile = makeTile(rd, 3.0f);
+    const float* mem = tile.data();
+    DataBuffer<float> moved(std::move(tile));
+    if (moved.data() != mem || tile.data() != NULL || tile.nbands() != 0 || moved[99] != 3.0f)
+      CPPUNIT_FAIL("test_data_buffer::runTest5: move construction failed");
+    DataBuffer<float> assigned = makeTile(rd, 1.0f);
+    assigned = std::move(moved);
+    if (assigned.data() != mem || moved.data() != NULL)
+      CPPUNIT_FAIL("test_data_buffer::runTest5: move assignment failed");
+
+    //buffers can be queued between stages
+    std::vector<DataBuffer<float> > queue;
+    for (int idx=0; idx<8; idx++)
+      queue.push_back(makeTile(rd, (float)idx));
+    if (queue[7][0] != 7.0f || queue[0][99] != 0.0f)
+      CPPUNIT_FAIL("test_data_buffer::runTest5: queued buffers are incorrect");
+
+    //clone is a deep copy
+    DataBuffer<float> copy;
+    assigned.clone(copy);
+    copy[0] = -1.0f;
+    if (copy.data() == assigned.data() || assigned[0] != 3.0f || copy[1] != 3.0f || !copy.ownsData())
+      CPPUNIT_FAIL("test_data_buffer::runTest5: clone failed");
+
+    //adopted memory is released with its deleter, exactly once
+    deleterCalls = 0;
+    {
+      DataBuffer<float> adopted(new float[50], rd, 1, countingDeleter, (void*)&deleterCalls);
+      DataBuffer<float> owner(std::move(adopted));
+      if (!owner.ownsData() || owner.width() != 10 || owner.height() != 5)
+        CPPUNIT_FAIL("test_data_buffer::runTest5: adopted buffer is incorrect");
+    }
+    if (deleterCalls != 1)
+      CPPUNIT_FAIL("test_data_buffer::runTest5: deleter was not called exactly once");
 
+    //wrapped memory is left alone
+    std::vector<float> external(100, 2.0f);
+    {
+      DataBuffer<float> wrapped(&external[0], rd, 2);
+      wrapped[10] = 5.0f;
+      if (wrapped.ownsData() || wrapped.band(1)(0, 0) != 2.0f)
+        CPPUNIT_FAIL("test_data_buffer::runTest5: wrapped buffer is incorrect");
+    }
+    if (external[10] != 5.0f)
+      CPPUNIT_FAIL("test_data_buffer::runTest5: write through wrapped buffer failed");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in runTest5: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_data_buffer::runTest5 completed successfully" << std::endl << std::endl;
+}
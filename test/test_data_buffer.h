@@ -10,6 +10,8 @@ class test_data_buffer : public CPPUNIT_NS::TestFixture
   CPPUNIT_TEST (runTest1);
   CPPUNIT_TEST (runTest2);
   CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST (runTest4);
+  CPPUNIT_TEST (runTest5);
   CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -22,6 +24,8 @@ protected:
   void runTest1(void);
   void runTest2(void);
   void runTest3(void);
+  void runTest4(void);
+  void runTest5(void);
 
 private:
 
@@ -1,12 +1,21 @@
 #include <gdal.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <vector>
 #include "test_data_raster.h"
 #include "RasterDims.h"
 #include "DataRaster.h"
 #include "DataBuffer.h"
+#include "DataRasterIterator.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION (test_data_raster);
 
+/** Unmaps a sparse mapping adopted by a DataBuffer.  context points to the size of the mapping. */
+static void unmapSparse(unsigned char* data, void* context)
+{
+  munmap(data, *(size_t*)context);
+}
+
 void test_data_raster::setUp (void)
 {}
 
@@ -154,3 +163,392 @@ void test_data_raster::runTest3(void)
   std::cout << std::endl << "test_data_raster::runTest3 completed successfully" << std::endl << std::endl;
 }
 
+void test_data_raster::runTest4(void)
+{
+  try
+  {
+    //a tiled raster with 16 line blocks
+    RasterDims rd(0, 299, 0, 249);
+    DataBuffer<unsigned short> data(rd, 2);
+    for (long long idx=0; idx<300*250*2; idx++)
+      data[idx] = (unsigned short)((idx * 7919) % 65521);
+    {
+      DataRaster dr;
+      std::vector<std::string> options;
+      options.push_back("TILED=YES");
+      options.push_back("BLOCKXSIZE=64");
+      options.push_back("BLOCKYSIZE=16");
+      options.push_back("COMPRESS=DEFLATE");
+      dr.create("tiled_input.tif", rd, 2, GDT_UInt16, "GTiff", NULL, options);
+      for (int band=0; band<2; band++)
+        dr.setData(data, rd, band+1, GDT_UInt16, band);
+    }
+
+    DataRaster dr;
+    dr.open(std::string("tiled_input.tif"), GA_ReadOnly);
+    dr.setDecodeThreads(4);
+    if (dr.decodeThreads() != 4 || dr.nsamples() != 300)
+      CPPUNIT_FAIL("test_data_raster::runTest4: raster was not reopened for parallel decoding");
+
+    //the whole raster, and a window that does not start or end on a block boundary
+    DataBuffer<unsigned short> whole(rd, 2);
+    for (int band=0; band<2; band++)
+      dr.getData(whole, band+1, GDT_UInt16, band);
+    if (memcmp(whole.data(), data.data(), sizeof(unsigned short) * 300 * 250 * 2) != 0)
+      CPPUNIT_FAIL("test_data_raster::runTest4: parallel read of the whole raster is incorrect");
+
+    RasterDims window(17, 210, 5, 203);
+    DataBuffer<unsigned short> part(window, 1);
+    dr.getData(part, 2, GDT_UInt16, 0);
+    for (int line=window.startLine(); line<=window.endLine(); line++)
+    {
+      for (int sample=window.startSample(); sample<=window.endSample(); sample++)
+      {
+        if (part.band(0)(line - 5, sample - 17) != data.band(1)(line, sample))
+          CPPUNIT_FAIL("test_data_raster::runTest4: parallel read of a window is incorrect");
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster::runTest4: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster::runTest4 completed successfully" << std::endl << std::endl;
+}
+
+void test_data_raster::runTest5(void)
+{
+  try
+  {
+    RasterDims rd(0, 119, 0, 79);
+    DataBuffer<short> data(rd, 3);
+    for (long long idx=0; idx<120*80*3; idx++)
+      data[idx] = (short)((idx * 31) % 4099 - 2000);
+
+    //an in memory raster behaves like a file, and windows are copied directly
+    DataRaster mem;
+    mem.create("", rd, 3, GDT_Int16, "MEM");
+    if (!mem.inMemory() || mem.nbands() != 3 || mem.nsamples() != 120 || mem.nlines() != 80)
+      CPPUNIT_FAIL("test_data_raster::runTest5: in memory raster has the wrong dimensions");
+    for (int band=0; band<3; band++)
+      mem.setData(data, rd, band+1, GDT_Int16, band);
+    RasterDims window(13, 101, 7, 64);
+    DataBuffer<short> part(window, 1);
+    mem.getData(part, 3, GDT_Int16, 0);
+    DataBuffer<double> converted(window, 1);
+    mem.getData(converted, 3, GDT_Float64, 0);
+    for (int line=window.startLine(); line<=window.endLine(); line++)
+    {
+      for (int sample=window.startSample(); sample<=window.endSample(); sample++)
+      {
+        short expected = data.band(2)(line, sample);
+        if (part.band(0)(line - 7, sample - 13) != expected || converted.band(0)(line - 7, sample - 13) != (double)expected)
+          CPPUNIT_FAIL("test_data_raster::runTest5: window of an in memory raster is incorrect");
+      }
+    }
+    if (mem.view<short>(2)(40, 50) != data.band(1)(40, 50))
+      CPPUNIT_FAIL("test_data_raster::runTest5: view of an in memory raster is incorrect");
+
+    //a wrapped buffer shares its memory with the raster
+    DataRaster wrapped;
+    wrapped.wrap(data, GDT_Int16);
+    wrapped.setNoDataValue(-9999, 1);
+    DataBuffer<short> patch(RasterDims(10, 19, 20, 29), 1);
+    for (int idx=0; idx<100; idx++)
+      patch[idx] = 1234;
+    wrapped.setData(patch, patch.dims(), 1, GDT_Int16, 0);
+    if (data.band(0)(25, 15) != 1234 || wrapped.view<short>(1).data() != data.data())
+      CPPUNIT_FAIL("test_data_raster::runTest5: write to a wrapped buffer was not seen in the buffer");
+    data.band(0)(0, 0) = 4321;
+    DataBuffer<short> corner(RasterDims(0, 0, 0, 0), 1);
+    wrapped.getData(corner, 1, GDT_Int16, 0);
+    if (corner[0] != 4321)
+      CPPUNIT_FAIL("test_data_raster::runTest5: change to a wrapped buffer was not seen in the raster");
+
+    bool failed = false;
+    try
+    {
+      wrapped.view<float>(1);
+    }
+    catch (Exception&)
+    {
+      failed = true;
+    }
+    if (!failed)
+      CPPUNIT_FAIL("test_data_raster::runTest5: view with the wrong type did not throw");
+
+    mem.close();
+    if (mem.inMemory() || mem.nbands() != 0)
+      CPPUNIT_FAIL("test_data_raster::runTest5: closed raster is still in memory");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster::runTest5: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster::runTest5 completed successfully" << std::endl << std::endl;
+}
+
+void test_data_raster::runTest6(void)
+{
+  try
+  {
+    RasterDims rd(0, 255, 0, 199);
+    DataBuffer<unsigned short> data(rd, 2);
+    for (long long idx=0; idx<256*200*2; idx++)
+      data[idx] = (unsigned short)((idx * 104729) % 65521);
+    {
+      DataRaster dr;
+      dr.create("shared_input.tif", rd, 2, GDT_UInt16, "GTiff");
+      for (int band=0; band<2; band++)
+        dr.setData(data, rd, band+1, GDT_UInt16, band);
+    }
+
+    //one read only raster and one open for update, each shared by every thread
+    DataRaster readonly, update;
+    readonly.open(std::string("shared_input.tif"), GA_ReadOnly);
+    update.open(std::string("shared_input.tif"), GA_Update);
+    DataRaster* rasters[2] = { &readonly, &update };
+    int nfailed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(8) schedule(dynamic) reduction(+:nfailed)
+#endif
+    for (int job=0; job<64; job++)
+    {
+      try
+      {
+        int band = job % 2;
+        RasterDims window(job, job + 100, (job * 3) % 90, (job * 3) % 90 + 109);
+        DataBuffer<unsigned short> part(window, 1);
+        rasters[(job / 2) % 2]->getData(part, band + 1, GDT_UInt16, 0);
+        double scale, offset;
+        rasters[(job / 2) % 2]->getScaleOffset(scale, offset, band + 1);
+        for (int line=window.startLine(); line<=window.endLine(); line++)
+        {
+          for (int sample=window.startSample(); sample<=window.endSample(); sample++)
+            nfailed += (part.band(0)(line - window.startLine(), sample - window.startSample()) != data.band(band)(line, sample)) ? 1 : 0;
+        }
+      }
+      catch (std::exception&)
+      {
+        nfailed++;
+      }
+    }
+    if (nfailed)
+      CPPUNIT_FAIL("test_data_raster::runTest6: concurrent reads of a shared raster are incorrect");
+
+    //reopening a raster on another file must not leave read handles pooled for the first file
+    {
+      DataRaster dr;
+      dr.create("shared_other.tif", rd, 1, GDT_UInt16, "GTiff");
+      DataBuffer<unsigned short> zeros(rd, 1);
+      dr.setData(zeros, rd, 1, GDT_UInt16, 0);
+    }
+    {
+      //parallel decoding leaves its per-group handles in the pool
+      readonly.setDecodeThreads(4);
+      DataBuffer<unsigned short> whole(rd, 1);
+      readonly.getData(whole, 1, GDT_UInt16, 0);
+    }
+    readonly.open(std::string("shared_other.tif"), GA_ReadOnly);
+    {
+      DataBuffer<unsigned short> whole(rd, 1);
+      readonly.getData(whole, 1, GDT_UInt16, 0);
+      for (long long idx=0; idx<rd.npixels(); idx++)
+        nfailed += (whole[idx] != 0) ? 1 : 0;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(8) schedule(dynamic) reduction(+:nfailed)
+#endif
+    for (int job=0; job<64; job++)
+    {
+      try
+      {
+        RasterDims window(job, job + 100, (job * 3) % 90, (job * 3) % 90 + 109);
+        DataBuffer<unsigned short> part(window, 1);
+        readonly.getData(part, 1, GDT_UInt16, 0);
+        for (long long idx=0; idx<window.npixels(); idx++)
+          nfailed += (part[idx] != 0) ? 1 : 0;
+      }
+      catch (std::exception&)
+      {
+        nfailed++;
+      }
+    }
+    if (nfailed || readonly.nbands() != 1)
+      CPPUNIT_FAIL("test_data_raster::runTest6: reads after a reopen returned the previous file");
+
+    //rasters are constructed from many threads at once
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(8) reduction(+:nfailed)
+#endif
+    for (int job=0; job<16; job++)
+    {
+      DataRaster dr;
+      try
+      {
+        dr.open(std::string("shared_input.tif"), GA_ReadOnly);
+        nfailed += (dr.nbands() != 2 || dr.dataType(2) != GDT_UInt16) ? 1 : 0;
+      }
+      catch (std::exception&)
+      {
+        nfailed++;
+      }
+    }
+    if (nfailed)
+      CPPUNIT_FAIL("test_data_raster::runTest6: concurrent opens failed");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster::runTest6: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster::runTest6 completed successfully" << std::endl << std::endl;
+}
+
+void test_data_raster::runTest7(void)
+{
+  try
+  {
+    //a band of more than 2^31 pixels wrapped around a sparse mapping.  MAP_NORESERVE commits no swap
+    //for it and only the pages that are written become resident, so the test needs a few MB, not 2GB.
+    RasterDims rd(0, 46340, 0, 46340);
+    size_t mapsize = (size_t)rd.npixels();
+    void* mapping = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED)
+      CPPUNIT_FAIL("test_data_raster::runTest7: unable to map the sparse band");
+    DataBuffer<unsigned char> sparse((unsigned char*)mapping, rd, 1, unmapSparse, &mapsize);
+    DataRaster big;
+    big.wrap(sparse, GDT_Byte);
+    if (rd.npixels() <= 2147483647LL || big.dims().npixels() != rd.npixels())
+      CPPUNIT_FAIL("test_data_raster::runTest7: the raster does not exceed 2^31 pixels");
+
+    //a window past the 2^31st pixel, written and read back through DataBuffers
+    RasterDims window(46000, 46340, 46300, 46340);
+    DataBuffer<unsigned char> data(window, 1);
+    for (long long idx=0; idx<window.npixels(); idx++)
+      data[idx] = (unsigned char)(idx % 251 + 1);
+    big.setData(data, window, 1, GDT_Byte, 0);
+
+    DataBuffer<unsigned char> readback(window, 1);
+    big.getData(readback, 1, GDT_Byte, 0);
+    if (memcmp(readback.data(), data.data(), window.npixels()) != 0)
+      CPPUNIT_FAIL("test_data_raster::runTest7: window past 2^31 pixels is incorrect");
+
+    DataView<unsigned char> view = big.view<unsigned char>(1);
+    long long last = (long long)46340 * 46341 + 46340;
+    if (view(46340, 46340) != data[window.npixels() - 1] || view.data()[last] != data[window.npixels() - 1] || view(46299, 46340) != 0)
+      CPPUNIT_FAIL("test_data_raster::runTest7: view past 2^31 pixels is incorrect");
+
+    //a write from a buffer that is larger than the window, so the subrect is copied out
+    DataBuffer<unsigned char> strip(RasterDims(45000, 46340, 46330, 46340), 1);
+    for (long long idx=0; idx<strip.dims().npixels(); idx++)
+      strip[idx] = 7;
+    big.setData(strip, RasterDims(46340, 46340, 46335, 46340), 1, GDT_Byte, 0);
+    if (view(46340, 46340) != 7 || view(46334, 46340) != data.band(0)(34, 340))
+      CPPUNIT_FAIL("test_data_raster::runTest7: subrect write past 2^31 pixels is incorrect");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster::runTest7: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster::runTest7 completed successfully" << std::endl << std::endl;
+}
+
+void test_data_raster::runTest8(void)
+{
+  try
+  {
+    //4x4 pixel blocks of constant value, so every resampling reduces a block to its value
+    RasterDims rd(0, 399, 0, 299);
+    DataBuffer<unsigned short> data(rd, 1);
+    for (int line=0; line<rd.height(); line++)
+      for (int sample=0; sample<rd.width(); sample++)
+        data[(long long)line * rd.width() + sample] = (unsigned short)((sample / 4) + (line / 4) * 100);
+    DataRaster raster;
+    raster.create("preview.tif", rd, 1, GDT_UInt16, "GTiff");
+    raster.setData(data, rd, 1, GDT_UInt16, 0);
+
+    RasterDims preview = raster.previewDims(100);
+    if (!(preview == RasterDims(0, 99, 0, 74)) || !(raster.previewDims(1000) == rd))
+      CPPUNIT_FAIL("test_data_raster::runTest8: previewDims is incorrect");
+
+    GDALRIOResampleAlg resamplings[2] = { GRIORA_NearestNeighbour, GRIORA_Average };
+    for (int idx=0; idx<2; idx++)
+    {
+      DataBuffer<unsigned short> thumbnail(preview, 1);
+      raster.getPreview(thumbnail, preview, 1, GDT_UInt16, resamplings[idx]);
+      for (int line=0; line<preview.height(); line++)
+        for (int sample=0; sample<preview.width(); sample++)
+          if (thumbnail.band(0)(line, sample) != sample + line * 100)
+            CPPUNIT_FAIL("test_data_raster::runTest8: preview is incorrect");
+    }
+
+    //a preview read tile by tile matches the whole preview
+    DataRasterIterator iter(raster, preview, 1000, 0);
+    if (iter.ntiles() < 2 || !iter.preview() || !(iter.previewDims() == preview))
+      CPPUNIT_FAIL("test_data_raster::runTest8: the preview is not tiled");
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims tile;
+      iter.getTileDims(tilenum, tile);
+      DataBuffer<unsigned short> tiledata(tile, 1);
+      raster.getPreview(tiledata, preview, 1, GDT_UInt16);
+      if (tiledata.band(0)(0, 0) != tile.startLine() * 100 || tiledata.band(0)(tile.height() - 1, 99) != 99 + tile.endLine() * 100)
+        CPPUNIT_FAIL("test_data_raster::runTest8: preview tile is incorrect");
+    }
+    if (!(raster.previewSourceDims(RasterDims(10, 19, 5, 9), preview) == RasterDims(40, 79, 20, 39)))
+      CPPUNIT_FAIL("test_data_raster::runTest8: previewSourceDims is incorrect");
+
+    //once overviews exist the preview is read from them.  Later writes do not update them.
+    std::vector<int> factors(1, 2);
+    factors.push_back(4);
+    raster.buildOverviews(factors);
+    if (raster.overviewCount(1) != 2)
+      CPPUNIT_FAIL("test_data_raster::runTest8: overviews were not built");
+    DataBuffer<unsigned short> blank(rd, 1);
+    raster.setData(blank, rd, 1, GDT_UInt16, 0);
+    DataBuffer<unsigned short> thumbnail(preview, 1);
+    raster.getPreview(thumbnail, preview, 1, GDT_UInt16);
+    if (thumbnail.band(0)(74, 99) != 99 + 74 * 100)
+      CPPUNIT_FAIL("test_data_raster::runTest8: preview was not read from the overview");
+    DataBuffer<unsigned short> full(RasterDims(0, 1, 0, 1), 1);
+    raster.getPreview(full, rd, 1, GDT_UInt16);
+    if (full[0] != 0)
+      CPPUNIT_FAIL("test_data_raster::runTest8: full resolution preview is incorrect");
+
+    bool failed = false;
+    try
+    {
+      DataBuffer<unsigned short> outside(RasterDims(0, 9, 70, 79), 1);
+      raster.getPreview(outside, preview, 1, GDT_UInt16);
+    }
+    catch (Exception&)
+    {
+      failed = true;
+    }
+    if (!failed)
+      CPPUNIT_FAIL("test_data_raster::runTest8: a buffer outside the preview was accepted");
+
+    raster.close();
+    remove("preview.tif");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster::runTest8: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster::runTest8 completed successfully" << std::endl << std::endl;
+}
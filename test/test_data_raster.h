@@ -12,6 +12,11 @@ class test_data_raster : public CPPUNIT_NS::TestFixture
   CPPUNIT_TEST (runTest1);
   CPPUNIT_TEST (runTest2);
   CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST (runTest4);
+  CPPUNIT_TEST (runTest5);
+  CPPUNIT_TEST (runTest6);
+  CPPUNIT_TEST (runTest7);
+  CPPUNIT_TEST (runTest8);
   CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -24,6 +29,11 @@ protected:
   void runTest1(void);
   void runTest2(void);
   void runTest3(void);
+  void runTest4(void);
+  void runTest5(void);
+  void runTest6(void);
+  void runTest7(void);
+  void runTest8(void);
   template <typename T> void computeMean(DataBuffer<T>& buf, std::vector<double>& meanvals);
 
 private:
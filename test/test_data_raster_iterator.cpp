@@ -5,6 +5,7 @@
 #include "DataRaster.h"
 #include "DataRasterIterator.h"
 #include "DataBuffer.h"
+#include "Pipeline.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION (test_data_raster_iterator);
 
@@ -57,3 +58,147 @@ void test_data_raster_iterator::runTest1(void)
   std::cout << std::endl << "test_data_raster_iterator::runTest1 completed successfully" << std::endl << std::endl;
 }
 
+void test_data_raster_iterator::runTest2(void) 
+{
+  try
+  {
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> msdata(msraster.dims(), msraster.nbands());
+    for (int band=0; band<msraster.nbands(); band++)
+      msraster.getData(msdata, band+1, msraster.dataType(), band);
+
+    //a sparse file where only lines 140-259 were ever written
+    DataRaster sparse;
+    std::vector<std::string> options(1, std::string("SPARSE_OK=TRUE"));
+    sparse.create("sparse_input.tif", msraster.dims(), msraster.nbands(), GDT_UInt16, "GTiff", &msraster, options);
+    RasterDims written(0, 399, 140, 259);
+    for (int band=0; band<sparse.nbands(); band++)
+      sparse.setData(msdata, written, band+1, sparse.dataType(), band);
+    sparse.close();
+    sparse.open(std::string("sparse_input.tif"), GA_ReadOnly);
+
+    int memsize = static_cast<int>(0.1 * 1024. * 1024.);
+    DataRasterIterator iter(sparse, memsize, 0);
+    DataCoverage expected[4] = { DataCoverageEmpty, DataCoveragePartial, DataCoverageEmpty, DataCoverageEmpty };
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      DataCoverage coverage = iter.tileCoverage(tilenum);
+      if (coverage != expected[tilenum] && coverage != DataCoverageUnknown)
+      {
+        std::ostringstream ostr;
+        ostr << "Tile " << tilenum << " reported coverage " << coverage << ", expected " << expected[tilenum];
+        CPPUNIT_FAIL(ostr.str().c_str());
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster_iterator::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_data_raster_iterator::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_data_raster_iterator::runTest3(void)
+{
+  try
+  {
+    //a 100k x 100k sparse mosaic, 10 GB if it were written, tiled with multi-GB chunks
+    DataRaster mosaic;
+    std::vector<std::string> options(1, std::string("SPARSE_OK=TRUE"));
+    RasterDims rd(0, 99999, 0, 99999);
+    mosaic.create("large_sparse.tif", rd, 3, GDT_Byte, "GTiff", NULL, options);
+    if (rd.npixels() != 10000000000LL)
+      CPPUNIT_FAIL("test_data_raster_iterator::runTest3: npixels overflowed");
+
+    long long memsize = 3LL * 1024 * 1024 * 1024;
+    DataRasterIterator iter(mosaic, memsize, 0);
+    RasterDims tile, last;
+    iter.getTileDims(0, tile);
+    iter.getTileDims(iter.ntiles() - 1, last);
+    if (iter.ntiles() != 4 || tile.height() != 32213 || last.endLine() != 99999)
+      CPPUNIT_FAIL("test_data_raster_iterator::runTest3: tiles of a multi-GB memsize are incorrect");
+
+    DataRasterIterator bands(mosaic, memsize, 0, TilingModeAllBands);
+    bands.getTileDims(0, tile);
+    if (bands.ntiles() != 10 || tile.height() != 10737 || tile.npixels() * 3 > memsize)
+      CPPUNIT_FAIL("test_data_raster_iterator::runTest3: all band tiles of a multi-GB memsize are incorrect");
+
+    DataRasterIterator whole(mosaic, 1000000000000000LL, 0);
+    whole.getTileDims(0, tile);
+    if (whole.ntiles() != 1 || !(tile == rd))
+      CPPUNIT_FAIL("test_data_raster_iterator::runTest3: a memsize larger than the raster does not give one tile");
+
+    mosaic.close();
+    remove("large_sparse.tif");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster_iterator::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster_iterator::runTest3 completed successfully" << std::endl << std::endl;
+}
+
+void test_data_raster_iterator::runTest4(void)
+{
+  try
+  {
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 3110000
+    //a half precision raster is tiled by its 2 byte pixels and read tile by tile
+    RasterDims rd(0, 299, 0, 199);
+    DataBuffer<float16> values(rd, 1);
+    for (long long idx=0; idx<rd.npixels(); idx++)
+      values[idx] = float16((float)(idx % 1000) * 0.25f);
+    {
+      DataRaster half;
+      half.create("iterator_half.tif", rd, 1, GDT_Float16, "GTiff");
+      half.setData(values, rd, 1, GDT_Float16, 0);
+    }
+
+    DataRaster half;
+    half.open(std::string("iterator_half.tif"), GA_ReadOnly);
+    DataRasterIterator iter(half, 300 * 2 * 50, 0);
+    if (iter.ntiles() != 4)
+      CPPUNIT_FAIL("test_data_raster_iterator::runTest4: half precision tiles are incorrect");
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims tile;
+      iter.getTileDims(tilenum, tile);
+      DataBuffer<float16> data(tile, 1);
+      half.getData(data, 1, GDT_Float16, 0);
+      long long offset = (long long)tile.startLine() * 300;
+      for (long long idx=0; idx<tile.npixels(); idx++)
+      {
+        if (data[idx].bits() != values[offset + idx].bits())
+          CPPUNIT_FAIL("test_data_raster_iterator::runTest4: half precision tile read back incorrectly");
+      }
+    }
+
+    //the tile framework runs over it as well
+    StatisticsOp* stats = new StatisticsOp;
+    Pipeline pipeline(half);
+    pipeline.add(stats);
+    pipeline.run(300 * 4 * 50);
+    if (stats->count() != rd.npixels() || stats->max() != 249.75)
+      CPPUNIT_FAIL("test_data_raster_iterator::runTest4: pipeline over a half precision raster is incorrect");
+    half.close();
+    remove("iterator_half.tif");
+#else
+    std::cout << "GDAL before 3.11 has no Float16 rasters, skipped" << std::endl;
+#endif
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_data_raster_iterator::runTest4: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_data_raster_iterator::runTest4 completed successfully" << std::endl << std::endl;
+}
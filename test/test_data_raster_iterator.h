@@ -10,6 +10,9 @@ class test_data_raster_iterator : public CPPUNIT_NS::TestFixture
 {
   CPPUNIT_TEST_SUITE (test_data_raster_iterator);
   CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST (runTest4);
   CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -20,6 +23,9 @@ public:
 protected:
 
   void runTest1(void);
+  void runTest2(void);
+  void runTest3(void);
+  void runTest4(void);
 
 private:
 
@@ -0,0 +1,104 @@
+#include <gdal.h>
+#include <math.h>
+#include <vector>
+#include "test_float16.h"
+#include "Float16.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_float16);
+
+void test_float16::setUp (void)
+{}
+
+void test_float16::tearDown (void)
+{}
+
+void test_float16::runTest1(void) 
+{
+  try
+  {
+    //every half precision value survives a round trip through float
+    std::vector<float16> halves(65536);
+    std::vector<float> floats(65536);
+    for (int bits=0; bits<65536; bits++)
+      halves[bits] = float16::fromBits((unsigned short)bits);
+    float16::toFloat(&halves[0], &floats[0], 65536);
+    std::vector<float16> back(65536);
+    float16::fromFloat(&floats[0], &back[0], 65536);
+    for (int bits=0; bits<65536; bits++)
+    {
+      bool nan = ((bits & 0x7c00) == 0x7c00) && (bits & 0x3ff);
+      if (nan ? (floats[bits] == floats[bits]) : (back[bits].bits() != bits))
+      {
+        std::ostringstream ostr;
+        ostr << "test_float16::runTest1: round trip failed for bits " << bits;
+        CPPUNIT_FAIL(ostr.str().c_str());
+      }
+      if (!nan && (float)halves[bits] != floats[bits])
+        CPPUNIT_FAIL("test_float16::runTest1: scalar and bulk conversions differ");
+    }
+
+    //rounding to nearest even, overflow and subnormals
+    if (float16(1.0f).bits()        != 0x3c00 ||
+        float16(-2.0f).bits()       != 0xc000 ||
+        float16(65504.0f).bits()    != 0x7bff ||
+        float16(65520.0f).bits()    != 0x7c00 ||
+        float16(1.0f + 1.0f / 2048.0f).bits() != 0x3c00 ||
+        float16(1.0f + 3.0f / 2048.0f).bits() != 0x3c02 ||
+        float16(5.9604645e-8f).bits() != 0x0001 ||
+        float16(1e-9f).bits()        != 0x0000)
+      CPPUNIT_FAIL("test_float16::runTest1: conversion of special values failed");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_float16::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_float16::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_float16::runTest2(void) 
+{
+  try
+  {
+    DataRaster dr;
+    dr.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> inputdata(dr.dims(), dr.nbands());
+    for (int band=0; band<dr.nbands(); band++)
+      dr.getData(inputdata, band+1, dr.dataType(), band);
+    DataBuffer<float> reference(dr.dims(), 1);
+    Ndvi::processchunk(inputdata, reference);
+
+    {
+      Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_half.tif"));
+      ndvicalc.setHalfPrecisionOutput();
+      ndvicalc.run();
+    }
+
+    //read the output back into a half precision buffer
+    DataRaster output;
+    output.open(std::string("ndvi_half.tif"), GA_ReadOnly);
+    DataBuffer<float16> outputdata(output.dims(), 1);
+    output.getData(outputdata, 1, output.dataType(), 0);
+    for (int idx=0; idx<400*400; idx++)
+    {
+      float val = outputdata[idx];
+      if (fabs(val - reference[idx]) > fabs(reference[idx]) / 1024.0f + 1e-7f)
+      {
+        std::ostringstream ostr;
+        ostr << "test_float16::runTest2: half precision value " << val << " differs from " << reference[idx];
+        CPPUNIT_FAIL(ostr.str().c_str());
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_float16::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_float16::runTest2 completed successfully" << std::endl << std::endl;
+}
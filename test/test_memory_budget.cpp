@@ -0,0 +1,393 @@
+#include <gdal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+#include <sstream>
+#include "test_memory_budget.h"
+#include "DataBuffer.h"
+#include "MemoryBudget.h"
+#include "MemoryProfile.h"
+#include "DataRaster.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_memory_budget);
+
+void test_memory_budget::setUp (void)
+{}
+
+void test_memory_budget::tearDown (void)
+{
+  MemoryBudget::instance().setBudget(0);
+  MemoryBudget::instance().setMaxWait(10.0);
+}
+
+void test_memory_budget::runTest1(void) 
+{
+  try
+  {
+    //allocations, moves, clones and releases are accounted for; wrapped memory is not
+    MemoryBudget& budget = MemoryBudget::instance();
+    unsigned long long base = budget.current();
+    budget.resetPeak();
+    RasterDims rd(0, 99, 0, 49);
+    {
+      DataBuffer<float> a(rd, 2);
+      if (budget.current() != base + 100 * 50 * 2 * sizeof(float))
+        CPPUNIT_FAIL("test_memory_budget::runTest1: allocation is not accounted for");
+      DataBuffer<float> moved(std::move(a));
+      {
+        DataBuffer<float> copy;
+        moved.clone(copy);
+        if (budget.current() != base + 2 * 100 * 50 * 2 * sizeof(float))
+          CPPUNIT_FAIL("test_memory_budget::runTest1: clone or move is not accounted for");
+      }
+
+      std::vector<double> external(100 * 50);
+      DataBuffer<double> wrapped(&external[0], rd);
+      if (budget.current() != base + 100 * 50 * 2 * sizeof(float))
+        CPPUNIT_FAIL("test_memory_budget::runTest1: wrapped memory was accounted for");
+    }
+    if (budget.current() != base || budget.peak() != base + 2 * 100 * 50 * 2 * sizeof(float))
+      CPPUNIT_FAIL("test_memory_budget::runTest1: release or peak is incorrect");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_memory_budget::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_memory_budget::runTest2(void) 
+{
+  try
+  {
+    //cold buffers are spilled when an allocation exceeds the budget and read back on use
+    MemoryBudget& budget = MemoryBudget::instance();
+    unsigned long long base = budget.current();
+    long long nspills = budget.nspills();
+    budget.setScratchDirectory(".");
+    budget.setBudget(base + 600 * 1024);
+
+    RasterDims rd(0, 255, 0, 255);
+    DataBuffer<float>* cold = new DataBuffer<float>(rd);
+    DataBuffer<float>* dropped = new DataBuffer<float>(rd);
+    for (long long idx=0; idx<256 * 256; idx++)
+      (*cold)[idx] = (float)idx;
+    if (!cold->setSpillable(true) || !dropped->setSpillable(true))
+      CPPUNIT_FAIL("test_memory_budget::runTest2: buffer could not be marked spillable");
+
+    DataBuffer<float> hot(rd);
+    if (!cold->spilled() || budget.nspills() != nspills + 1 || budget.current() > base + 600 * 1024)
+      CPPUNIT_FAIL("test_memory_budget::runTest2: cold buffer was not spilled");
+    if (dropped->spilled())
+      CPPUNIT_FAIL("test_memory_budget::runTest2: more buffers than needed were spilled");
+
+    //a spilled buffer that is destroyed removes its scratch file, one that is used is read back
+    delete(dropped);
+    DataView<float> view = cold->band(0);
+    if (cold->spilled() || view(255, 255) != 65535.0f || view(1, 2) != 258.0f)
+      CPPUNIT_FAIL("test_memory_budget::runTest2: spilled buffer was not read back");
+    delete(cold);
+    if (budget.current() != base + 256 * 256 * sizeof(float))
+      CPPUNIT_FAIL("test_memory_budget::runTest2: usage is incorrect after spilling");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_memory_budget::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+/** Holds a buffer for a while, then releases it */
+static void* holdBuffer(void* arg)
+{
+  DataBuffer<float>* buffer = static_cast<DataBuffer<float>*>(arg);
+  usleep(100000);
+  delete(buffer);
+  return(NULL);
+}
+
+void test_memory_budget::runTest3(void) 
+{
+  try
+  {
+    //backpressure: waitForRoom blocks until another thread releases memory, or times out
+    MemoryBudget& budget = MemoryBudget::instance();
+    unsigned long long base = budget.current();
+    long long nwaits = budget.nwaits();
+    budget.setBudget(base + 1024 * 1024);
+    RasterDims rd(0, 511, 0, 399);
+
+    DataBuffer<float>* held = new DataBuffer<float>(rd);
+    pthread_t thread;
+    pthread_create(&thread, NULL, holdBuffer, held);
+    if (!budget.waitForRoom(512 * 400 * sizeof(float)) || budget.current() != base)
+      CPPUNIT_FAIL("test_memory_budget::runTest3: waitForRoom returned before memory was released");
+    pthread_join(thread, NULL);
+    if (budget.nwaits() != nwaits + 1)
+      CPPUNIT_FAIL("test_memory_budget::runTest3: wait was not counted");
+
+    DataBuffer<float> kept(rd);
+    budget.setMaxWait(0.05);
+    if (budget.waitForRoom(512 * 400 * sizeof(float)))
+      CPPUNIT_FAIL("test_memory_budget::runTest3: waitForRoom did not time out");
+    if (!budget.waitForRoom(1024))
+      CPPUNIT_FAIL("test_memory_budget::runTest3: a small allocation had to wait");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_memory_budget::runTest3 completed successfully" << std::endl << std::endl;
+}
+
+void test_memory_budget::runTest4(void) 
+{
+  try
+  {
+    //allocations are accounted to the innermost site and to their element type
+    MemoryBudget& budget = MemoryBudget::instance();
+    budget.resetPeak();
+    RasterDims rd(0, 99, 0, 49);
+    if (MemorySite::current() != NULL)
+      CPPUNIT_FAIL("test_memory_budget::runTest4: a site is set outside any scope");
+    {
+      MemorySite outer("test::outer");
+      DataBuffer<float> a(rd, 2);
+      {
+        MemorySite inner("test::inner");
+        DataBuffer<unsigned short> b(rd);
+        if (std::string(MemorySite::current()) != "test::inner" || std::string(b.memorySite()) != "test::inner")
+          CPPUNIT_FAIL("test_memory_budget::runTest4: inner site is not current");
+        if (budget.usage("test::inner", "uint16").current != 100 * 50 * sizeof(unsigned short))
+          CPPUNIT_FAIL("test_memory_budget::runTest4: inner allocation is not accounted to its site");
+      }
+      if (std::string(MemorySite::current()) != "test::outer")
+        CPPUNIT_FAIL("test_memory_budget::runTest4: outer site was not restored");
+      MemoryUsage usage = budget.usage("test::outer", "float32");
+      if (usage.current != 100 * 50 * 2 * sizeof(float) || usage.allocations != 1)
+        CPPUNIT_FAIL("test_memory_budget::runTest4: outer allocation is not accounted to its site");
+    }
+    MemoryUsage inner = budget.usage("test::inner", "uint16");
+    if (inner.current != 0 || inner.peak != 100 * 50 * sizeof(unsigned short))
+      CPPUNIT_FAIL("test_memory_budget::runTest4: release is not accounted to its site");
+
+    //the high water mark restarts without clearing the peaks
+    budget.resetMark();
+    if (budget.mark() != budget.current() || budget.usage("test::inner", "uint16").peak != 100 * 50 * sizeof(unsigned short))
+      CPPUNIT_FAIL("test_memory_budget::runTest4: resetMark cleared the site peaks");
+
+    //the subrect written from a larger tile is accounted to DataRaster::writeSubrect
+    DataRaster mem;
+    mem.createInMemory(RasterDims(0, 49, 0, 19), 1, GDT_Float32);
+    DataBuffer<float> tile(RasterDims(0, 59, 0, 29), 1);
+    mem.setData(tile, RasterDims(0, 49, 0, 19), 1, GDT_Float32, 0);
+    MemoryUsage subrect = budget.usage("DataRaster::writeSubrect", "float32");
+    if (subrect.current != 0 || subrect.peak != 50 * 20 * sizeof(float))
+      CPPUNIT_FAIL("test_memory_budget::runTest4: writeSubrect temporary is not accounted for");
+
+    std::ostringstream report;
+    budget.report(report);
+    if (report.str().find("test::outer") == std::string::npos || report.str().find("DataRaster::writeSubrect") == std::string::npos)
+      CPPUNIT_FAIL("test_memory_budget::runTest4: report does not list the sites");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest4: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_memory_budget::runTest4 completed successfully" << std::endl << std::endl;
+}
+
+void test_memory_budget::runTest5(void) 
+{
+  try
+  {
+    //an Ndvi run records the high water marks of every tile and of its input and output buffers
+    MemoryProfile profile("ndvi");
+    MemoryBudget::instance().resetPeak();
+    {
+      Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_memory.tif"));
+      ndvicalc.setMemoryProfile(&profile);
+      ndvicalc.run();
+    }
+    if (profile.tiles().empty() || profile.peak().buffers == 0 || profile.peak().rss == 0)
+      CPPUNIT_FAIL("test_memory_budget::runTest5: high water marks were not recorded");
+    for (size_t idx=0; idx<profile.tiles().size(); idx++)
+    {
+      if (profile.tiles()[idx].buffers == 0 || profile.tiles()[idx].buffers > profile.peak().buffers)
+        CPPUNIT_FAIL("test_memory_budget::runTest5: tile marks do not match the run");
+    }
+
+    //the site peaks cover every tile, not just the last one, which is smaller here
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    DataRasterIterator iter(msraster, static_cast<int>(0.1 * 1024. * 1024.), 0);
+    RasterDims first, last;
+    iter.getTileDims(0, first);
+    iter.getTileDims(iter.ntiles() - 1, last);
+    unsigned long long inputbytes = (unsigned long long)first.npixels() * 4 * sizeof(unsigned short);
+    if ((int)profile.tiles().size() != iter.ntiles() || !(last.npixels() < first.npixels()))
+      CPPUNIT_FAIL("test_memory_budget::runTest5: unexpected tiling of the input");
+    if (MemoryBudget::instance().usage("Ndvi::input", "uint16").peak != inputbytes || profile.tiles()[0].buffers < inputbytes)
+      CPPUNIT_FAIL("test_memory_budget::runTest5: input peak is not the peak of the largest tile");
+
+    bool input = false, output = false;
+    std::vector<MemoryUsage> usage = MemoryBudget::instance().usage();
+    for (size_t idx=0; idx<usage.size(); idx++)
+    {
+      if (usage[idx].site == "Ndvi::input" && usage[idx].peak > 0 && usage[idx].current == 0)
+        input = true;
+      if (usage[idx].site == "Ndvi::output" && usage[idx].peak > 0 && usage[idx].current == 0)
+        output = true;
+    }
+    if (!input || !output)
+      CPPUNIT_FAIL("test_memory_budget::runTest5: Ndvi buffers are not accounted to their sites");
+
+    std::ostringstream report;
+    profile.report(report);
+    if (report.str().find("ndvi:") == std::string::npos || report.str().find("Ndvi::input") == std::string::npos)
+      CPPUNIT_FAIL("test_memory_budget::runTest5: report is incomplete");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest5: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  unlink("ndvi_memory.tif");
+  
+  std::cout << std::endl << "test_memory_budget::runTest5 completed successfully" << std::endl << std::endl;
+}
+
+/** Allocates a small buffer, as another thread would while a spill is written */
+static void* allocateBuffer(void* arg)
+{
+  DataBuffer<float> buffer(RasterDims(0, 15, 0, 15));
+  *static_cast<volatile bool*>(arg) = true;
+  return(NULL);
+}
+
+/** Memory whose spill waits for another thread to allocate, which it only can if the budget is not locked */
+class BlockingSpill : public Spillable
+{
+public:
+  bool sawAllocation;
+  BlockingSpill(void) : sawAllocation(false) {};
+  unsigned long long spillBytes(void) const { return(512 * 1024); };
+  const char* memorySite(void) const { return("test::blocking"); };
+  unsigned long long spill(const std::string& filename)
+  {
+    (void)filename;
+    volatile bool allocated = false;
+    pthread_t thread;
+    pthread_create(&thread, NULL, allocateBuffer, (void*)&allocated);
+    for (int wait=0; wait<200 && !allocated; wait++)
+      usleep(10000);
+    sawAllocation = allocated;
+    pthread_join(thread, NULL);
+    return(512 * 1024);
+  };
+};
+
+void test_memory_budget::runTest6(void) 
+{
+  try
+  {
+    //a spill is written without holding the budget, so other threads keep allocating
+    MemoryBudget& budget = MemoryBudget::instance();
+    unsigned long long base = budget.current();
+    long long nspills = budget.nspills();
+    budget.setBudget(base + 1024 * 1024);
+    budget.acquire(512 * 1024, "test::blocking");
+    BlockingSpill victim;
+    budget.addCold(&victim);
+
+    DataBuffer<float> hot(RasterDims(0, 511, 0, 399));
+    if (!victim.sawAllocation)
+      CPPUNIT_FAIL("test_memory_budget::runTest6: allocation was blocked while a buffer was spilled");
+    if (budget.nspills() != nspills + 1 || budget.current() != base + 512 * 400 * sizeof(float) ||
+        budget.usage("test::blocking", "unknown").current != 0)
+      CPPUNIT_FAIL("test_memory_budget::runTest6: spill is not accounted for");
+    budget.removeCold(&victim);
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest6: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_memory_budget::runTest6 completed successfully" << std::endl << std::endl;
+}
+
+void test_memory_budget::runTest7(void) 
+{
+  try
+  {
+    //a spilled buffer whose scratch file cannot be read back stays spilled and holds no budget
+    MemoryBudget& budget = MemoryBudget::instance();
+    unsigned long long base = budget.current();
+    mkdir("spill_unreadable", 0755);
+    budget.setScratchDirectory("spill_unreadable");
+    budget.setBudget(base + 300 * 1024);
+
+    RasterDims rd(0, 255, 0, 255);
+    DataBuffer<float>* cold = new DataBuffer<float>(rd);
+    cold->setSpillable(true);
+    DataBuffer<float>* hot = new DataBuffer<float>(rd);
+    if (!cold->spilled())
+      CPPUNIT_FAIL("test_memory_budget::runTest7: cold buffer was not spilled");
+
+    //truncate the scratch file
+    DIR* dir = opendir("spill_unreadable");
+    struct dirent* entry;
+    while (dir && (entry = readdir(dir)) != NULL)
+    {
+      if (entry->d_name[0] != '.')
+        truncate((std::string("spill_unreadable/") + entry->d_name).c_str(), 16);
+    }
+    if (dir)
+      closedir(dir);
+    delete(hot);
+
+    unsigned long long before = budget.current();
+    bool threw = false;
+    try
+    {
+      cold->band(0);
+    }
+    catch (Exception&)
+    {
+      threw = true;
+    }
+    if (!threw || !cold->spilled() || budget.current() != before)
+      CPPUNIT_FAIL("test_memory_budget::runTest7: a failed read back left the buffer usable or the budget charged");
+    delete(cold);
+    if (budget.current() != base)
+      CPPUNIT_FAIL("test_memory_budget::runTest7: usage is incorrect after a failed read back");
+    budget.setScratchDirectory(".");
+    rmdir("spill_unreadable");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_memory_budget::runTest7: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_memory_budget::runTest7 completed successfully" << std::endl << std::endl;
+}
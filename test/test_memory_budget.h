@@ -0,0 +1,37 @@
+#ifndef _TESTMEMORYBUDGETH_
+#define _TESTMEMORYBUDGETH_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class test_memory_budget : public CPPUNIT_NS::TestFixture
+{
+  CPPUNIT_TEST_SUITE (test_memory_budget);
+  CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST (runTest4);
+  CPPUNIT_TEST (runTest5);
+  CPPUNIT_TEST (runTest6);
+  CPPUNIT_TEST (runTest7);
+  CPPUNIT_TEST_SUITE_END ();
+
+public:
+
+  void setUp (void);
+  void tearDown (void);
+
+protected:
+
+  void runTest1(void);
+  void runTest2(void);
+  void runTest3(void);
+  void runTest4(void);
+  void runTest5(void);
+  void runTest6(void);
+  void runTest7(void);
+
+private:
+
+};
+#endif
@@ -0,0 +1,153 @@
+#include <gdal.h>
+#include <vector>
+#include "test_multi_raster_iterator.h"
+#include "MultiRasterIterator.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_multi_raster_iterator);
+
+void test_multi_raster_iterator::setUp (void)
+{}
+
+void test_multi_raster_iterator::tearDown (void)
+{}
+
+/** Writes a raster on a 30m grid whose origin is at the given global pixel.  Each value encodes its global pixel. */
+static void makeGridRaster(const std::string& filename, int originSample, int originLine, int ns, int nl, double pixel = 30.0)
+{
+  RasterDims rd(0, ns - 1, 0, nl - 1);
+  DataBuffer<float> data(rd, 1);
+  for (int line=0; line<nl; line++)
+  {
+    for (int sample=0; sample<ns; sample++)
+      data.band(0)(line, sample) = (float)((originSample + sample) * 1000 + originLine + line);
+  }
+  double gt[6] = { 500000.0 + originSample * 30.0, pixel, 0.0, 4000000.0 - originLine * 30.0, 0.0, -pixel };
+  DataRaster raster;
+  raster.create(filename, rd, 1, GDT_Float32, "GTiff");
+  raster.setGeoTransform(gt);
+  raster.setData(data, rd, 1, GDT_Float32, 0);
+}
+
+void test_multi_raster_iterator::runTest1(void) 
+{
+  try
+  {
+    //three rasters on one grid with different extents, read together tile by tile
+    makeGridRaster("multi_a.tif", 0, 0, 120, 100);
+    makeGridRaster("multi_b.tif", 15, 7, 120, 100);
+    makeGridRaster("multi_c.tif", -4, 11, 110, 120);
+    DataRaster a, b, c;
+    a.open(std::string("multi_a.tif"), GA_ReadOnly);
+    b.open(std::string("multi_b.tif"), GA_ReadOnly);
+    c.open(std::string("multi_c.tif"), GA_ReadOnly);
+    std::vector<DataRaster*> inputs;
+    inputs.push_back(&a);
+    inputs.push_back(&b);
+    inputs.push_back(&c);
+
+    MultiRasterIterator iter(inputs, 105 * 4 * 8);
+    if (!(iter.dims() == RasterDims(15, 105, 11, 99)) || iter.sampleOffset(1) != -15 || iter.lineOffset(1) != -7 ||
+        iter.sampleOffset(2) != 4 || iter.lineOffset(2) != -11 || iter.ntiles() < 2)
+      CPPUNIT_FAIL("test_multi_raster_iterator::runTest1: common area or offsets are incorrect");
+
+    for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+    {
+      RasterDims tiledims;
+      iter.getTileDims(tilenum, tiledims);
+      std::vector<DataBuffer<float>*> buffers;
+      for (int input=0; input<iter.ninputs(); input++)
+      {
+        RasterDims window;
+        iter.getInputDims(input, tilenum, window);
+        buffers.push_back(new DataBuffer<float>(window, 1, false));
+      }
+      iter.getData(tilenum, buffers, GDT_Float32);
+
+      //every input sees the same global pixel at the same tile position
+      for (int line=0; line<tiledims.height(); line++)
+      {
+        for (int sample=0; sample<tiledims.width(); sample++)
+        {
+          float expected = (float)((tiledims.startSample() + sample) * 1000 + tiledims.startLine() + line);
+          for (int input=0; input<iter.ninputs(); input++)
+          {
+            if (buffers[input]->band(0)(line, sample) != expected)
+              CPPUNIT_FAIL("test_multi_raster_iterator::runTest1: inputs are not aligned");
+          }
+        }
+      }
+      for (int input=0; input<iter.ninputs(); input++)
+        delete(buffers[input]);
+    }
+
+    //the same DataRaster twice is read serially
+    std::vector<DataRaster*> twice(2, &a);
+    MultiRasterIterator same(twice, 1024 * 1024);
+    RasterDims window;
+    same.getInputDims(1, 0, window);
+    DataBuffer<float> first(window, 1, false), second(window, 1, false);
+    std::vector<DataBuffer<float>*> buffers(1, &first);
+    buffers.push_back(&second);
+    same.getData(0, buffers, GDT_Float32);
+    if (!(same.dims() == a.dims()) || first[4321] != second[4321])
+      CPPUNIT_FAIL("test_multi_raster_iterator::runTest1: a raster read twice does not match itself");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_multi_raster_iterator::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_multi_raster_iterator::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+/** Returns true if an iterator over the two rasters cannot be built */
+static bool rejects(const std::string& filenameA, const std::string& filenameB)
+{
+  DataRaster a, b;
+  a.open(filenameA, GA_ReadOnly);
+  b.open(filenameB, GA_ReadOnly);
+  std::vector<DataRaster*> inputs(1, &a);
+  inputs.push_back(&b);
+  try
+  {
+    MultiRasterIterator iter(inputs, 1024 * 1024);
+  }
+  catch (Exception& e)
+  {
+    return(true);
+  }
+  return(false);
+}
+
+void test_multi_raster_iterator::runTest2(void) 
+{
+  try
+  {
+    //grids that do not line up are rejected
+    makeGridRaster("multi_a.tif", 0, 0, 120, 100);
+    makeGridRaster("multi_b.tif", 0, 0, 120, 100, 20.0);
+    if (!rejects("multi_a.tif", "multi_b.tif"))
+      CPPUNIT_FAIL("test_multi_raster_iterator::runTest2: a different pixel size was accepted");
+    makeGridRaster("multi_b.tif", 200, 0, 120, 100);
+    if (!rejects("multi_a.tif", "multi_b.tif"))
+      CPPUNIT_FAIL("test_multi_raster_iterator::runTest2: rasters that do not overlap were accepted");
+
+    DataRaster shifted;
+    shifted.open(std::string("multi_b.tif"), GA_Update);
+    double gt[6] = { 500000.0 + 15.0, 30.0, 0.0, 4000000.0, 0.0, -30.0 };
+    shifted.setGeoTransform(gt);
+    shifted.close();
+    if (!rejects("multi_a.tif", "multi_b.tif"))
+      CPPUNIT_FAIL("test_multi_raster_iterator::runTest2: a half pixel shift was accepted");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_multi_raster_iterator::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_multi_raster_iterator::runTest2 completed successfully" << std::endl << std::endl;
+}
@@ -0,0 +1,27 @@
+#ifndef _TESTMULTIRASTERITERATORH_
+#define _TESTMULTIRASTERITERATORH_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class test_multi_raster_iterator : public CPPUNIT_NS::TestFixture
+{
+  CPPUNIT_TEST_SUITE (test_multi_raster_iterator);
+  CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST_SUITE_END ();
+
+public:
+
+  void setUp (void);
+  void tearDown (void);
+
+protected:
+
+  void runTest1(void);
+  void runTest2(void);
+
+private:
+
+};
+#endif
@@ -1,4 +1,5 @@
 #include <gdal.h>
+#include <string.h>
 #include <vector>
 #include "test_ndvi.h"
 
@@ -29,3 +30,279 @@ void test_ndvi::runTest1(void)
 
 
 
+void test_ndvi::runTest2(void) 
+{
+  try
+  {
+    //compute the float reference for the whole chip in memory
+    DataRaster dr;
+    dr.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> inputdata(dr.dims(), dr.nbands());
+    for (int band=0; band<dr.nbands(); band++)
+      dr.getData(inputdata, band+1, dr.dataType(), band);
+    DataBuffer<float> reference(dr.dims(), 1);
+    Ndvi::processchunk(inputdata, reference);
+
+    GDALDataType types[2] = { GDT_Int16, GDT_Byte };
+    for (int type=0; type<2; type++)
+    {
+      {
+        Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_quantized.tif"), types[type]);
+        ndvicalc.run();
+      }
+
+      DataRaster output;
+      output.open(std::string("ndvi_quantized.tif"), GA_ReadOnly);
+      if (output.dataType() != types[type])
+        CPPUNIT_FAIL("test_ndvi::runTest2: output data type does not match the requested type");
+
+      double scale, offset;
+      output.getScaleOffset(scale, offset);
+      bool hasNoData = false;
+      output.noDataValue(1, &hasNoData);
+      if (!hasNoData)
+        CPPUNIT_FAIL("test_ndvi::runTest2: output has no nodata value");
+
+      DataBuffer<double> outputdata(output.dims(), 1);
+      output.getData(outputdata, 1, GDT_Float64, 0);
+      int sz = output.dims().width() * output.dims().height();
+      for (int idx=0; idx<sz; idx++)
+      {
+        double val = outputdata[idx] * scale + offset;
+        if (fabs(val - reference[idx]) > 0.5 * scale + 1e-6)
+        {
+          std::ostringstream ostr;
+          ostr << "test_ndvi::runTest2: quantized value " << val << " differs from " << reference[idx];
+          CPPUNIT_FAIL(ostr.str().c_str());
+        }
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_ndvi::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_ndvi::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_ndvi::runTest3(void) 
+{
+  try
+  {
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> msdata(msraster.dims(), msraster.nbands());
+    for (int band=0; band<msraster.nbands(); band++)
+      msraster.getData(msdata, band+1, msraster.dataType(), band);
+    DataBuffer<float> reference(msraster.dims(), 1);
+    Ndvi::processchunk(msdata, reference);
+
+    //a sparse input with a nodata collar, only lines 140-259 hold data
+    {
+      DataRaster sparse;
+      std::vector<std::string> options(1, std::string("SPARSE_OK=TRUE"));
+      sparse.create("sparse_input.tif", msraster.dims(), msraster.nbands(), GDT_UInt16, "GTiff", &msraster, options);
+      for (int band=0; band<sparse.nbands(); band++)
+        sparse.setNoDataValue(0, band+1);
+      RasterDims written(0, 399, 140, 259);
+      for (int band=0; band<sparse.nbands(); band++)
+        sparse.setData(msdata, written, band+1, sparse.dataType(), band);
+    }
+
+    {
+      Ndvi ndvicalc(std::string("sparse_input.tif"), std::string("ndvi_sparse.tif"), GDT_Int16);
+      ndvicalc.run();
+    }
+
+    DataRaster output;
+    output.open(std::string("ndvi_sparse.tif"), GA_ReadOnly);
+    DataCoverage coverage = output.coverage(RasterDims(0, 399, 264, 399));
+    if (coverage != DataCoverageEmpty && coverage != DataCoverageUnknown)
+      CPPUNIT_FAIL("test_ndvi::runTest3: empty input tiles were written to the output");
+
+    DataBuffer<short> outputdata(output.dims(), 1);
+    output.getData(outputdata, 1, output.dataType(), 0);
+    for (int line=0; line<400; line++)
+    {
+      for (int sample=0; sample<400; sample++)
+      {
+        int idx = line * 400 + sample;
+        bool valid = (line >= 140 && line <= 259);
+        if (!valid && outputdata[idx] != -32768)
+          CPPUNIT_FAIL("test_ndvi::runTest3: collar pixel is not nodata");
+        if (valid && fabs(outputdata[idx] * 0.0001 - reference[idx]) > 0.00005 + 1e-6)
+          CPPUNIT_FAIL("test_ndvi::runTest3: data pixel does not match the reference");
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_ndvi::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_ndvi::runTest3 completed successfully" << std::endl << std::endl;
+}
+
+void test_ndvi::runTest4(void)
+{
+  try
+  {
+    //a chip held in memory, as a service would receive it
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> msdata(msraster.dims(), msraster.nbands());
+    for (int band=0; band<msraster.nbands(); band++)
+      msraster.getData(msdata, band+1, msraster.dataType(), band);
+    DataBuffer<float> reference(msraster.dims(), 1);
+    Ndvi::processchunk(msdata, reference);
+
+    DataRaster input;
+    input.wrap(msdata, GDT_UInt16);
+    GDALDataType types[2] = { GDT_Float32, GDT_Int16 };
+    for (int type=0; type<2; type++)
+    {
+      DataRaster output;
+      output.createInMemory(input.dims(), 1, types[type], &msraster);
+      {
+        Ndvi ndvicalc(input, output);
+        ndvicalc.run();
+      }
+      if (!input.inMemory() || !output.inMemory())
+        CPPUNIT_FAIL("test_ndvi::runTest4: Ndvi closed a raster it does not own");
+
+      double scale = 1.0, offset = 0.0;
+      if (types[type] != GDT_Float32)
+        output.getScaleOffset(scale, offset);
+      DataBuffer<double> outputdata(output.dims(), 1);
+      output.getData(outputdata, 1, GDT_Float64, 0);
+      for (long long idx=0; idx<(long long)output.nsamples() * output.nlines(); idx++)
+      {
+        if (fabs(outputdata[idx] * scale + offset - reference[idx]) > 0.5 * scale + 1e-6)
+          CPPUNIT_FAIL("test_ndvi::runTest4: in memory NDVI does not match the reference");
+      }
+    }
+
+    bool failed = false;
+    try
+    {
+      DataRaster output;
+      output.createInMemory(RasterDims(0, input.nsamples(), 0, 9), 1, GDT_Float32);
+      Ndvi ndvicalc(input, output);
+    }
+    catch (Exception&)
+    {
+      failed = true;
+    }
+    if (!failed)
+      CPPUNIT_FAIL("test_ndvi::runTest4: output of the wrong size was accepted");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_ndvi::runTest4: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_ndvi::runTest4 completed successfully" << std::endl << std::endl;
+}
+
+void test_ndvi::runTest5(void)
+{
+  try
+  {
+    //a scene of 4x4 pixel blocks of constant value, so every resampling reduces a block to its value
+    RasterDims rd(0, 399, 0, 299);
+    DataBuffer<unsigned short> msdata(rd, 4);
+    for (int band=0; band<4; band++)
+      for (int line=0; line<rd.height(); line++)
+        for (int sample=0; sample<rd.width(); sample++)
+          msdata.band(band)(line, sample) = (unsigned short)(100 + band * 50 + (sample / 4) * 3 + (line / 4) * 7);
+    DataRaster input;
+    input.wrap(msdata, GDT_UInt16);
+
+    DataRaster output;
+    output.createInMemory(input.previewDims(100), 1, GDT_Float32);
+    Ndvi ndvicalc(input, output);
+    if (!ndvicalc.preview() || output.nsamples() != 100 || output.nlines() != 75)
+      CPPUNIT_FAIL("test_ndvi::runTest5: a smaller output is not a preview");
+    ndvicalc.run();
+
+    DataView<float> ndvi = output.view<float>(1);
+    for (int line=0; line<output.nlines(); line++)
+    {
+      for (int sample=0; sample<output.nsamples(); sample++)
+      {
+        float red = (float)msdata.band(2)(line * 4, sample * 4), nir = (float)msdata.band(3)(line * 4, sample * 4);
+        if (fabs(ndvi(line, sample) - (nir - red) / (nir + red + 1e-6)) > 1e-6)
+          CPPUNIT_FAIL("test_ndvi::runTest5: preview NDVI is incorrect");
+      }
+    }
+
+    //a thumbnail of a file, with the georeferencing scaled to the preview
+    Ndvi::preview(std::string("ms_chip"), std::string("ndvi_preview.tif"), 32, GDT_Byte, GRIORA_NearestNeighbour);
+    DataRaster chip, thumbnail;
+    chip.open(std::string("ms_chip"), GA_ReadOnly);
+    thumbnail.open(std::string("ndvi_preview.tif"), GA_ReadOnly);
+    RasterDims expected = chip.previewDims(32);
+    double chipgt[6], gt[6];
+    chip.getGeoTransform(chipgt);
+    if (!(thumbnail.dims() == expected) || thumbnail.dataType() != GDT_Byte || !thumbnail.getGeoTransform(gt) ||
+        fabs(gt[1] - chipgt[1] * chip.nsamples() / expected.width()) > 1e-9 || gt[0] != chipgt[0])
+      CPPUNIT_FAIL("test_ndvi::runTest5: thumbnail dimensions or georeferencing are incorrect");
+    thumbnail.close();
+    remove("ndvi_preview.tif");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_ndvi::runTest5: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_ndvi::runTest5 completed successfully" << std::endl << std::endl;
+}
+
+void test_ndvi::runTest6(void)
+{
+  try
+  {
+    //small values, where a double and a single precision epsilon round differently
+    RasterDims rd(0, 255, 0, 255);
+    DataBuffer<unsigned short> inputdata(rd, 4);
+    for (int line=0; line<256; line++)
+    {
+      for (int sample=0; sample<256; sample++)
+      {
+        inputdata.band(3)(line, sample) = (unsigned short)sample;
+        inputdata.band(2)(line, sample) = (unsigned short)line;
+      }
+    }
+
+    //the plain kernel, the masking kernel used when the input declares nodata and the lookup table agree
+    DataBuffer<float> plain(rd, 1), masked(rd, 1), table(rd, 1);
+    Ndvi::processchunk(inputdata, plain);
+    Ndvi::processchunk(inputdata, masked, Quantizer::unitRange(GDT_Float32), true, 65535.0);
+    BandRatioLut lut;
+    lut.build<unsigned short, float>(8, Ndvi::Value<unsigned short>());
+    if (!Ndvi::processchunk(inputdata, table, lut))
+      CPPUNIT_FAIL("test_ndvi::runTest6: the lookup table was not applied");
+    for (long long idx=0; idx<rd.npixels(); idx++)
+    {
+      if (memcmp(&plain[idx], &masked[idx], sizeof(float)) != 0 || memcmp(&plain[idx], &table[idx], sizeof(float)) != 0)
+        CPPUNIT_FAIL("test_ndvi::runTest6: the NDVI of a pixel depends on the kernel");
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_ndvi::runTest6: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_ndvi::runTest6 completed successfully" << std::endl << std::endl;
+}
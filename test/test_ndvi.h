@@ -10,6 +10,11 @@ class test_ndvi : public CPPUNIT_NS::TestFixture
 {
   CPPUNIT_TEST_SUITE (test_ndvi);
   CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST (runTest4);
+  CPPUNIT_TEST (runTest5);
+  CPPUNIT_TEST (runTest6);
   CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -20,6 +25,11 @@ public:
 protected:
 
   void runTest1(void);
+  void runTest2(void);
+  void runTest3(void);
+  void runTest4(void);
+  void runTest5(void);
+  void runTest6(void);
 
 private:
 
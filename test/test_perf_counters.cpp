@@ -0,0 +1,122 @@
+#include <gdal.h>
+#include <vector>
+#include <sstream>
+#include "test_perf_counters.h"
+#include "PerfCounters.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_perf_counters);
+
+void test_perf_counters::setUp (void)
+{
+  PerfCounters::instance().reset();
+}
+
+void test_perf_counters::tearDown (void)
+{
+  PerfCounters::instance().setEnabled(false);
+  PerfCounters::instance().setUseCounters(true);
+  PerfCounters::instance().reset();
+}
+
+void test_perf_counters::runTest1(void) 
+{
+  try
+  {
+    //nothing is recorded while collection is off
+    PerfCounters& counters = PerfCounters::instance();
+    {
+      PerfScope scope("test::kernel", PerfTypeName<unsigned short>::name());
+    }
+    if (!counters.names().empty())
+      CPPUNIT_FAIL("test_perf_counters::runTest1: a scope was recorded while collection was off");
+
+    //the kernels and I/O of an Ndvi run are aggregated per kernel and type
+    counters.setEnabled(true);
+    {
+      Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_counters.tif"));
+      ndvicalc.run();
+    }
+    PerfStats kernel = counters.stats("Ndvi::processchunk<uint16,float32>");
+    PerfStats read = counters.stats("DataRaster::getData<uint16>");
+    PerfStats write = counters.stats("DataRaster::setData<float32>");
+    if (kernel.calls < 1 || read.calls != kernel.calls || write.calls != kernel.calls)
+      CPPUNIT_FAIL("test_perf_counters::runTest1: the kernel and I/O scopes of the tile loop were not recorded");
+
+    DataRaster chip;
+    chip.open(std::string("ms_chip"), GA_ReadOnly);
+    unsigned long long npixels = (unsigned long long)chip.dims().npixels();
+    if (kernel.bytes != npixels * (2 * sizeof(unsigned short) + sizeof(float)) || read.bytes != npixels * 4 * sizeof(unsigned short) ||
+        kernel.seconds < 0.0 || read.seconds <= 0.0)
+      CPPUNIT_FAIL("test_perf_counters::runTest1: bytes or time of the kernel are incorrect");
+
+    //counts are present where perf_event_open works and marked unavailable where it does not
+    if (counters.countersAvailable() && kernel.has(PerfCycles))
+    {
+      if (kernel.counts[PerfCycles] <= 0 || (kernel.has(PerfInstructions) && kernel.ipc() <= 0.0) || kernel.bytesPerCycle() <= 0.0)
+        CPPUNIT_FAIL("test_perf_counters::runTest1: counted kernel has no cycles or IPC");
+    }
+    else if (kernel.has(PerfCycles) || kernel.ipc() != 0.0 || kernel.bytesPerCycle() != 0.0)
+      CPPUNIT_FAIL("test_perf_counters::runTest1: unavailable counters were reported");
+
+    std::ostringstream ostr;
+    counters.report(ostr);
+    if (ostr.str().find("Ndvi::processchunk<uint16,float32>") == std::string::npos || ostr.str().find("IPC") == std::string::npos)
+      CPPUNIT_FAIL("test_perf_counters::runTest1: report is incomplete");
+    remove("ndvi_counters.tif");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_perf_counters::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_perf_counters::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_perf_counters::runTest2(void) 
+{
+  try
+  {
+    //with counters off, as in a container without perf_event_open, calls, time and bytes are still collected
+    PerfCounters& counters = PerfCounters::instance();
+    counters.setEnabled(true);
+    counters.setUseCounters(false);
+    if (counters.countersAvailable())
+      CPPUNIT_FAIL("test_perf_counters::runTest2: counters were used after they were turned off");
+
+    std::vector<float> data(100000, 1.0f);
+    for (int call=0; call<3; call++)
+    {
+      PerfScope scope("test::sum", PerfTypeName<float>::name());
+      float sum = 0.0f;
+      for (size_t idx=0; idx<data.size(); idx++)
+        sum += data[idx];
+      scope.setBytes(data.size() * sizeof(float));
+      data[0] = sum;
+    }
+
+    PerfStats stats = counters.stats("test::sum<float32>");
+    if (stats.calls != 3 || stats.bytes != 3 * data.size() * sizeof(float) || stats.seconds <= 0.0)
+      CPPUNIT_FAIL("test_perf_counters::runTest2: timing only totals are incorrect");
+    for (int event=0; event<PerfEventCount; event++)
+      if (stats.has((PerfEvent)event))
+        CPPUNIT_FAIL("test_perf_counters::runTest2: a counter was reported while counters were off");
+
+    std::ostringstream ostr;
+    counters.report(ostr);
+    if (ostr.str().find("n/a") == std::string::npos)
+      CPPUNIT_FAIL("test_perf_counters::runTest2: unavailable counters are not marked in the report");
+    if (counters.stats("test::missing").calls != 0)
+      CPPUNIT_FAIL("test_perf_counters::runTest2: an unrecorded kernel has calls");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_perf_counters::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+
+  std::cout << std::endl << "test_perf_counters::runTest2 completed successfully" << std::endl << std::endl;
+}
@@ -0,0 +1,177 @@
+#include <gdal.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include "test_pipeline.h"
+#include "Pipeline.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_pipeline);
+
+void test_pipeline::setUp (void)
+{}
+
+void test_pipeline::tearDown (void)
+{}
+
+void test_pipeline::runTest1(void) 
+{
+  try
+  {
+    DataRaster input;
+    input.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> inputdata(input.dims(), input.nbands());
+    for (int band=0; band<input.nbands(); band++)
+      input.getData(inputdata, band+1, input.dataType(), band);
+    DataBuffer<float> reference(input.dims(), 1);
+    Ndvi::processchunk(inputdata, reference);
+
+    //ndvi, statistics, threshold and write in one pass
+    DataRaster mask;
+    mask.create("pipeline_mask.tif", input.dims(), 1, GDT_Float32, "GTiff", &input);
+    StatisticsOp* ndvistats = new StatisticsOp;
+    StatisticsOp* maskstats = new StatisticsOp;
+    Pipeline pipeline(input);
+    pipeline.add(new NormalizedDifferenceOp(3, 2)).add(ndvistats).add(new ThresholdOp(0.2f)).add(maskstats).add(new WriteOp(mask));
+    if (ndvistats->count() != 0 || ndvistats->min() == ndvistats->min() || ndvistats->mean() == ndvistats->mean())
+      CPPUNIT_FAIL("test_pipeline::runTest1: statistics before a run are not empty");
+    pipeline.run(32 * 1024);
+    if (ndvistats->count(1) != 0 || ndvistats->max(-1) == ndvistats->max(-1))
+      CPPUNIT_FAIL("test_pipeline::runTest1: statistics of a band that was not processed are not empty");
+
+    double sum = 0.0, minval = 1e30, maxval = -1e30;
+    long long above = 0;
+    for (int idx=0; idx<400*400; idx++)
+    {
+      sum += reference[idx];
+      minval = (reference[idx] < minval) ? reference[idx] : minval;
+      maxval = (reference[idx] > maxval) ? reference[idx] : maxval;
+      above += (reference[idx] > 0.2f) ? 1 : 0;
+    }
+
+    if (ndvistats->count() != 400 * 400                    ||
+        fabs(ndvistats->mean() - sum / (400. * 400.)) > 1e-5 ||
+        fabs(ndvistats->min() - minval) > 1e-5             ||
+        fabs(ndvistats->max() - maxval) > 1e-5)
+      CPPUNIT_FAIL("test_pipeline::runTest1: ndvi statistics do not match the reference");
+    if (fabs(maskstats->mean() - above / (400. * 400.)) > 1e-3)
+      CPPUNIT_FAIL("test_pipeline::runTest1: threshold fraction does not match the reference");
+
+    DataBuffer<float> maskdata(mask.dims(), 1);
+    mask.getData(maskdata, 1, GDT_Float32, 0);
+    long long mismatches = 0;
+    for (int idx=0; idx<400*400; idx++)
+      mismatches += (maskdata[idx] != ((reference[idx] > 0.2f) ? 1.0f : 0.0f)) ? 1 : 0;
+    //single and double precision NDVI may fall on different sides of the threshold for a handful of pixels
+    if (mismatches > 10)
+      CPPUNIT_FAIL("test_pipeline::runTest1: written mask does not match the reference");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_pipeline::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_pipeline::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_pipeline::runTest2(void) 
+{
+  try
+  {
+    DataRaster input;
+    input.open(std::string("ms_chip"), GA_ReadOnly);
+
+    //the same filter chain in many small tiles and in a single tile gives identical results
+    int memsizes[2] = { 16 * 1024, 64 * 1024 * 1024 };
+    const char* filenames[2] = { "pipeline_tiled.tif", "pipeline_whole.tif" };
+    for (int run=0; run<2; run++)
+    {
+      DataRaster output;
+      output.create(filenames[run], input.dims(), 1, GDT_Float32, "GTiff", &input);
+      Pipeline pipeline(input);
+      pipeline.add(new NormalizedDifferenceOp(3, 2)).add(new BoxFilterOp(2)).add(new BoxFilterOp(1)).add(new WriteOp(output));
+      if (pipeline.overlap() != 3)
+        CPPUNIT_FAIL("test_pipeline::runTest2: overlap was not derived from the operators");
+      pipeline.run(memsizes[run]);
+    }
+
+    DataRaster tiled, whole;
+    tiled.open(std::string(filenames[0]), GA_ReadOnly);
+    whole.open(std::string(filenames[1]), GA_ReadOnly);
+    DataBuffer<float> tileddata(tiled.dims(), 1), wholedata(whole.dims(), 1);
+    tiled.getData(tileddata, 1, GDT_Float32, 0);
+    whole.getData(wholedata, 1, GDT_Float32, 0);
+    for (int idx=0; idx<400*400; idx++)
+    {
+      if (tileddata[idx] != wholedata[idx])
+      {
+        std::ostringstream ostr;
+        ostr << "test_pipeline::runTest2: pixel " << idx << " differs between tiled and whole runs";
+        CPPUNIT_FAIL(ostr.str().c_str());
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_pipeline::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_pipeline::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_pipeline::runTest3(void) 
+{
+  try
+  {
+    DataRaster input;
+    input.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> inputdata(input.dims(), input.nbands());
+    for (int band=0; band<input.nbands(); band++)
+      input.getData(inputdata, band+1, input.dataType(), band);
+    Quantizer quantizer = Quantizer::unitRange(GDT_Int16);
+    DataBuffer<short> reference(input.dims(), 1);
+    Ndvi::processchunk(inputdata, reference, quantizer);
+
+    //the pipeline writes the same scaled integers as the fused Ndvi kernel
+    {
+      DataRaster output;
+      output.create("pipeline_int16.tif", input.dims(), 1, GDT_Int16, "GTiff", &input);
+      Pipeline pipeline(input);
+      pipeline.add(new NormalizedDifferenceOp(3, 2)).add(new WriteOp(output, quantizer));
+      pipeline.run(32 * 1024);
+    }
+
+    DataRaster output;
+    output.open(std::string("pipeline_int16.tif"), GA_ReadOnly);
+    double scale = 0.0, offset = 0.0;
+    output.getScaleOffset(scale, offset);
+    bool hasNoData = false;
+    if (output.noDataValue(1, &hasNoData) != quantizer.noData() || !hasNoData || scale != quantizer.scale())
+      CPPUNIT_FAIL("test_pipeline::runTest3: scale and nodata were not written");
+    DataBuffer<short> outputdata(output.dims(), 1);
+    output.getData(outputdata, 1, GDT_Int16, 0);
+    for (int idx=0; idx<400*400; idx++)
+    {
+      if (outputdata[idx] != reference[idx])
+        CPPUNIT_FAIL("test_pipeline::runTest3: written values do not match the fused kernel");
+    }
+
+    bool thrown = false;
+    try { WriteOp op(output, Quantizer::unitRange(GDT_Byte)); } catch (Exception& e) { thrown = true; }
+    if (!thrown)
+      CPPUNIT_FAIL("test_pipeline::runTest3: a quantizer of another data type was accepted");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_pipeline::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  unlink("pipeline_int16.tif");
+  
+  std::cout << std::endl << "test_pipeline::runTest3 completed successfully" << std::endl << std::endl;
+}
@@ -0,0 +1,175 @@
+#include <gdal.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "test_quantile_sketch.h"
+#include "QuantileSketch.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_quantile_sketch);
+
+void test_quantile_sketch::setUp (void)
+{}
+
+void test_quantile_sketch::tearDown (void)
+{}
+
+/** Returns the normalized rank error of an estimated quantile against sorted values */
+static double rankError(const std::vector<float>& sorted, double q, float estimate)
+{
+  double lo = (double)(std::lower_bound(sorted.begin(), sorted.end(), estimate) - sorted.begin());
+  double hi = (double)(std::upper_bound(sorted.begin(), sorted.end(), estimate) - sorted.begin());
+  double target = q * (double)sorted.size();
+  double error = (target < lo) ? lo - target : ((target > hi) ? target - hi : 0.0);
+  return(error / (double)sorted.size());
+}
+
+void test_quantile_sketch::runTest1(void) 
+{
+  try
+  {
+    //a skewed stream summarized directly and as four merged partial sketches
+    std::vector<float> values;
+    unsigned int state = 12345u;
+    for (int idx=0; idx<400000; idx++)
+    {
+      state = state * 1664525u + 1013904223u;
+      double u = (double)(state >> 8) / 16777216.0;
+      values.push_back((float)(u * u * u - 0.25));
+    }
+
+    QuantileSketch whole(0.01);
+    std::vector<QuantileSketch> parts;
+    for (int part=0; part<4; part++)
+      parts.push_back(QuantileSketch(0.01, part));
+    for (size_t idx=0; idx<values.size(); idx++)
+    {
+      whole.add(values[idx]);
+      parts[idx % 4].add(values[idx]);
+    }
+    QuantileSketch merged(0.01);
+    for (int part=0; part<4; part++)
+      merged.merge(parts[part]);
+
+    std::vector<float> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    if (whole.count() != 400000 || merged.count() != 400000)
+      CPPUNIT_FAIL("test_quantile_sketch::runTest1: count is incorrect");
+    if (whole.quantile(0.0) != sorted.front() || whole.quantile(1.0) != sorted.back())
+      CPPUNIT_FAIL("test_quantile_sketch::runTest1: minimum or maximum is incorrect");
+    if (whole.nretained() > 4000 || merged.nretained() > 4000)
+      CPPUNIT_FAIL("test_quantile_sketch::runTest1: sketch retained too many values");
+
+    double qs[] = { 0.001, 0.02, 0.1, 0.25, 0.5, 0.75, 0.9, 0.98, 0.999 };
+    for (int idx=0; idx<9; idx++)
+    {
+      if (rankError(sorted, qs[idx], whole.quantile(qs[idx])) > 0.01 || rankError(sorted, qs[idx], merged.quantile(qs[idx])) > 0.01)
+      {
+        std::ostringstream ostr;
+        ostr << "test_quantile_sketch::runTest1: quantile " << qs[idx] << " is outside the rank error";
+        CPPUNIT_FAIL(ostr.str().c_str());
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_quantile_sketch::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_quantile_sketch::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_quantile_sketch::runTest2(void) 
+{
+  try
+  {
+    //2% and 98% stretch points of a float band with nodata, NaN and several chunks and threads
+    RasterDims rd(0, 299, 0, 199);
+    DataBuffer<float> data(rd, 1);
+    std::vector<float> valid;
+    for (int line=0; line<200; line++)
+    {
+      for (int sample=0; sample<300; sample++)
+      {
+        float value = (float)(sin(line * 0.05) * cos(sample * 0.07));
+        if ((line * 300 + sample) % 53 == 0)
+          value = -9999.0f;
+        else if ((line * 300 + sample) % 59 == 0)
+          value = std::numeric_limits<float>::quiet_NaN();
+        else
+          valid.push_back(value);
+        data.band(0)(line, sample) = value;
+      }
+    }
+    DataRaster raster;
+    raster.create("quantile_ndvi.tif", rd, 1, GDT_Float32, "GTiff");
+    raster.setNoDataValue(-9999.0);
+    raster.setData(data, rd, 1, GDT_Float32, 0);
+    raster.close();
+
+    DataRaster input;
+    input.open(std::string("quantile_ndvi.tif"), GA_ReadOnly);
+    RasterQuantiles quantiles(input, 1, 0.005);
+    quantiles.run(300 * 4 * 16, 3);
+    std::sort(valid.begin(), valid.end());
+    if (quantiles.sketch().count() != (long long)valid.size())
+      CPPUNIT_FAIL("test_quantile_sketch::runTest2: nodata or NaN values were counted");
+    if (rankError(valid, 0.02, quantiles.quantile(0.02)) > 0.005 || rankError(valid, 0.98, quantiles.quantile(0.98)) > 0.005)
+      CPPUNIT_FAIL("test_quantile_sketch::runTest2: stretch points are outside the rank error");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_quantile_sketch::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_quantile_sketch::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_quantile_sketch::runTest3(void) 
+{
+  try
+  {
+    //the same stream through sketches seeded alike and differently
+    std::vector<float> values;
+    unsigned int state = 777u;
+    for (int idx=0; idx<200000; idx++)
+    {
+      state = state * 1664525u + 1013904223u;
+      values.push_back((float)(state >> 8) / 16777216.0f);
+    }
+    QuantileSketch first(0.02, 1), again(0.02, 1), other(0.02, 2);
+    for (size_t idx=0; idx<values.size(); idx++)
+    {
+      first.add(values[idx]);
+      again.add(values[idx]);
+      other.add(values[idx]);
+    }
+
+    std::vector<float> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    int ndiffer = 0;
+    for (int pct=1; pct<100; pct++)
+    {
+      double q = pct / 100.0;
+      if (first.quantile(q) != again.quantile(q))
+        CPPUNIT_FAIL("test_quantile_sketch::runTest3: sketches with the same seed differ");
+      if (first.quantile(q) != other.quantile(q))
+        ndiffer++;
+      if (rankError(sorted, q, other.quantile(q)) > 0.02)
+        CPPUNIT_FAIL("test_quantile_sketch::runTest3: quantile is outside the rank error");
+    }
+    if (ndiffer == 0)
+      CPPUNIT_FAIL("test_quantile_sketch::runTest3: sketches with different seeds made the same compactions");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_quantile_sketch::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_quantile_sketch::runTest3 completed successfully" << std::endl << std::endl;
+}
@@ -0,0 +1,29 @@
+#ifndef _TESTQUANTILESKETCHH_
+#define _TESTQUANTILESKETCHH_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class test_quantile_sketch : public CPPUNIT_NS::TestFixture
+{
+  CPPUNIT_TEST_SUITE (test_quantile_sketch);
+  CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST_SUITE_END ();
+
+public:
+
+  void setUp (void);
+  void tearDown (void);
+
+protected:
+
+  void runTest1(void);
+  void runTest2(void);
+  void runTest3(void);
+
+private:
+
+};
+#endif
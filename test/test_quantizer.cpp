@@ -0,0 +1,95 @@
+#include <math.h>
+#include <limits>
+#include "test_quantizer.h"
+#include "Quantizer.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_quantizer);
+
+void test_quantizer::setUp (void)
+{}
+
+void test_quantizer::tearDown (void)
+{}
+
+void test_quantizer::runTest1(void) 
+{
+  try
+  {
+    Quantizer q = Quantizer::unitRange(GDT_Int16);
+    if (q.quantize<short>(0.5f)   != 5000   ||
+        q.quantize<short>(-1.0f)  != -10000 ||
+        q.quantize<short>(0.12345f) != 1235 ||
+        q.quantize<short>(-100.0f) != -32767)
+      CPPUNIT_FAIL("test_quantizer::runTest1: Int16 values do not match");
+
+    //nodata is reserved, NaN maps onto it
+    if (q.quantize<short>(std::numeric_limits<float>::quiet_NaN()) != -32768)
+      CPPUNIT_FAIL("test_quantizer::runTest1: NaN is not mapped to nodata");
+
+    Quantizer b = Quantizer::unitRange(GDT_Byte);
+    if (b.quantize<unsigned char>(-1.0f) != 0   ||
+        b.quantize<unsigned char>(0.0f)  != 100 ||
+        b.quantize<unsigned char>(1.0f)  != 200 ||
+        b.quantize<unsigned char>(5.0f)  != 254)
+      CPPUNIT_FAIL("test_quantizer::runTest1: Byte values do not match");
+    if (fabs(b.dequantize(150) - 0.5) > 1e-9)
+      CPPUNIT_FAIL("test_quantizer::runTest1: dequantized value does not match");
+
+    //negative values round down, infinities clamp
+    if (q.quantize<short>(-0.00016f) != -2 || q.quantize<short>(-0.00014f) != -1 ||
+        q.quantize<short>(std::numeric_limits<float>::infinity()) != 32767 ||
+        q.quantize<short>(-std::numeric_limits<float>::infinity()) != -32767)
+      CPPUNIT_FAIL("test_quantizer::runTest1: rounding or clamping does not match");
+
+    //double precision output is not implemented
+    bool thrown = false;
+    try { Quantizer::unitRange(GDT_Float64); } catch (Exception& e) { thrown = true; }
+    if (!thrown)
+      CPPUNIT_FAIL("test_quantizer::runTest1: Float64 unit range was accepted");
+    thrown = false;
+    try { Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_float64.tif"), GDT_Float64); } catch (Exception& e) { thrown = true; }
+    if (!thrown)
+      CPPUNIT_FAIL("test_quantizer::runTest1: Ndvi accepted a Float64 output");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_quantizer::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_quantizer::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_quantizer::runTest2(void) 
+{
+  try
+  {
+    //the fused kernel routes input nodata to output nodata
+    RasterDims rd(0, 3, 0, 0);
+    DataBuffer<unsigned short> inputdata(rd, 4);
+    unsigned short red[4] = { 100, 0, 50, 200 };
+    unsigned short nir[4] = { 300, 400, 0, 200 };
+    for (int idx=0; idx<4; idx++)
+    {
+      inputdata[2 * 4 + idx] = red[idx];
+      inputdata[3 * 4 + idx] = nir[idx];
+    }
+    DataBuffer<short> outputdata(rd, 1);
+    Ndvi::processchunk(inputdata, outputdata, Quantizer::unitRange(GDT_Int16), true, 0.0);
+    if (outputdata[0] != 5000   ||
+        outputdata[1] != -32768 ||
+        outputdata[2] != -32768 ||
+        outputdata[3] != 0)
+      CPPUNIT_FAIL("test_quantizer::runTest2: kernel output does not match");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_quantizer::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_quantizer::runTest2 completed successfully" << std::endl << std::endl;
+}
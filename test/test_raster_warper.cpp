@@ -0,0 +1,243 @@
+#include <gdal.h>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include "test_raster_warper.h"
+#include "RasterDims.h"
+#include "DataRaster.h"
+#include "DataBuffer.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_raster_warper);
+
+void test_raster_warper::setUp (void)
+{}
+
+void test_raster_warper::tearDown (void)
+{}
+
+void test_raster_warper::runTest1(void) 
+{
+  try
+  {
+    DataRaster src;
+    src.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> srcdata(src.dims(), src.nbands());
+    for (int band=0; band<src.nbands(); band++)
+      src.getData(srcdata, band+1, src.dataType(), band);
+
+    //the destination grid is the source grid shifted by 10 samples and 5 lines
+    double gt[6];
+    src.getGeoTransform(gt);
+    gt[0] += 10 * gt[1];
+    gt[3] += 5 * gt[5];
+    RasterDims dstdims(0, 299, 0, 299);
+
+    ResampleMethod methods[3] = { ResampleNearest, ResampleBilinear, ResampleCubic };
+    for (int method=0; method<3; method++)
+    {
+      DataRaster dst;
+      dst.create("warp_output.tif", dstdims, src.nbands(), GDT_UInt16, "GTiff", &src);
+      dst.setGeoTransform(gt);
+
+      RasterWarper warper(src, dst, methods[method], 16);
+      warper.run();
+
+      DataBuffer<unsigned short> dstdata(dst.dims(), dst.nbands());
+      for (int band=0; band<dst.nbands(); band++)
+        dst.getData(dstdata, band+1, dst.dataType(), band);
+
+      //pixel centers land on pixel centers so every method reproduces the source
+      for (int band=0; band<dst.nbands(); band++)
+      {
+        for (int line=0; line<300; line++)
+        {
+          for (int sample=0; sample<300; sample++)
+          {
+            unsigned short expected = srcdata[band * 400 * 400 + (line + 5) * 400 + sample + 10];
+            if (dstdata[band * 300 * 300 + line * 300 + sample] != expected)
+            {
+              std::ostringstream ostr;
+              ostr << "Method " << method << " pixel " << sample << "," << line << " band " << band << " does not match the source";
+              CPPUNIT_FAIL(ostr.str().c_str());
+            }
+          }
+        }
+      }
+      dst.close();
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_raster_warper::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_raster_warper::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_raster_warper::runTest2(void) 
+{
+  try
+  {
+    DataRaster src;
+    src.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> srcdata(src.dims(), src.nbands());
+    for (int band=0; band<src.nbands(); band++)
+      src.getData(srcdata, band+1, src.dataType(), band);
+
+    //a grid with half the resolution, offset so destination centers land on source centers.
+    //the destination extends past the source to exercise the fill value.
+    double gt[6];
+    src.getGeoTransform(gt);
+    gt[0] += 0.5 * gt[1];
+    gt[3] += 0.5 * gt[5];
+    gt[1] *= 2.0;
+    gt[5] *= 2.0;
+    RasterDims dstdims(0, 249, 0, 249);
+
+    DataRaster dst;
+    dst.create("warp_output.tif", dstdims, 1, GDT_UInt16, "GTiff", &src);
+    dst.setGeoTransform(gt);
+    RasterWarper warper(src, dst, ResampleNearest, 7);
+    warper.setNoDataValue(9999);
+    warper.run(static_cast<int>(0.01 * 1024. * 1024.));
+
+    DataBuffer<unsigned short> dstdata(dst.dims(), 1);
+    dst.getData(dstdata, 1, dst.dataType(), 0);
+    for (int line=0; line<250; line++)
+    {
+      for (int sample=0; sample<250; sample++)
+      {
+        unsigned short expected = 9999;
+        if (line < 200 && sample < 200)
+          expected = srcdata[(2 * line + 1) * 400 + 2 * sample + 1];
+        if (dstdata[line * 250 + sample] != expected)
+        {
+          std::ostringstream ostr;
+          ostr << "Pixel " << sample << "," << line << " is " << dstdata[line * 250 + sample] << ", expected " << expected;
+          CPPUNIT_FAIL(ostr.str().c_str());
+        }
+      }
+    }
+    dst.close();
+
+    //a grid shifted by three quarters of a pixel, so the first column maps a quarter pixel left of
+    //the source.  Every method must leave that column, and only that column, at the fill value.
+    src.getGeoTransform(gt);
+    gt[0] -= 0.75 * gt[1];
+    RasterDims edgedims(0, 400, 0, 399);
+    ResampleMethod methods[3] = { ResampleNearest, ResampleBilinear, ResampleCubic };
+    for (int method=0; method<3; method++)
+    {
+      DataRaster edge;
+      edge.create("warp_output.tif", edgedims, 1, GDT_UInt16, "GTiff", &src);
+      edge.setGeoTransform(gt);
+      RasterWarper edgewarper(src, edge, methods[method], 16);
+      edgewarper.setNoDataValue(65535);
+      edgewarper.run();
+
+      DataBuffer<unsigned short> edgedata(edge.dims(), 1);
+      edge.getData(edgedata, 1, edge.dataType(), 0);
+      for (int line=0; line<400; line++)
+      {
+        for (int sample=0; sample<401; sample++)
+        {
+          if ((edgedata[line * 401 + sample] == 65535) != (sample == 0))
+          {
+            std::ostringstream ostr;
+            ostr << "Method " << method << " footprint is incorrect at pixel " << sample << "," << line;
+            CPPUNIT_FAIL(ostr.str().c_str());
+          }
+        }
+      }
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_raster_warper::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_raster_warper::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_raster_warper::runTest3(void) 
+{
+  try
+  {
+    DataRaster src;
+    src.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> srcdata(src.dims(), src.nbands());
+    for (int band=0; band<src.nbands(); band++)
+      src.getData(srcdata, band+1, src.dataType(), band);
+
+    //geographic copies of the chip whose coordinate systems differ only in name, so the
+    //warper has to go through the reprojection transformer while the mapping stays a shift
+    const char* srcwkt = "GEOGCS[\"WGS 84\",DATUM[\"WGS_1984\",SPHEROID[\"WGS 84\",6378137,298.257223563]],"
+      "PRIMEM[\"Greenwich\",0],UNIT[\"degree\",0.0174532925199433]]";
+    const char* dstwkt = "GEOGCS[\"WGS 84 (warp test)\",DATUM[\"WGS_1984\",SPHEROID[\"WGS 84\",6378137,298.257223563]],"
+      "PRIMEM[\"Greenwich\",0],UNIT[\"degree\",0.0174532925199433]]";
+    double srcgt[6] = { 10.0, 0.001, 0.0, 50.0, 0.0, -0.001 };
+    DataRaster geosrc;
+    geosrc.create("warp_source.tif", src.dims(), src.nbands(), GDT_UInt16, "GTiff");
+    geosrc.setGeoTransform(srcgt);
+    geosrc.setProjection(srcwkt);
+    for (int band=0; band<src.nbands(); band++)
+      geosrc.setData(srcdata, src.dims(), band+1, GDT_UInt16, band);
+
+    double dstgt[6];
+    memcpy(dstgt, srcgt, sizeof(dstgt));
+    dstgt[0] += 10 * dstgt[1];
+    dstgt[3] += 5 * dstgt[5];
+    RasterDims dstdims(0, 299, 0, 299);
+
+    ResampleMethod methods[2] = { ResampleNearest, ResampleBilinear };
+    for (int method=0; method<2; method++)
+    {
+      DataRaster dst;
+      dst.create("warp_output.tif", dstdims, src.nbands(), GDT_UInt16, "GTiff");
+      dst.setGeoTransform(dstgt);
+      dst.setProjection(dstwkt);
+      CPPUNIT_ASSERT(geosrc.projection() != dst.projection());
+
+      RasterWarper warper(geosrc, dst, methods[method], 16);
+      warper.run();
+
+      DataBuffer<unsigned short> dstdata(dst.dims(), dst.nbands());
+      for (int band=0; band<dst.nbands(); band++)
+        dst.getData(dstdata, band+1, dst.dataType(), band);
+
+      //the transformer introduces rounding, so bilinear may differ from the source by one count
+      int tolerance = (methods[method] == ResampleNearest) ? 0 : 1;
+      for (int band=0; band<dst.nbands(); band++)
+      {
+        for (int line=0; line<300; line++)
+        {
+          for (int sample=0; sample<300; sample++)
+          {
+            int expected = srcdata[band * 400 * 400 + (line + 5) * 400 + sample + 10];
+            int actual = dstdata[band * 300 * 300 + line * 300 + sample];
+            if (abs(actual - expected) > tolerance)
+            {
+              std::ostringstream ostr;
+              ostr << "Method " << method << " pixel " << sample << "," << line << " band " << band << " is " << actual << ", expected " << expected;
+              CPPUNIT_FAIL(ostr.str().c_str());
+            }
+          }
+        }
+      }
+      dst.close();
+    }
+    geosrc.close();
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_raster_warper::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_raster_warper::runTest3 completed successfully" << std::endl << std::endl;
+}
@@ -0,0 +1,31 @@
+#ifndef _TESTRASTERWARPERH_
+#define _TESTRASTERWARPERH_
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <vector>
+#include "RasterWarper.h"
+
+class test_raster_warper : public CPPUNIT_NS::TestFixture
+{
+  CPPUNIT_TEST_SUITE (test_raster_warper);
+  CPPUNIT_TEST (runTest1);
+  CPPUNIT_TEST (runTest2);
+  CPPUNIT_TEST (runTest3);
+  CPPUNIT_TEST_SUITE_END ();
+
+public:
+
+  void setUp (void);
+  void tearDown (void);
+
+protected:
+
+  void runTest1(void);
+  void runTest2(void);
+  void runTest3(void);
+
+private:
+
+};
+#endif
@@ -0,0 +1,129 @@
+#include <gdal.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "test_sharded_run.h"
+#include "ShardedRun.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_sharded_run);
+
+void test_sharded_run::setUp (void)
+{}
+
+void test_sharded_run::tearDown (void)
+{}
+
+/** Reads band 1 of a raster */
+template <typename T> static void readBand(const std::string& filename, std::vector<T>& values)
+{
+  DataRaster raster;
+  raster.open(filename, GA_ReadOnly);
+  DataBuffer<T> data(raster.dims(), 1);
+  raster.getData(data, 1, raster.dataType(), 0);
+  values.assign(data.data(), data.data() + (long long)data.width() * data.height());
+}
+
+void test_sharded_run::runTest1(void) 
+{
+  try
+  {
+    {
+      Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_unsharded.tif"), GDT_Int16);
+      ndvicalc.run();
+    }
+    Ndvi::runSharded(std::string("ms_chip"), std::string("ndvi_sharded.tif"), 3, GDT_Int16);
+
+    std::vector<short> reference, sharded;
+    readBand("ndvi_unsharded.tif", reference);
+    readBand("ndvi_sharded.tif", sharded);
+    if (reference.size() != sharded.size() || memcmp(&reference[0], &sharded[0], sizeof(short) * reference.size()) != 0)
+      CPPUNIT_FAIL("test_sharded_run::runTest1: merged output differs from the unsharded output");
+
+    DataRaster merged;
+    merged.open(std::string("ndvi_sharded.tif"), GA_ReadOnly);
+    bool hasNoData = false;
+    double scale, offset;
+    merged.getScaleOffset(scale, offset);
+    if (merged.noDataValue(1, &hasNoData) != -32768 || !hasNoData || scale != 0.0001)
+      CPPUNIT_FAIL("test_sharded_run::runTest1: band description was not merged");
+
+    FILE* fp = fopen(ShardedRun::shardFilename("ndvi_sharded.tif", 0).c_str(), "r");
+    if (fp)
+    {
+      fclose(fp);
+      CPPUNIT_FAIL("test_sharded_run::runTest1: partial outputs were not removed");
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_sharded_run::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_sharded_run::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+/** A worker that writes a marker file per shard and fails shard 1 until the file "fail_shard" is removed */
+static int markerWorker(int shard, int nshards, void* context)
+{
+  (void)nshards;
+  (void)context;
+  FILE* fail = fopen("fail_shard", "r");
+  if (fail)
+  {
+    fclose(fail);
+    if (shard == 1)
+      throw Exception("shard 1 failed");
+  }
+  FILE* fp = fopen(ShardedRun::shardFilename("marker", shard).c_str(), "a");
+  fprintf(fp, "x");
+  fclose(fp);
+  return(0);
+}
+
+void test_sharded_run::runTest2(void) 
+{
+  try
+  {
+    remove("marker_shards");
+    for (int shard=0; shard<4; shard++)
+      remove(ShardedRun::shardFilename("marker", shard).c_str());
+    FILE* fail = fopen("fail_shard", "w");
+    fclose(fail);
+
+    //the first run fails one shard
+    bool threw = false;
+    {
+      ShardedRun sharded("marker_shards", "markers", 4);
+      try { sharded.run(markerWorker, NULL); } catch (Exception&) { threw = true; }
+      if (!threw || sharded.complete())
+        CPPUNIT_FAIL("test_sharded_run::runTest2: failed shard was not reported");
+    }
+
+    //the second run only reruns the failed shard
+    remove("fail_shard");
+    ShardedRun sharded("marker_shards", "markers", 4);
+    if (sharded.run(markerWorker, NULL) != 1 || !sharded.complete())
+      CPPUNIT_FAIL("test_sharded_run::runTest2: resumed run did not complete the failed shard only");
+    for (int shard=0; shard<4; shard++)
+    {
+      FILE* fp = fopen(ShardedRun::shardFilename("marker", shard).c_str(), "r");
+      char buf[8] = {0};
+      size_t n = fp ? fread(buf, 1, sizeof(buf), fp) : 0;
+      if (fp)
+        fclose(fp);
+      if (n != 1)
+        CPPUNIT_FAIL("test_sharded_run::runTest2: a shard did not run exactly once");
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_sharded_run::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_sharded_run::runTest2 completed successfully" << std::endl << std::endl;
+}
@@ -0,0 +1,180 @@
+#include <gdal.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "test_temporal_composite.h"
+#include "TemporalComposite.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_temporal_composite);
+
+void test_temporal_composite::setUp (void)
+{}
+
+void test_temporal_composite::tearDown (void)
+{}
+
+static const int ndates = 7;
+
+/** Returns band 0 (red), 1 (NIR) or 2 of a date at a global pixel, or -9999 where the date is cloudy */
+static float bandAt(int sample, int line, int date, int band)
+{
+  if ((sample / 9 + line / 7 + date) % 5 == 0)
+    return(-9999.0f);
+  float red = 200.0f + (float)((sample * 7 + line * 3 + date * 29) % 61);
+  float nir = 300.0f + (float)((sample * 5 + line * 11 + date * 41) % 173);
+  return((band == 0) ? red : ((band == 1) ? nir : (float)(date * 100 + band)));
+}
+
+/** Writes the dates of the stack.  Date n is shifted by n samples and n / 2 lines on one grid. */
+static void makeStack(std::vector<std::string>& filenames)
+{
+  for (int date=0; date<ndates; date++)
+  {
+    std::ostringstream ostr;
+    ostr << "composite_date" << date << ".tif";
+    filenames.push_back(ostr.str());
+    RasterDims rd(0, 89, 0, 69);
+    DataBuffer<float> data(rd, 3);
+    for (int band=0; band<3; band++)
+    {
+      for (int line=0; line<70; line++)
+      {
+        for (int sample=0; sample<90; sample++)
+          data.band(band)(line, sample) = bandAt(sample + date, line + date / 2, date, band);
+      }
+    }
+    double gt[6] = { 500000.0 + date * 30.0, 30.0, 0.0, 4000000.0 - (date / 2) * 30.0, 0.0, -30.0 };
+    DataRaster raster;
+    raster.create(filenames.back(), rd, 3, GDT_Float32, "GTiff");
+    raster.setGeoTransform(gt);
+    for (int band=0; band<3; band++)
+    {
+      raster.setNoDataValue(-9999.0, band + 1);
+      raster.setData(data, rd, band + 1, GDT_Float32, band);
+    }
+  }
+}
+
+/** Computes one pixel of a composite by brute force.  The common area starts at global pixel (6, 3). */
+static float expectedAt(CompositeMethod method, int sample, int line, int band)
+{
+  std::vector<float> values;
+  int bestDate = -1;
+  float best = -1e30f;
+  for (int date=0; date<ndates; date++)
+  {
+    float red = bandAt(sample + 6, line + 3, date, 0);
+    if (red == -9999.0f)
+      continue;
+    float nir = bandAt(sample + 6, line + 3, date, 1);
+    float ndvi = (nir - red) / (nir + red);
+    if (ndvi > best)
+    {
+      best = ndvi;
+      bestDate = date;
+    }
+    values.push_back(bandAt(sample + 6, line + 3, date, band));
+  }
+  if (method == CompositeCount)
+    return((float)values.size());
+  if (values.empty())
+    return(std::numeric_limits<float>::quiet_NaN());
+  if (method == CompositeMaxNdvi)
+    return(bandAt(sample + 6, line + 3, bestDate, band));
+  if (method == CompositeMean)
+  {
+    double sum = 0.0;
+    for (size_t idx=0; idx<values.size(); idx++)
+      sum += values[idx];
+    return((float)(sum / values.size()));
+  }
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return((n % 2) ? values[n / 2] : 0.5f * (values[n / 2 - 1] + values[n / 2]));
+}
+
+/** Runs one reducer over the stack and checks every output pixel */
+static void checkComposite(CompositeMethod method, const char* test)
+{
+  std::vector<std::string> filenames;
+  makeStack(filenames);
+  std::vector<DataRaster*> stack;
+  for (int date=0; date<ndates; date++)
+  {
+    stack.push_back(new DataRaster());
+    stack.back()->open(filenames[date], GA_ReadOnly);
+  }
+
+  TemporalComposite composite(stack, method);
+  composite.setNdviBands(1, 2);
+  RasterDims outdims = composite.outputDims();
+  DataRaster output;
+  output.create("composite_output.tif", outdims, composite.outputBands(), GDT_Float32, "GTiff");
+  composite.run(output, 84 * 4 * 10, 3);
+  DataBuffer<float> result(outdims, composite.outputBands());
+  for (int band=0; band<composite.outputBands(); band++)
+    output.getData(result, band + 1, GDT_Float32, band);
+  for (int date=0; date<ndates; date++)
+    delete(stack[date]);
+
+  std::ostringstream ostr;
+  ostr << test << ": ";
+  if (!(outdims == RasterDims(0, 83, 0, 66)))
+  {
+    ostr << "output dimensions are incorrect";
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  for (int band=0; band<composite.outputBands(); band++)
+  {
+    for (int line=0; line<outdims.height(); line++)
+    {
+      for (int sample=0; sample<outdims.width(); sample++)
+      {
+        float expected = expectedAt(method, sample, line, band);
+        float found = result.band(band)(line, sample);
+        bool nan = (expected != expected);
+        if (nan != (found != found) || (!nan && fabs(found - expected) > 1e-3f * fabs(expected)))
+        {
+          ostr << "method " << method << " pixel " << sample << "," << line << " band " << band << " is " << found << ", expected " << expected;
+          CPPUNIT_FAIL(ostr.str().c_str());
+        }
+      }
+    }
+  }
+}
+
+void test_temporal_composite::runTest1(void) 
+{
+  try
+  {
+    //maximum NDVI with band carry-through, and the count of valid dates
+    checkComposite(CompositeMaxNdvi, "test_temporal_composite::runTest1");
+    checkComposite(CompositeCount, "test_temporal_composite::runTest1");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_temporal_composite::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_temporal_composite::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_temporal_composite::runTest2(void) 
+{
+  try
+  {
+    //median and mean of every band over the valid dates
+    checkComposite(CompositeMedian, "test_temporal_composite::runTest2");
+    checkComposite(CompositeMean, "test_temporal_composite::runTest2");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_temporal_composite::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_temporal_composite::runTest2 completed successfully" << std::endl << std::endl;
+}
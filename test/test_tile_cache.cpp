@@ -0,0 +1,200 @@
+#include <gdal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "test_tile_cache.h"
+#include "TileCache.h"
+#include "Ndvi.h"
+#include "MultiRasterIterator.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_tile_cache);
+
+void test_tile_cache::setUp (void)
+{
+  if (system("rm -rf tile_cache tile_cache_small") != 0)
+    std::cout << "unable to clear tile_cache" << std::endl;
+}
+
+void test_tile_cache::tearDown (void)
+{}
+
+void test_tile_cache::runTest1(void) 
+{
+  try
+  {
+    std::vector<char> block(1000), back(1000);
+    for (int idx=0; idx<1000; idx++)
+      block[idx] = (char)idx;
+
+    {
+      //room for two entries of 1000 bytes and their headers
+      TileCache cache("tile_cache", 2100);
+      cache.put("a", &block[0], 1000);
+      cache.put("b", &block[0], 1000);
+      if (!cache.get("a", &back[0], 1000) || memcmp(&block[0], &back[0], 1000) != 0)
+        CPPUNIT_FAIL("test_tile_cache::runTest1: entry was not returned");
+      if (cache.get("a", &back[0], 999))
+        CPPUNIT_FAIL("test_tile_cache::runTest1: entry of another size was returned");
+
+      //b is the least recently used entry
+      cache.put("c", &block[0], 1000);
+      if (cache.nentries() != 2 || cache.get("b", &back[0], 1000) || !cache.get("c", &back[0], 1000))
+        CPPUNIT_FAIL("test_tile_cache::runTest1: least recently used entry was not evicted");
+      if (cache.hits() != 2 || cache.misses() != 2)
+        CPPUNIT_FAIL("test_tile_cache::runTest1: hits and misses are incorrect");
+    }
+
+    //entries persist for later runs, and a smaller budget evicts down to size
+    TileCache cache("tile_cache", 1500);
+    if (cache.nentries() != 1 || cache.nbytes() != 1016)
+      CPPUNIT_FAIL("test_tile_cache::runTest1: reopened cache was not trimmed to its budget");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_tile_cache::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_tile_cache::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_tile_cache::runTest2(void) 
+{
+  try
+  {
+    TileCache cache("tile_cache", 64 * 1024 * 1024);
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> reference(msraster.dims(), msraster.nbands());
+    for (int band=0; band<msraster.nbands(); band++)
+      msraster.getData(reference, band+1, msraster.dataType(), band);
+
+    //the first pass decodes and fills the cache, the second is served from it
+    msraster.setTileCache(&cache);
+    for (int pass=0; pass<2; pass++)
+    {
+      DataBuffer<unsigned short> data(msraster.dims(), msraster.nbands());
+      for (int band=0; band<msraster.nbands(); band++)
+        msraster.getData(data, band+1, msraster.dataType(), band);
+      if (memcmp(reference.data(), data.data(), sizeof(unsigned short) * 400 * 400 * 4) != 0)
+        CPPUNIT_FAIL("test_tile_cache::runTest2: cached read differs from the source");
+    }
+    if (cache.misses() != 4 || cache.hits() != 4 || cache.nentries() != 4)
+      CPPUNIT_FAIL("test_tile_cache::runTest2: second pass was not served from the cache");
+
+    //an Ndvi run through the cache gives the same output
+    {
+      Ndvi ndvicalc(std::string("ms_chip"), std::string("ndvi_cached.tif"));
+      ndvicalc.setTileCache(&cache);
+      ndvicalc.run();
+      ndvicalc.run();
+    }
+    DataBuffer<float> expected(msraster.dims(), 1), output(msraster.dims(), 1);
+    Ndvi::processchunk(reference, expected);
+    DataRaster outraster;
+    outraster.open(std::string("ndvi_cached.tif"), GA_ReadOnly);
+    outraster.getData(output, 1, outraster.dataType(), 0);
+    if (memcmp(expected.data(), output.data(), sizeof(float) * 400 * 400) != 0)
+      CPPUNIT_FAIL("test_tile_cache::runTest2: Ndvi output through the cache is incorrect");
+    if (cache.hits() <= 4)
+      CPPUNIT_FAIL("test_tile_cache::runTest2: repeated Ndvi run did not use the cache");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_tile_cache::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_tile_cache::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_tile_cache::runTest3(void) 
+{
+  try
+  {
+    //two rasters share one cache and are read concurrently; the small budget keeps entries being evicted
+    DataRaster first, second;
+    first.open(std::string("ms_chip"), GA_ReadOnly);
+    second.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> reference(first.dims(), 1);
+    first.getData(reference, 1, first.dataType(), 0);
+
+    TileCache cache("tile_cache", 40 * 1024);
+    first.setTileCache(&cache);
+    second.setTileCache(&cache);
+    std::vector<DataRaster*> inputs(1, &first);
+    inputs.push_back(&second);
+    MultiRasterIterator iter(inputs, 8 * 1024);
+    long long nreads = 0;
+    for (int pass=0; pass<4; pass++)
+    {
+      for (int tilenum=0; tilenum<iter.ntiles(); tilenum++)
+      {
+        RasterDims window;
+        iter.getInputDims(0, tilenum, window);
+        DataBuffer<unsigned short> a(window, 1), b(window, 1);
+        std::vector<DataBuffer<unsigned short>*> buffers(1, &a);
+        buffers.push_back(&b);
+        iter.getData(tilenum, buffers, GDT_UInt16);
+        nreads += 2;
+        long long offset = (long long)window.startLine() * 400;
+        if (memcmp(a.data(), reference.data() + offset, a.dims().npixels() * sizeof(unsigned short)) != 0 ||
+            memcmp(b.data(), reference.data() + offset, b.dims().npixels() * sizeof(unsigned short)) != 0)
+          CPPUNIT_FAIL("test_tile_cache::runTest3: concurrent read through the shared cache is incorrect");
+      }
+    }
+    if (cache.hits() + cache.misses() != nreads || cache.nbytes() > 40 * 1024)
+      CPPUNIT_FAIL("test_tile_cache::runTest3: shared cache accounting is incorrect");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_tile_cache::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_tile_cache::runTest3 completed successfully" << std::endl << std::endl;
+}
+
+void test_tile_cache::runTest4(void) 
+{
+  try
+  {
+    std::vector<char> block(100), back(100);
+    for (int idx=0; idx<100; idx++)
+      block[idx] = (char)(idx * 7);
+
+    //two caches on one directory, as two processes would have
+    TileCache first("tile_cache", 1024 * 1024), second("tile_cache", 1024 * 1024);
+    second.put("shared", &block[0], 100);
+    if (!first.get("shared", &back[0], 100) || memcmp(&block[0], &back[0], 100) != 0 || first.nentries() != 1)
+      CPPUNIT_FAIL("test_tile_cache::runTest4: entry written by another cache was not found");
+
+    //an entry removed by another cache is dropped from the index
+    remove("tile_cache/shared.tile");
+    if (first.get("shared", &back[0], 100) || first.nentries() != 0 || first.nbytes() != 0)
+      CPPUNIT_FAIL("test_tile_cache::runTest4: removed entry was not dropped from the index");
+
+    //many entries through a small budget keep only the most recent ones
+    TileCache small("tile_cache_small", 50 * 116);
+    for (int idx=0; idx<5000; idx++)
+    {
+      std::ostringstream key;
+      key << "k" << idx;
+      small.put(key.str(), &block[0], 100);
+    }
+    if (small.nentries() != 50 || !small.get("k4999", &back[0], 100) || !small.get("k4950", &back[0], 100) ||
+        small.get("k4949", &back[0], 100))
+      CPPUNIT_FAIL("test_tile_cache::runTest4: the most recent entries were not kept");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_tile_cache::runTest4: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_tile_cache::runTest4 completed successfully" << std::endl << std::endl;
+}
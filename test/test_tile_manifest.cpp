@@ -0,0 +1,169 @@
+#include <gdal.h>
+#include <stdio.h>
+#include <vector>
+#include "test_tile_manifest.h"
+#include "TileManifest.h"
+#include "Ndvi.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_tile_manifest);
+
+void test_tile_manifest::setUp (void)
+{}
+
+void test_tile_manifest::tearDown (void)
+{}
+
+void test_tile_manifest::runTest1(void) 
+{
+  try
+  {
+    remove("test.manifest");
+    {
+      TileManifest manifest("test.manifest", "params a");
+      if (manifest.resumed() || manifest.ncomplete() != 0)
+        CPPUNIT_FAIL("test_tile_manifest::runTest1: a new manifest is not empty");
+      manifest.markComplete(0, 0x1234ULL);
+      manifest.markComplete(3, 0xabcdULL);
+      manifest.markComplete(0, 0x5678ULL);
+    }
+
+    {
+      //same parameters, the entries are resumed and the last entry for a tile wins
+      TileManifest manifest("test.manifest", "params a");
+      if (!manifest.resumed()          ||
+          manifest.ncomplete() != 2    ||
+          !manifest.isComplete(0, 0x5678ULL) ||
+          manifest.isComplete(0, 0x1234ULL)  ||
+          !manifest.isComplete(3, 0xabcdULL) ||
+          manifest.contains(1))
+        CPPUNIT_FAIL("test_tile_manifest::runTest1: resumed entries do not match");
+    }
+
+    {
+      //an interrupted write leaves a partial last line, which is dropped before new entries are appended
+      FILE* fp = fopen("test.manifest", "a");
+      fprintf(fp, "til");
+      fclose(fp);
+      TileManifest manifest("test.manifest", "params a");
+      if (!manifest.resumed() || manifest.ncomplete() != 2)
+        CPPUNIT_FAIL("test_tile_manifest::runTest1: manifest with a partial line was not resumed");
+      manifest.markComplete(5, 0x9999ULL);
+    }
+    {
+      TileManifest manifest("test.manifest", "params a");
+      if (manifest.ncomplete() != 3 || !manifest.isComplete(5, 0x9999ULL) || !manifest.isComplete(3, 0xabcdULL))
+        CPPUNIT_FAIL("test_tile_manifest::runTest1: entries after a partial line were lost");
+    }
+
+    {
+      //different parameters invalidate every entry
+      TileManifest manifest("test.manifest", "params b");
+      if (manifest.resumed() || manifest.ncomplete() != 0)
+        CPPUNIT_FAIL("test_tile_manifest::runTest1: manifest with other parameters was resumed");
+    }
+
+    unsigned char a[13] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+    unsigned long long c1 = TileManifest::checksum(a, sizeof(a));
+    a[12] = 14;
+    unsigned long long c2 = TileManifest::checksum(a, sizeof(a));
+    if (c1 == c2 || c1 == 0ULL || c2 == 0ULL)
+      CPPUNIT_FAIL("test_tile_manifest::runTest1: checksum does not detect a change");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_tile_manifest::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_tile_manifest::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_tile_manifest::runTest2(void) 
+{
+  try
+  {
+    //copy the chip so the input can be edited
+    DataRaster msraster;
+    msraster.open(std::string("ms_chip"), GA_ReadOnly);
+    DataBuffer<unsigned short> msdata(msraster.dims(), msraster.nbands());
+    for (int band=0; band<msraster.nbands(); band++)
+      msraster.getData(msdata, band+1, msraster.dataType(), band);
+    {
+      DataRaster copy;
+      copy.create("manifest_input.tif", msraster.dims(), msraster.nbands(), GDT_UInt16, "GTiff", &msraster);
+      for (int band=0; band<copy.nbands(); band++)
+        copy.setData(msdata, msdata.dims(), band+1, copy.dataType(), band);
+    }
+    remove("ndvi_checkpoint.manifest");
+
+    int expected[3] = { 4, 0, 1 };
+    for (int run=0; run<3; run++)
+    {
+      if (run == 2)
+      {
+        //edit a few lines inside the third tile
+        DataRaster copy;
+        copy.open(std::string("manifest_input.tif"), GA_Update);
+        RasterDims edit(0, 399, 300, 310);
+        DataBuffer<unsigned short> editdata(edit, 1);
+        for (int band=0; band<copy.nbands(); band++)
+          copy.setData(editdata, edit, band+1, copy.dataType(), 0);
+      }
+
+      Ndvi ndvicalc(std::string("manifest_input.tif"), std::string("ndvi_checkpoint.tif"));
+      ndvicalc.setCheckpointFile("ndvi_checkpoint.manifest");
+      ndvicalc.run();
+      if (ndvicalc.tilesProcessed() != expected[run])
+      {
+        std::ostringstream ostr;
+        ostr << "test_tile_manifest::runTest2: run " << run << " processed " << ndvicalc.tilesProcessed()
+             << " tiles, expected " << expected[run];
+        CPPUNIT_FAIL(ostr.str().c_str());
+      }
+    }
+
+    //the incrementally updated output matches a full run over the edited input
+    {
+      Ndvi ndvicalc(std::string("manifest_input.tif"), std::string("ndvi_full.tif"));
+      ndvicalc.run();
+    }
+    DataRaster incremental, full;
+    incremental.open(std::string("ndvi_checkpoint.tif"), GA_ReadOnly);
+    full.open(std::string("ndvi_full.tif"), GA_ReadOnly);
+    DataBuffer<float> incrementaldata(incremental.dims(), 1), fulldata(full.dims(), 1);
+    incremental.getData(incrementaldata, 1, GDT_Float32, 0);
+    full.getData(fulldata, 1, GDT_Float32, 0);
+    for (int idx=0; idx<400*400; idx++)
+    {
+      if (incrementaldata[idx] != fulldata[idx])
+        CPPUNIT_FAIL("test_tile_manifest::runTest2: incremental output differs from a full run");
+    }
+    incremental.close();
+
+    //without its output the manifest is discarded and every tile is recomputed
+    remove("ndvi_checkpoint.tif");
+    {
+      Ndvi ndvicalc(std::string("manifest_input.tif"), std::string("ndvi_checkpoint.tif"));
+      ndvicalc.setCheckpointFile("ndvi_checkpoint.manifest");
+      ndvicalc.run();
+      if (ndvicalc.tilesProcessed() != 4)
+        CPPUNIT_FAIL("test_tile_manifest::runTest2: a manifest without its output was resumed");
+    }
+    incremental.open(std::string("ndvi_checkpoint.tif"), GA_ReadOnly);
+    incremental.getData(incrementaldata, 1, GDT_Float32, 0);
+    for (int idx=0; idx<400*400; idx++)
+    {
+      if (incrementaldata[idx] != fulldata[idx])
+        CPPUNIT_FAIL("test_tile_manifest::runTest2: recomputed output differs from a full run");
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_tile_manifest::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_tile_manifest::runTest2 completed successfully" << std::endl << std::endl;
+}
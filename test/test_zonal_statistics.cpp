@@ -0,0 +1,204 @@
+#include <gdal.h>
+#include <math.h>
+#include <map>
+#include <vector>
+#include "test_zonal_statistics.h"
+#include "ZonalStatistics.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (test_zonal_statistics);
+
+void test_zonal_statistics::setUp (void)
+{}
+
+void test_zonal_statistics::tearDown (void)
+{}
+
+/** Writes a value raster and a label raster, and accumulates the expected statistics by brute force */
+static void makeZones(unsigned int labelStride, std::map<unsigned int, ZoneStats>& expected)
+{
+  RasterDims rd(0, 199, 0, 149);
+  DataBuffer<float> values(rd, 1);
+  DataBuffer<unsigned int> labels(rd, 1);
+  for (int line=0; line<150; line++)
+  {
+    for (int sample=0; sample<200; sample++)
+    {
+      float value = (float)sin(line * 0.37 + sample * 0.11);
+      unsigned int label = (unsigned int)((line / 10) * 20 + sample / 10) * labelStride;
+      if ((line * 200 + sample) % 97 == 0)
+        value = -9999.0f;  //value nodata
+      if ((line * 200 + sample) % 89 == 0)
+        label = 0;  //label nodata
+      values.band(0)(line, sample) = value;
+      labels.band(0)(line, sample) = label;
+      if (value == -9999.0f || label == 0)
+        continue;
+
+      std::map<unsigned int, ZoneStats>::iterator it = expected.find(label);
+      if (it == expected.end())
+      {
+        ZoneStats zone = { label, 0, 0.0, value, value };
+        it = expected.insert(std::make_pair(label, zone)).first;
+      }
+      it->second.count++;
+      it->second.sum += value;
+      it->second.min = (value < it->second.min) ? value : it->second.min;
+      it->second.max = (value > it->second.max) ? value : it->second.max;
+    }
+  }
+
+  DataRaster valueraster, labelraster;
+  valueraster.create("zone_values.tif", rd, 1, GDT_Float32, "GTiff");
+  valueraster.setNoDataValue(-9999.0);
+  valueraster.setData(values, rd, 1, GDT_Float32, 0);
+  labelraster.create("zone_labels.tif", rd, 1, GDT_UInt32, "GTiff");
+  labelraster.setNoDataValue(0.0);
+  labelraster.setData(labels, rd, 1, GDT_UInt32, 0);
+}
+
+/** Compares computed statistics with the expected ones */
+static void checkZones(ZonalStatistics& zonal, std::map<unsigned int, ZoneStats>& expected, const char* test)
+{
+  if (zonal.zones().size() != expected.size())
+  {
+    std::ostringstream ostr;
+    ostr << test << ": found " << zonal.zones().size() << " zones, expected " << expected.size();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  for (std::map<unsigned int, ZoneStats>::iterator it=expected.begin(); it!=expected.end(); ++it)
+  {
+    const ZoneStats* zone = zonal.zone(it->first);
+    if (!zone || zone->count != it->second.count || fabs(zone->mean() - it->second.mean()) > 1e-9 ||
+        zone->min != it->second.min || zone->max != it->second.max)
+    {
+      std::ostringstream ostr;
+      ostr << test << ": statistics of zone " << it->first << " are incorrect";
+      CPPUNIT_FAIL(ostr.str().c_str());
+    }
+  }
+}
+
+void test_zonal_statistics::runTest1(void) 
+{
+  try
+  {
+    //300 zones with small labels, held in dense arrays, over several chunks and threads
+    std::map<unsigned int, ZoneStats> expected;
+    makeZones(1, expected);
+    DataRaster values, labels;
+    values.open(std::string("zone_values.tif"), GA_ReadOnly);
+    labels.open(std::string("zone_labels.tif"), GA_ReadOnly);
+    ZonalStatistics zonal(values, labels);
+    zonal.run(200 * 4 * 16, 4);
+    checkZones(zonal, expected, "test_zonal_statistics::runTest1");
+    if (zonal.zone(0) != NULL)
+      CPPUNIT_FAIL("test_zonal_statistics::runTest1: nodata label was counted as a zone");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_zonal_statistics::runTest1: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_zonal_statistics::runTest1 completed successfully" << std::endl << std::endl;
+}
+
+void test_zonal_statistics::runTest2(void) 
+{
+  try
+  {
+    //labels spread over the 32 bit range, held in hash tables
+    std::map<unsigned int, ZoneStats> expected;
+    makeZones(10000019u, expected);
+    DataRaster values, labels;
+    values.open(std::string("zone_values.tif"), GA_ReadOnly);
+    labels.open(std::string("zone_labels.tif"), GA_ReadOnly);
+    ZonalStatistics zonal(values, labels);
+    zonal.setDenseLimit(16);
+    zonal.run(200 * 4 * 16, 3);
+    checkZones(zonal, expected, "test_zonal_statistics::runTest2");
+    for (size_t idx=1; idx<zonal.zones().size(); idx++)
+    {
+      if (!(zonal.zones()[idx-1] < zonal.zones()[idx]))
+        CPPUNIT_FAIL("test_zonal_statistics::runTest2: zones are not ordered by label");
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_zonal_statistics::runTest2: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_zonal_statistics::runTest2 completed successfully" << std::endl << std::endl;
+}
+
+void test_zonal_statistics::runTest3(void) 
+{
+  try
+  {
+    //Int16 labels with -1 as nodata, where 0 is a real zone
+    RasterDims rd(0, 199, 0, 149);
+    DataBuffer<float> values(rd, 1);
+    DataBuffer<short> labels(rd, 1);
+    std::map<unsigned int, ZoneStats> expected;
+    for (int line=0; line<150; line++)
+    {
+      for (int sample=0; sample<200; sample++)
+      {
+        float value = (float)cos(line * 0.21 + sample * 0.05);
+        short label = (short)(line / 10);
+        if ((line * 200 + sample) % 89 == 0)
+          label = -1;
+        values.band(0)(line, sample) = value;
+        labels.band(0)(line, sample) = label;
+        if (label < 0)
+          continue;
+        std::map<unsigned int, ZoneStats>::iterator it = expected.find(label);
+        if (it == expected.end())
+        {
+          ZoneStats zone = { (unsigned int)label, 0, 0.0, value, value };
+          it = expected.insert(std::make_pair((unsigned int)label, zone)).first;
+        }
+        it->second.count++;
+        it->second.sum += value;
+        it->second.min = (value < it->second.min) ? value : it->second.min;
+        it->second.max = (value > it->second.max) ? value : it->second.max;
+      }
+    }
+    DataRaster valueraster, labelraster;
+    valueraster.create("zone_values.tif", rd, 1, GDT_Float32, "GTiff");
+    valueraster.setData(values, rd, 1, GDT_Float32, 0);
+    labelraster.create("zone_signed_labels.tif", rd, 1, GDT_Int16, "GTiff");
+    labelraster.setNoDataValue(-1.0);
+    labelraster.setData(labels, rd, 1, GDT_Int16, 0);
+
+    ZonalStatistics zonal(valueraster, labelraster);
+    zonal.run(200 * 4 * 16, 4);
+    checkZones(zonal, expected, "test_zonal_statistics::runTest3");
+
+    //a negative label that is not the nodata value is rejected rather than merged into zone 0
+    labels.band(0)(75, 100) = -5;
+    labelraster.setData(labels, rd, 1, GDT_Int16, 0);
+    bool threw = false;
+    try
+    {
+      zonal.run(200 * 4 * 16, 4);
+    }
+    catch (Exception&)
+    {
+      threw = true;
+    }
+    if (!threw)
+      CPPUNIT_FAIL("test_zonal_statistics::runTest3: a negative label was accepted");
+  }
+  catch (std::exception& e)
+  {
+    std::ostringstream ostr;
+    ostr << "*** Exception thrown in test_zonal_statistics::runTest3: " << e.what();
+    CPPUNIT_FAIL(ostr.str().c_str());
+  }
+  
+  std::cout << std::endl << "test_zonal_statistics::runTest3 completed successfully" << std::endl << std::endl;
+}